@@ -1,2148 +1,8834 @@
-#include <stdarg.h>
-#include <stdlib.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <math.h>
-//#include <windows.h>
-#include <unistd.h>
-#include <sys/time.h>
-
-#ifdef WIN32
-#include "freeglut/include/GL/freeglut.h"
-#else
-#include <GL/freeglut.h>
-#endif
-
-#define PI 3.14159265358979323846f
-
-static int oldtime;
-static int realtime;
-static int framenum;
-
-// Input
-typedef struct input_s
-{
-	int mousepos[2];
-	int moused[2];
-	bool lbuttondown;
-	bool rbuttondown;
-	bool keys[256];
-
-} input_t;
-
-static int mousepos[2];
-static input_t input;
-
-
-// ==============================================
-// timing
-
-static unsigned int GetMilliseconds()
-{
-	struct timeval	tp;
-
-	gettimeofday(&tp, NULL);
-
-	return (tp.tv_sec * 1000) + (tp.tv_usec / 1000);
-}
-
-unsigned int Sys_Milliseconds (void)
-{
-	static unsigned int basetime;
-	static unsigned int curtime;
-
-	if (!basetime)
-	{
-		basetime = GetMilliseconds();
-	}
-
-	curtime = GetMilliseconds() - basetime;
-
-	return curtime;
-}
-
-void Sys_Sleep(unsigned int msecs)
-{
-	usleep(msecs * 1000);
-}
-
-// ==============================================
-// memory allocation
-
-#define MEM_ALLOC_SIZE	32 * 1024 * 1024
-
-typedef struct memstack_s
-{
-	unsigned char mem[MEM_ALLOC_SIZE];
-	int allocated;
-
-} memstack_t;
-
-static memstack_t memstack;
-
-void *Mem_Alloc(int numbytes)
-{
-	unsigned char *mem;
-	
-	if(memstack.allocated + numbytes > MEM_ALLOC_SIZE)
-	{
-		printf("Error: Mem: no free space available\n");
-		abort();
-	}
-
-	mem = memstack.mem + memstack.allocated;
-	memstack.allocated += numbytes;
-
-	return mem;
-}
-
-void Mem_FreeStack()
-{
-	memstack.allocated = 0;
-}
-
-// ==============================================
-// errors and warnings
-
-static void Error(const char *error, ...)
-{
-	va_list valist;
-	char buffer[2048];
-
-	va_start(valist, error);
-	vsprintf(buffer, error, valist);
-	va_end(valist);
-
-	printf("Error: %s", buffer);
-	exit(1);
-}
-
-static void Warning(const char *warning, ...)
-{
-	va_list valist;
-	char buffer[2048];
-
-	va_start(valist, warning);
-	vsprintf(buffer, warning, valist);
-	va_end(valist);
-
-	fprintf(stdout, "Warning: %s", buffer);
-}
-
-// ==============================================
-// Misc crap
-
-static float Vector_Dot(float a[3], float b[3])
-{
-	return (a[0] * b[0]) + (a[1] * b[1]) + (a[2] * b[2]);
-}
-
-static void Vector_Copy(float *a, float *b)
-{
-	a[0] = b[0];
-	a[1] = b[1];
-	a[2] = b[2];
-}
-
-static void Vector_Cross(float *c, float *a, float *b)
-{
-	c[0] = (a[1] * b[2]) - (a[2] * b[1]);
-	c[1] = (a[2] * b[0]) - (a[0] * b[2]);
-	c[2] = (a[0] * b[1]) - (a[1] * b[0]);
-}
-
-static void Vector_Normalize(float *v)
-{
-	float len, invlen;
-
-	len = sqrtf((v[0] * v[0]) + (v[1] * v[1]) + (v[2] * v[2]));
-	invlen = 1.0f / len;
-
-	v[0] *= invlen;
-	v[1] *= invlen;
-	v[2] *= invlen;
-}
-
-static void Vector_Lerp(float *result, float *from, float *to, float t)
-{
-	result[0] = ((1 - t) * from[0]) + (t * to[0]);
-	result[1] = ((1 - t) * from[1]) + (t * to[1]);
-	result[2] = ((1 - t) * from[2]) + (t * to[2]);
-}
-
-static void MatrixTranspose(float out[4][4], const float in[4][4])
-{
-	for( int i = 0; i < 4; i++ )
-	{
-		for( int j = 0; j < 4; j++ )
-		{
-			out[j][i] = in[i][j];
-		}
-	}
-}
-
-// ==============================================
-// MD5 model
-
-typedef struct md5joint_s
-{
-	char	*name;
-	int		parentindex;
-	int		flags;
-	float	p[3];
-	float	q[4];
-
-} md5joint_t;
-
-typedef struct md5vertex_s
-{
-	float	texcoords[2];
-	int		firstweight;
-	int		numweights;
-
-} md5vertex_t;
-
-typedef struct md5tri_s
-{
-	int		indicies[3];
-
-} md5tri_t;
-
-typedef struct md5weight_s
-{
-	int	joint;
-	float	weight;
-	float	xyz[3];
-
-} md5weight_t;
-
-typedef struct md5mesh_s
-{
-	struct md5mesh_s	*next;
-
-	int				numvertices;
-	md5vertex_t		*vertices;
-	int				numtris;
-	md5tri_t		*tris;
-	int				numweights;
-	md5weight_t		*weights;
-
-} md5mesh_t;
-
-typedef struct md5bound_s
-{
-	float			min[3];
-	float			max[3];
-
-} md5bound_t;
-
-typedef struct md5animframe_s
-{
-	float		*data;
-} md5animframe_t;
-
-typedef struct md5anim_s
-{
-	struct md5anim_s	*next;
-
-	char			*name;
-	int				numframes;
-	int				framerate;
-	int				numanimatedcomponents;
-	int				numjoints;
-	
-	md5joint_t		*joints;
-	md5bound_t		*bounds;
-	md5animframe_t	*frames;
-	float			*framedata;
-
-} md5anim_t;
-
-typedef struct md5model_s
-{
-	int				numjoints;
-	md5joint_t		*joints;
-	int				nummeshes;
-	md5mesh_t		*meshes;
-	md5anim_t		*anims;
-
-} md5model_t;
-
-typedef struct md5jointmat_s
-{
-	float		m[3][4];
-
-} md5jointmat_t;
-
-#define MD5_ANIM_TX		(1 << 0)
-#define MD5_ANIM_TY		(1 << 1)
-#define MD5_ANIM_TZ		(1 << 2)
-
-#define MD5_ANIM_QX		(1 << 3)
-#define MD5_ANIM_QY		(1 << 4)
-#define MD5_ANIM_QZ		(1 << 5)
-
-static md5model_t* md5model;
-
-char *Mem_AllocString(char *string)
-{
-	char *buffer = (char*)Mem_Alloc(strlen(string) + 1);
-	strcpy(buffer, string);
-
-	return buffer;
-}
-
-static md5joint_t *Mem_AllocMD5Joint(int numjoints)
-{
-	return (md5joint_t*)Mem_Alloc(numjoints * sizeof(md5joint_t));
-}
-
-static md5vertex_t *Mem_AllocMD5Vertex(int numvertices)
-{
-	return (md5vertex_t*)Mem_Alloc(numvertices * sizeof(md5vertex_t));
-}
-
-static md5tri_t *Mem_AllocMD5Tri(int numtris)
-{
-	return (md5tri_t*)Mem_Alloc(numtris * sizeof(md5tri_t));
-}
-
-static md5weight_t *Mem_AllocMD5Weight(int numweights)
-{
-	return (md5weight_t*)Mem_Alloc(numweights * sizeof(md5weight_t));
-}
-
-static md5mesh_t *Mem_AllocMD5Mesh(int nummeshes)
-{
-	return (md5mesh_t*)Mem_Alloc(nummeshes * sizeof(md5mesh_t));
-}
-
-static md5bound_t *Mem_AllocMD5Bound(int numbounds)
-{
-	return (md5bound_t*)Mem_Alloc(numbounds * sizeof(md5bound_t));
-}
-
-static md5animframe_t *Mem_AllocMD5AnimFrame(int numanimframes)
-{
-	return (md5animframe_t*)Mem_Alloc(numanimframes * sizeof(md5animframe_t));
-}
-
-static md5anim_t *Mem_AllocMD5Anim(int numanims)
-{
-	return (md5anim_t*)Mem_Alloc(numanims * sizeof(md5anim_t));
-}
-
-// model loading
-static char *meshfilename;
-static char *animfilename;
-
-static float UnsignedIntToFloat(unsigned int u)
-{
-	union uf_t
-	{
-		unsigned int	u;
-		float			f;
-	} uf;
-	
-	uf.u = u;
-	return uf.f;
-}
-
-static unsigned int ReadUnsignedInt(FILE *fp)
-{
-	unsigned int temp;
-	fscanf(fp, "%x", &temp);
-
-	return temp;
-}
-
-// returns a pointer to a static
-static char* ReadToken(FILE *fp)
-{
-	static char buffer[1024];
-
-	fscanf(fp, "%s", buffer);
-	return buffer;
-}
-
-static void Eatline(FILE *fp)
-{
-	while(!feof(fp))
-	{
-		if(fgetc(fp) == '\n')
-			break;
-	}
-}
-
-static char* StripQuotes(char *string)
-{
-	char *src = string;
-	char *dst = string;
-
-	while(*src)
-	{
-		if(*src == '\"')
-		{
-			src++;
-			continue;
-		}
-
-		*dst++ = *src++;
-	}
-
-	*dst = '\0';
-
-	return string;
-}
-
-static char* ReadQuotedString(FILE *fp)
-{
-	static char buffer[1024];
-	fscanf(fp, "%s", buffer);
-
-	StripQuotes(buffer);
-
-	return buffer;
-}
-
-static int ReadInt(FILE *fp)
-{
-	int i = atoi(ReadToken(fp));
-	return i;
-}
-
-static float ReadFloat(FILE *fp)
-{
-	float f = (float)atof(ReadToken(fp));
-	return f;
-}
-
-// ======================================================================================
-// Mesh files
-
-static float ComputeQuatW(md5joint_t *j)
-{
-	//float t = 1.0f - (j->q[0] * j->q[0]) - (j->q[1] * j->q[1]) - (j->q[2] * j->q[2]);
-	//return (t < 0 ? 0.0 : -sqrtf(t));
-
-	return -sqrtf( fabs( 1.0f - (j->q[0] * j->q[0] + j->q[1] * j->q[1] + j->q[2] * j->q[2])));
-}
-
-static void ReadJoint(FILE * fp, md5joint_t *j)
-{
-	j->name = Mem_AllocString(ReadQuotedString(fp));
-	j->parentindex = ReadInt(fp);
-	ReadToken(fp); // (
-	j->p[0] = ReadFloat(fp);
-	j->p[1] = ReadFloat(fp);
-	j->p[2] = ReadFloat(fp);
-	ReadToken(fp);	// )
-	ReadToken(fp);	// (
-	j->q[0] = ReadFloat(fp);
-	j->q[1] = ReadFloat(fp);
-	j->q[2] = ReadFloat(fp);
-	j->q[3] = ComputeQuatW(j);
-	ReadToken(fp);	//
-	
-	// eat the rest of the line
-	Eatline(fp);
-}
-
-static void ReadJoints(FILE *fp)
-{
-	ReadToken(fp);	//	{
-
-	for(int i = 0; i < md5model->numjoints; i++)
-	{
-		md5joint_t *j = md5model->joints + i;
-
-		j->name = Mem_AllocString(ReadQuotedString(fp));
-		j->parentindex = ReadInt(fp);
-		ReadToken(fp); // (
-		j->p[0] = ReadFloat(fp);
-		j->p[1] = ReadFloat(fp);
-		j->p[2] = ReadFloat(fp);
-		ReadToken(fp);	// )
-		ReadToken(fp);	// (
-		j->q[0] = ReadFloat(fp);
-		j->q[1] = ReadFloat(fp);
-		j->q[2] = ReadFloat(fp);
-		j->q[3] = ComputeQuatW(j);
-		ReadToken(fp);	// )
-		
-		// eat the rest of the line
-		Eatline(fp);
-	}
-
-	ReadToken(fp);	// }
-}
-
-static void ReadVertex(FILE *fp, md5vertex_t *v)
-{
-	v->texcoords[0]		= ReadFloat(fp);
-	v->texcoords[1]		= ReadFloat(fp);
-	v->firstweight		= ReadInt(fp);
-	v->numweights		= ReadInt(fp);
-}
-
-static void ReadTri(FILE *fp, md5tri_t *t)
-{
-	t->indicies[0]		= ReadInt(fp);
-	t->indicies[1]		= ReadInt(fp);
-	t->indicies[2]		= ReadInt(fp);
-}
-
-static void ReadWeight(FILE *fp, md5weight_t *w)
-{
-	w->joint		= ReadInt(fp);
-	w->weight		= ReadFloat(fp);
-	ReadToken(fp);
-	w->xyz[0]		= ReadFloat(fp);
-	w->xyz[1]		= ReadFloat(fp);
-	w->xyz[2]		= ReadFloat(fp);
-	ReadToken(fp);
-}
-
-static void ReadMesh(FILE* fp)
-{
-	md5mesh_t *md5mesh = Mem_AllocMD5Mesh(1);
-
-	// link the mesh into the list
-	md5mesh->next = md5model->meshes;
-	md5model->meshes = md5mesh;
-
-	while(1)
-	{
-		char *token = ReadToken(fp);
-
-		if(!strcmp(token, "numverts"))
-		{
-			md5mesh->numvertices = ReadInt(fp);
-			md5mesh->vertices = Mem_AllocMD5Vertex(md5mesh->numvertices);
-		}
-		else if(!strcmp(token, "numtris"))
-		{
-			md5mesh->numtris = ReadInt(fp);
-			md5mesh->tris = Mem_AllocMD5Tri(md5mesh->numtris);
-		}
-		else if(!strcmp(token, "numweights"))
-		{
-			md5mesh->numweights = ReadInt(fp);
-			md5mesh->weights = Mem_AllocMD5Weight(md5mesh->numweights);
-		}
-		else if(!strcmp(token, "vert"))
-		{
-			int i = ReadInt(fp);
-			md5vertex_t *v = md5mesh->vertices + i;
-
-			ReadToken(fp);
-			v->texcoords[0]		= ReadFloat(fp);
-			v->texcoords[1]		= ReadFloat(fp);
-			ReadToken(fp);
-			v->firstweight		= ReadInt(fp);
-			v->numweights		= ReadInt(fp);
-		}
-		else if(!strcmp(token, "tri"))
-		{
-			int i = ReadInt(fp);
-			md5tri_t *t = md5mesh->tris + i;
-
-			t->indicies[0]		= ReadInt(fp);
-			t->indicies[1]		= ReadInt(fp);
-			t->indicies[2]		= ReadInt(fp);
-		}
-		else if(!strcmp(token, "weight"))
-		{
-			int i = ReadInt(fp);
-			md5weight_t *w = md5mesh->weights + i;
-
-			w->joint		= ReadInt(fp);
-			w->weight		= ReadFloat(fp);
-			ReadToken(fp);
-			w->xyz[0]		= ReadFloat(fp);
-			w->xyz[1]		= ReadFloat(fp);
-			w->xyz[2]		= ReadFloat(fp);
-			ReadToken(fp);
-		}
-		else if(!strcmp(token, "}"))
-		{
-			break;
-		}
-	}
-}
-
-static void ReadMD5Model()
-{
-	FILE *fp = fopen(meshfilename, "r");
-	if(!fp)
-	{
-		Error("couldn't open file \"%s\"\n", meshfilename);
-	}
-
-	while(!feof(fp))
-	{
-		char *token = ReadToken(fp);
-
-		if(!strcmp(token, "numJoints"))
-		{
-			md5model->numjoints = ReadInt(fp);
-			md5model->joints = Mem_AllocMD5Joint(md5model->numjoints);
-		}
-		if(!strcmp(token, "numMeshes"))
-		{
-			//md5model->nummeshes = ReadInt(fp);
-			//md5model->meshes = Mem_AllocMD5Mesh(md5model->nummeshes);
-		}
-		if(!strcmp(token, "joints"))
-		{
-			ReadJoints(fp);
-		}
-		else if(!strcmp(token, "mesh"))
-		{
-			ReadMesh(fp);
-		}
-	}
-}
-
-// ======================================================================================
-// Animation files
-
-static void ReadHierarchy(FILE *fp, md5anim_t *md5anim)
-{
-	ReadToken(fp);
-
-	for(int i = 0; i < md5anim->numjoints; i++)
-	{
-		md5joint_t *j = md5anim->joints + i;
-
-		j->name			= Mem_AllocString(ReadQuotedString(fp));
-		j->parentindex	= ReadInt(fp);
-		j->flags		= ReadInt(fp);
-
-		// eat the rest of the line
-		Eatline(fp);
-	}
-}
-
-static void ReadBounds(FILE *fp, md5anim_t *md5anim)
-{
-	if(!md5anim->bounds)
-	{
-		md5anim->bounds = Mem_AllocMD5Bound(md5anim->numframes);
-	}
-
-	ReadToken(fp);
-
-	for(int i = 0; i < md5anim->numframes; i++)
-	{
-		md5bound_t *b = md5anim->bounds + i;
-
-		ReadToken(fp); // (
-		b->min[0] = ReadFloat(fp);
-		b->min[1] = ReadFloat(fp);
-		b->min[2] = ReadFloat(fp);
-		ReadToken(fp);	// )
-		ReadToken(fp);	// (
-		b->max[0] = ReadFloat(fp);
-		b->max[1] = ReadFloat(fp);
-		b->max[2] = ReadFloat(fp);
-		ReadToken(fp);	// )
-	}
-}
-
-static void ReadBaseframe(FILE *fp, md5anim_t *md5anim)
-{
-	ReadToken(fp);
-
-	for(int i = 0; i < md5anim->numjoints; i++)
-	{
-		md5joint_t *j = md5anim->joints + i;
-
-		ReadToken(fp); // (
-		j->p[0] = ReadFloat(fp);
-		j->p[1] = ReadFloat(fp);
-		j->p[2] = ReadFloat(fp);
-		ReadToken(fp);	// )
-		ReadToken(fp);	// (
-		j->q[0] = ReadFloat(fp);
-		j->q[1] = ReadFloat(fp);
-		j->q[2] = ReadFloat(fp);
-		j->q[3] = ComputeQuatW(j);
-		ReadToken(fp);	// )
-	}
-}
-
-static void ReadFrame(FILE *fp, md5anim_t *md5anim)
-{
-	// allocate the framedata if it hasn't already been allocated
-	if(!md5anim->framedata)
-	{
-		md5anim->framedata = (float*)Mem_Alloc(sizeof(float) * md5anim->numframes * md5anim->numanimatedcomponents);
-	}
-
-	int framenum = ReadInt(fp);
-	
-	// setup the frame data structure
-	md5animframe_t *frame = md5anim->frames + framenum;
-	frame->data = framenum * md5anim->numanimatedcomponents + md5anim->framedata;
-
-	ReadToken(fp);
-
-	for(int i = 0; i < md5anim->numanimatedcomponents; i++)
-	{
-		frame->data[i] = ReadFloat(fp);
-	}
-}
-
-static void ReadMD5Anim()
-{
-	md5anim_t *md5anim = Mem_AllocMD5Anim(1);
-	
-	// link the new animation into the list
-	md5anim->next = md5model->anims;
-	md5model->anims = md5anim;
-
-	// open the file
-	FILE *fp = fopen(animfilename, "r");
-	if(!fp)
-	{
-		Error("couldn't open file \"%s\"\n", animfilename);
-	}
-
-	md5anim->name = Mem_AllocString(animfilename);
-
-	while(!feof(fp))
-	{
-		char *token = ReadToken(fp);
-
-		if(!strcmp(token, "numFrames"))
-		{
-			md5anim->numframes = ReadInt(fp);
-			md5anim->frames = Mem_AllocMD5AnimFrame(md5anim->numframes);
-		}
-		else if(!strcmp(token, "numJoints"))
-		{
-			md5anim->numjoints = ReadInt(fp);
-			md5anim->joints = Mem_AllocMD5Joint(md5anim->numjoints);
-		}
-		else if(!strcmp(token, "frameRate"))
-		{
-			md5anim->framerate = ReadInt(fp);
-		}
-		else if(!strcmp(token, "numAnimatedComponents"))
-		{
-			md5anim->numanimatedcomponents = ReadInt(fp);
-		}
-		else if(!strcmp(token, "hierarchy"))
-		{
-			ReadHierarchy(fp, md5anim);
-		}
-		else if(!strcmp(token, "bounds"))
-		{
-			ReadBounds(fp, md5anim);
-		}
-		else if(!strcmp(token, "baseframe"))
-		{
-			ReadBaseframe(fp, md5anim);
-		}
-		else if(!strcmp(token, "frame"))
-		{
-			ReadFrame(fp, md5anim);
-		}
-	}
-}
-
-static void ProcessMD5Files(int argc, char **argv)
-{
-	for(int i = 1; i < argc; i++)
-	{
-		if(strstr(argv[i], ".md5mesh"))
-		{
-			printf("processing file %s...\n", argv[i]);
-			
-			meshfilename = argv[i];
-			md5model = (md5model_t*)Mem_Alloc(sizeof(md5model_t));
-			
-			ReadMD5Model();
-			
-			continue;
-		}
-		if(strstr(argv[i], ".md5anim"))
-		{
-			printf("processing file %s...\n", argv[i]);
-
-			animfilename = argv[i];
-
-			ReadMD5Anim();
-			
-			continue;
-		}
-	}
-}
-
-// Model rendering
-static md5jointmat_t	jointmatlocal[256];
-static md5jointmat_t	jointmatglobal[256];
-
-static void Quat_Copy(float *a, float *b)
-{
-	a[0] = b[0];
-	a[1] = b[1];
-	a[2] = b[2];
-	a[3] = b[3];
-}
-
-static void Quat_Negate(float *a, float *b)
-{
-	a[0] = -b[0];
-	a[1] = -b[1];
-	a[2] = -b[2];
-	a[3] = -b[3];
-}
-
-static float Quat_Dot(float *a, float *b)
-{
-	return (a[0] * b[0]) + (a[1] * b[1]) + (a[2] * b[2]) + (a[3] * b[3]);
-}
-
-static void Quat_Normalize(float *q)
-{
-	float len, invlen;
-
-	len = sqrtf((q[0] * q[0]) + (q[1] * q[1]) + (q[2] * q[2]) + (q[3] * q[3]));
-	invlen = 1.0f / len;
-
-	q[0] *= invlen;
-	q[1] *= invlen;
-	q[2] *= invlen;
-	q[3] *= invlen;
-}
-
-#if 1
-static void Quat_NLerp(float* result, float *from, float *to, float t)
-{
-	float cosom = from[0] * to[0] + from[1] * to[1] + from[2] * to[2] + from[3] * to[3];
-	
-	float scale0 = 1.0f - t;
-	float scale1 = ( cosom > 0.0f ) ? t : -t;
-	
-	result[0] = scale0 * from[0] + scale1 * to[0];
-	result[1] = scale0 * from[1] + scale1 * to[1];
-	result[2] = scale0 * from[2] + scale1 * to[2];
-	result[3] = scale0 * from[3] + scale1 * to[3];
-	
-	float s = 1.0f / sqrtf( result[0] * result[0] + result[1] * result[1] + result[2] * result[2] + result[3] * result[3] );
-	
-	result[0] *= s;
-	result[1] *= s;
-	result[2] *= s;
-	result[3] *= s;
-}
-#endif
-
-#if 0
-static void Quat_NLerp(float* result, float *from, float *to, float t)
-{
-	float dot = Quat_Dot(from, to);
-	if(dot < 0.0f)
-	{
-		Quat_Negate(to, to);
-	}
-
-	result[0] = ((1 - t) * from[0]) + (t * to[0]);
-	result[1] = ((1 - t) * from[1]) + (t * to[1]);
-	result[2] = ((1 - t) * from[2]) + (t * to[2]);
-	result[3] = ((1 - t) * from[3]) + (t * to[3]);
-
-	Quat_Normalize(result);
-}
-#endif
-
-#if 0
-/*
-=====================
-idQuat::Slerp
-
-Spherical linear interpolation between two quaternions.
-=====================
-*/
-idQuat &idQuat::Slerp( float *result, float *from, float *to, float t ) {
-	idQuat	temp;
-	float	omega, cosom, sinom, scale0, scale1;
-
-	/*
-	if(t <= 0.0f)
-	{
-		Quat_Copy(result, from);
-		return;
-	}
-
-	if(t >= 1.0f)
-	{
-		Quat_Copy(result, to);
-		return;
-	}
-
-	if(from == to)
-	{
-		*this = to;
-		return *this;
-	}
-*/
-
-	cosom = Quat_Dot(from, to);
-	if(cosom < 0.0f)
-	{
-		Quat_Negate(temp, to);
-		cosom = -cosom;
-	}
-	else
-	{
-		Quat_Copy(temp, to);
-	}
-
-	if((1.0f - cosom) > 1e-6f)
-	{
-#if 0
-		omega = acos( cosom );
-		sinom = 1.0f / sin( omega );
-		scale0 = sin( ( 1.0f - t ) * omega ) * sinom;
-		scale1 = sin( t * omega ) * sinom;
-#else
-		scale0 = 1.0f - cosom * cosom;
-		sinom = idMath::InvSqrt( scale0 );
-		omega = idMath::ATan16( scale0 * sinom, cosom );
-		scale0 = idMath::Sin16( ( 1.0f - t ) * omega ) * sinom;
-		scale1 = idMath::Sin16( t * omega ) * sinom;
-#endif
-	} else {
-		scale0 = 1.0f - t;
-		scale1 = t;
-	}
-
-	*this = ( scale0 * from ) + ( scale1 * temp );
-	return *this;
-}
-#endif
-
-static void JointMakeIdentity(md5jointmat_t *m)
-{
-	m->m[0][0] = 1.0f; m->m[0][1] = 0.0f; m->m[0][2] = 0.0f; m->m[0][3] = 0.0f;
-	m->m[1][0] = 0.0f; m->m[1][1] = 1.0f; m->m[1][2] = 0.0f; m->m[1][3] = 0.0f;
-	m->m[2][0] = 0.0f; m->m[2][1] = 0.0f; m->m[2][2] = 1.0f; m->m[2][3] = 0.0f;
-}
-
-#if 0
-static void JointToMatrix(md5jointmat_t *m, md5joint_t *j)
-{
-	float	wx, wy, wz;
-	float	xx, yy, yz;
-	float	xy, xz, zz;
-	float	x2, y2, z2;
-
-	x2 = j->q[0] + j->q[0];
-	y2 = j->q[1] + j->q[1];
-	z2 = j->q[2] + j->q[2];
-
-	xx = j->q[0] * x2;
-	xy = j->q[0] * y2;
-	xz = j->q[0] * z2;
-
-	yy = j->q[1] * y2;
-	yz = j->q[1] * z2;
-	zz = j->q[2] * z2;
-
-	wx = j->q[3] * x2;
-	wy = j->q[3] * y2;
-	wz = j->q[3] * z2;
-
-	m->m[0][0] = 1.0f - (yy + zz);
-	m->m[0][1] = (xy - wz);
-	m->m[0][2] = (xz + wy);
-	m->m[0][3] = j->p[0];
-
-	m->m[1][0] = (xy + wz);
-	m->m[1][1] = 1.0f - (xx + zz);
-	m->m[1][2] = (yz - wx);
-	m->m[1][3] = j->p[1];
-
-	m->m[2][0] = (xz - wy);
-	m->m[2][1] = (yz + wx);
-	m->m[2][2] = 1.0f - (xx + yy);
-	m->m[2][3] = j->p[2];
-}
-#endif
-
-#if 1
-static void JointToMatrix(md5jointmat_t *m, md5joint_t *j)
-{
-	float xx, xy, xz, xw;
-	float yy, yz, yw;
-	float zz, zw;
-
-	xx = j->q[0] * j->q[0];
-	xy = j->q[0] * j->q[1];
-	xz = j->q[0] * j->q[2];
-	xw = j->q[0] * j->q[3];
-
-	yy = j->q[1] * j->q[1];
-	yz = j->q[1] * j->q[2];
-	yw = j->q[1] * j->q[3];
-
-	zz = j->q[2] * j->q[2];
-	zw = j->q[2] * j->q[3];
-
-	m->m[0][0] = 1.0f - 2.0f * (yy + zz);
-	m->m[0][1] = 2.0f * (xy - zw);
-	m->m[0][2] = 2.0f * (xz + yw);
-	m->m[0][3] = j->p[0];
-
-	m->m[1][0] = 2.0f * (xy + zw);
-	m->m[1][1] = 1.0f - 2.0f * (xx + zz);
-	m->m[1][2] = 2.0f * (yz - xw);
-	m->m[1][3] = j->p[1];
-
-	m->m[2][0] = 2.0f * (xz - yw);
-	m->m[2][1] = 2.0f * (yz + xw);
-	m->m[2][2] = 1.0f - 2.0f * (xx + yy);
-	m->m[2][3] = j->p[2];
-}
-#endif
-
-static void JointMatrixMul(md5jointmat_t *c, md5jointmat_t *a, md5jointmat_t *b)
-{
-	c->m[0][0] = a->m[0][0] * b->m[0][0] + a->m[0][1] * b->m[1][0] + a->m[0][2] * b->m[2][0];
-	c->m[0][1] = a->m[0][0] * b->m[0][1] + a->m[0][1] * b->m[1][1] + a->m[0][2] * b->m[2][1];
-	c->m[0][2] = a->m[0][0] * b->m[0][2] + a->m[0][1] * b->m[1][2] + a->m[0][2] * b->m[2][2];
-	c->m[0][3] = a->m[0][0] * b->m[0][3] + a->m[0][1] * b->m[1][3] + a->m[0][2] * b->m[2][3] + a->m[0][3];
-
-	c->m[1][0] = a->m[1][0] * b->m[0][0] + a->m[1][1] * b->m[1][0] + a->m[1][2] * b->m[2][0];
-	c->m[1][1] = a->m[1][0] * b->m[0][1] + a->m[1][1] * b->m[1][1] + a->m[1][2] * b->m[2][1];
-	c->m[1][2] = a->m[1][0] * b->m[0][2] + a->m[1][1] * b->m[1][2] + a->m[1][2] * b->m[2][2];
-	c->m[1][3] = a->m[1][0] * b->m[0][3] + a->m[1][1] * b->m[1][3] + a->m[1][2] * b->m[2][3] + a->m[1][3];
-
-	c->m[2][0] = a->m[2][0] * b->m[0][0] + a->m[2][1] * b->m[1][0] + a->m[2][2] * b->m[2][0];
-	c->m[2][1] = a->m[2][0] * b->m[0][1] + a->m[2][1] * b->m[1][1] + a->m[2][2] * b->m[2][1];
-	c->m[2][2] = a->m[2][0] * b->m[0][2] + a->m[2][1] * b->m[1][2] + a->m[2][2] * b->m[2][2];
-	c->m[2][3] = a->m[2][0] * b->m[0][3] + a->m[2][1] * b->m[1][3] + a->m[2][2] * b->m[2][3] + a->m[2][3];
-}
-
-static void JointVertexMul(float *c, md5jointmat_t *m, float *v)
-{
-	c[0] = m->m[0][0] * v[0] + m->m[0][1] * v[1] + m->m[0][2] * v[2] + m->m[0][3];
-	c[1] = m->m[1][0] * v[0] + m->m[1][1] * v[1] + m->m[1][2] * v[2] + m->m[1][3];
-	c[2] = m->m[2][0] * v[0] + m->m[2][1] * v[1] + m->m[2][2] * v[2] + m->m[2][3];
-}
-
-static void PrintMatrix(md5jointmat_t *m)
-{
-	printf("\n");
-	printf("%3.6f, %3.6f, %3.6f, %3.6f\n", m->m[0][0], m->m[0][1], m->m[0][2], m->m[0][3]);
-	printf("%3.6f, %3.6f, %3.6f, %3.6f\n", m->m[1][0], m->m[1][1], m->m[1][2], m->m[1][3]);
-	printf("%3.6f, %3.6f, %3.6f, %3.6f\n", m->m[2][0], m->m[2][1], m->m[2][2], m->m[2][3]);
-}
-
-static void PrintJoint(md5joint_t *j)
-{
-	printf("joint (%3.6f, %3.6f, %3.6f) (%3.6f, %3.6f, %3.6f %3.6f)\n",
-		j->p[0], j->p[1], j->p[2],
-		j->q[0], j->q[1], j->q[2], j->q[3]);
-}
-
-static void ComputeGlobalMatrix(md5jointmat_t *m, int jointindex, md5joint_t *joints)
-{
-	JointMakeIdentity(m);
-
-	while(jointindex != -1)
-	{
-		md5jointmat_t temp, localjointmat;
-
-		JointToMatrix(&localjointmat, &joints[jointindex]);
-
-		// take the joint and right multiply into the result
-		JointMatrixMul(&temp, &localjointmat, m);
-		*m = temp;	// fixme: take local copies so the original can be overwritten
-		
-		// get the next joint in the heirarchy
-		jointindex = joints[jointindex].parentindex;
-	}
-}
-
-static void ComputeLocalMatrices(md5jointmat_t *matrices, md5joint_t *joints, int numjoints)
-{
-	for(int i = 0; i < numjoints; i++)
-	{
-		JointToMatrix(&matrices[i], &joints[i]);
-	}
-}
-
-static void ComputeGlobalMatrices(md5jointmat_t *matrices, md5joint_t *joints, int numjoints)
-{
-	for(int i = 0; i < numjoints; i++)
-	{
-		ComputeGlobalMatrix(&matrices[i], i, joints);
-	}
-}
-
-static void ComputeFrameJoints(md5joint_t *joints, md5anim_t *anim, int frame)
-{
-	md5animframe_t *animframe = &anim->frames[frame];
-
-	float *framedata = animframe->data;
-
-	for(int i = 0; i < anim->numjoints; i++)
-	{
-		md5joint_t *j = &joints[i];
-		
-		// copy the base frame joint data
-		*j = anim->joints[i];
-
-		// copy the baseframe values
-		j->name			= anim->joints[i].name;
-		j->parentindex	= anim->joints[i].parentindex;
-		j->flags		= anim->joints[i].flags;
-		j->p[0]			= anim->joints[i].p[0];
-		j->p[1]			= anim->joints[i].p[1];
-		j->p[2]			= anim->joints[i].p[2];
-		j->q[0]			= anim->joints[i].q[0];
-		j->q[1]			= anim->joints[i].q[1];
-		j->q[2]			= anim->joints[i].q[2];
-
-		// modify the baseframes values with the frame values
-		if(j->flags & MD5_ANIM_TX)
-		{
-			j->p[0] = *framedata;
-			framedata++;
-		}
-		if(j->flags & MD5_ANIM_TY)
-		{
-			j->p[1] = *framedata;
-			framedata++;
-		}
-		if(j->flags & MD5_ANIM_TZ)
-		{
-			j->p[2] = *framedata;
-			framedata++;
-		}
-		if(j->flags & MD5_ANIM_QX)
-		{
-			j->q[0] = *framedata;
-			framedata++;
-		}
-		if(j->flags & MD5_ANIM_QY)
-		{
-			j->q[1] = *framedata;
-			framedata++;
-		}
-		if(j->flags & MD5_ANIM_QZ)
-		{
-			j->q[2] = *framedata;
-			framedata++;
-		}
-
-		j->q[3] = ComputeQuatW(j);
-
-		// don't offset the base joint
-		if(i == 0)
-		{
-			j->p[0] = j->p[1] = j->p[2]= 0.0f;
-		}
-	}
-}
-
-static void LerpJoints(md5joint_t* result, md5joint_t* from, md5joint_t *to, float t, int numjoints)
-{
-	for(int i = 0; i < numjoints; i++)
-	{
-		// sigh...
-		result[i].parentindex = from[i].parentindex;
-
-		Vector_Lerp(result[i].p, from[i].p, to[i].p, t);
-		Quat_NLerp(result[i].q, from[i].q, to[i].q, t);
-	}
-}
-
-static void PrintJointList(md5joint_t *joints, int numjoints)
-{
-	for(int i = 0; i < numjoints; i++)
-	{
-		if(i != 62)
-			continue;
-		PrintJoint(&joints[i]);
-	}
-}
-
-static void PrintMatrixList(md5jointmat_t *matrices, int nummatrices)
-{
-	for(int i = 0; i < nummatrices; i++)
-	{
-		if(i != 62)
-			continue;
-
-		PrintMatrix(&matrices[i]);
-	}
-}
-
-static void DrawVector(float *origin, float *dir)
-{
-	float s = 2.0f;
-
-	glBegin(GL_LINES);
-	{
-		glVertex3f(origin[0], origin[1], origin[2]);
-		glVertex3f(s * dir[0] + origin[0], s * dir[1] + origin[1], s * dir[2] + origin[2]);
-	}
-	glEnd();
-}
-
-static void DrawMatrix(md5jointmat_t *matrix)
-{
-	float vectors[4][3] =
-	{
-		{ matrix->m[0][0], matrix->m[1][0], matrix->m[2][0] },
-		{ matrix->m[0][1], matrix->m[1][1], matrix->m[2][1] },
-		{ matrix->m[0][2], matrix->m[1][2], matrix->m[2][2] },
-		{ matrix->m[0][3], matrix->m[1][3], matrix->m[2][3] },
-	};
-
-	glColor3f(1, 0, 0);
-	DrawVector(vectors[3], vectors[0]);
-	glColor3f(0, 1, 0);
-	DrawVector(vectors[3], vectors[1]);
-	glColor3f(0, 0, 1);
-	DrawVector(vectors[3], vectors[2]);
-}
-
-static void RenderHierarchy(md5joint_t *joints, int numjoints)
-{
-	glDisable(GL_DEPTH_TEST);
-
-	// draw the vectors
-	{
-		for(int i = 0; i < numjoints; i++)
-		{
-			md5jointmat_t jointmat;
-
-			//JointToMatrix(&jointmat, &joints[i]);
-			ComputeGlobalMatrix(&jointmat, i, joints);
-
-			DrawMatrix(&jointmat);
-		}
-	}
-
-	// draw the skeleton
-	{
-		glBegin(GL_LINES);
-		for(int i = 0; i < numjoints; i++)
-		{
-			if(joints[i].parentindex == -1)
-				continue;
-
-			md5jointmat_t jointmat;
-			//JointToMatrix(&jointmat, &joints[i]);
-			ComputeGlobalMatrix(&jointmat, i, joints);
-
-			md5jointmat_t parentmat;
-			//JointToMatrix(&parentmat, &joints[joints[i].parentindex]);
-			ComputeGlobalMatrix(&parentmat, joints[i].parentindex, joints);
-
-			glColor3f(1, 1, 1);
-			glVertex3f(jointmat.m[0][3], jointmat.m[1][3], jointmat.m[2][3]);
-			glVertex3f(parentmat.m[0][3], parentmat.m[1][3], parentmat.m[2][3]);
-		}
-		glEnd();
-	}
-
-	glEnable(GL_DEPTH_TEST);
-}
-
-typedef struct drawvert_s
-{
-	float	xyz[3];
-	float	normal[3];
-	float	tangent[2][3];
-	float	texcoord[2];
-	float	color[3];
-
-} drawvert_t;
-
-typedef struct drawsurf_s
-{
-	drawvert_t		vertexbuffer[4096];
-	int				numvertices;
-	unsigned int	indexbuffer[8192];
-	int				numindicies;
-
-} drawsurf_t;
-
-static drawsurf_t trisurf;
-
-static void ComputeNormalsAndTangents(drawsurf_t *surf)
-{
-	int i;
-
-	for(i = 0; i < surf->numvertices; i++)
-	{
-		drawvert_t *v = surf->vertexbuffer + i;
-
-		v->normal[0] = v->normal[1] = v->normal[2] = 0.0f;
-		v->tangent[0][0] = v->tangent[0][1] = v->tangent[0][2] = 0.0f;
-		v->tangent[1][0] = v->tangent[1][1] = v->tangent[1][2] = 0.0f;
-	}
-
-	for(i = 0; i < surf->numindicies; i += 3)
-	{
-		// get the three vertices for the triangle
-		drawvert_t *a = surf->vertexbuffer + surf->indexbuffer[i + 0];
-		drawvert_t *b = surf->vertexbuffer + surf->indexbuffer[i + 1];
-		drawvert_t *c = surf->vertexbuffer + surf->indexbuffer[i + 2];
-
-		// compute direction vectors
-		float d0[5];
-		d0[0] = b->xyz[0] - a->xyz[0];
-		d0[1] = b->xyz[1] - a->xyz[1];
-		d0[2] = b->xyz[2] - a->xyz[2];
-		d0[3] = b->texcoord[0] - a->texcoord[0];
-		d0[4] = b->texcoord[1] - a->texcoord[1];
-		
-		float d1[5];
-		d1[0] = c->xyz[0] - a->xyz[0];
-		d1[1] = c->xyz[1] - a->xyz[1];
-		d1[2] = c->xyz[2] - a->xyz[2];
-		d1[3] = c->texcoord[0] - a->texcoord[0];
-		d1[4] = c->texcoord[1] - a->texcoord[1];
-		
-		// calculate normal
-		float normal[3];
-		normal[0] = d1[1] * d0[2] - d1[2] * d0[1];
-		normal[1] = d1[2] * d0[0] - d1[0] * d0[2];
-		normal[2] = d1[0] * d0[1] - d1[1] * d0[0];
-
-		const float f0 = 1.0f / sqrtf( normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2] );
-		
-		normal[0] *= f0;
-		normal[1] *= f0;
-		normal[2] *= f0;
-
-		// texture area sign bit
-		const float area = d0[3] * d1[4] - d0[4] * d1[3];
-		unsigned int signbit = ( *( unsigned int* )&area ) & ( 1 << 31 );
-		
-		// calculate tangents
-		float tangent[3];
-		tangent[0] = d0[0] * d1[4] - d0[4] * d1[0];
-		tangent[1] = d0[1] * d1[4] - d0[4] * d1[1];
-		tangent[2] = d0[2] * d1[4] - d0[4] * d1[2];
-		
-		const float f1 = 1.0f / sqrtf( tangent[0] * tangent[0] + tangent[1] * tangent[1] + tangent[2] * tangent[2] );
-		*( unsigned int* )&f1 ^= signbit;
-		
-		tangent[0] *= f1;
-		tangent[1] *= f1;
-		tangent[2] *= f1;
-		
-		float bitangent[3];
-		bitangent[0] = d0[3] * d1[0] - d0[0] * d1[3];
-		bitangent[1] = d0[3] * d1[1] - d0[1] * d1[3];
-		bitangent[2] = d0[3] * d1[2] - d0[2] * d1[3];
-		
-		const float f2 = 1.0f / sqrtf( bitangent[0] * bitangent[0] + bitangent[1] * bitangent[1] + bitangent[2] * bitangent[2] );
-		*( unsigned int* )&f2 ^= signbit;
-		
-		bitangent[0] *= f2;
-		bitangent[1] *= f2;
-		bitangent[2] *= f2;
-
-		// add the normals and tangents to the vertices
-		a->normal[0] += normal[0];
-		a->normal[1] += normal[1];
-		a->normal[2] += normal[2];
-		a->tangent[0][0] += tangent[0];
-		a->tangent[0][1] += tangent[1];
-		a->tangent[0][2] += tangent[2];
-		a->tangent[1][0] += bitangent[0];
-		a->tangent[1][1] += bitangent[1];
-		a->tangent[1][2] += bitangent[2];
-
-		b->normal[0] += normal[0];
-		b->normal[1] += normal[1];
-		b->normal[2] += normal[2];
-		b->tangent[0][0] += tangent[0];
-		b->tangent[0][1] += tangent[1];
-		b->tangent[0][2] += tangent[2];
-		b->tangent[1][0] += bitangent[0];
-		b->tangent[1][1] += bitangent[1];
-		b->tangent[1][2] += bitangent[2];
-
-		c->normal[0] += normal[0];
-		c->normal[1] += normal[1];
-		c->normal[2] += normal[2];
-		c->tangent[0][0] += tangent[0];
-		c->tangent[0][1] += tangent[1];
-		c->tangent[0][2] += tangent[2];
-		c->tangent[1][0] += bitangent[0];
-		c->tangent[1][1] += bitangent[1];
-		c->tangent[1][2] += bitangent[2];
-	}
-
-	// normalize the per-vertex normals and tangents
-	for(i = 0; i < surf->numvertices; i++)
-	{
-		drawvert_t *v = surf->vertexbuffer + i;
-
-		const float f0 = 1.0f / sqrtf( v->normal[0] * v->normal[0] + v->normal[1] * v->normal[1] + v->normal[2] * v->normal[2] );
-
-		v->normal[0] *= f0;
-		v->normal[1] *= f0;
-		v->normal[2] *= f0;
-
-		const float f1 = 1.0f / sqrtf( v->tangent[0][0] * v->tangent[0][0] + v->tangent[0][1] * v->tangent[0][1] + v->tangent[0][2] * v->tangent[0][2] );
-
-		v->tangent[0][0] *= f1;
-		v->tangent[0][1] *= f1;
-		v->tangent[0][2] *= f1;
-
-		const float f2 = 1.0f / sqrtf( v->tangent[1][0] * v->tangent[1][0] + v->tangent[1][1] * v->tangent[1][1] + v->tangent[1][2] * v->tangent[1][2] );
-
-		v->tangent[1][0] *= f2;
-		v->tangent[1][1] *= f2;
-		v->tangent[1][2] *= f2;
-	}
-}
-
-static void BuildIndexBuffer(drawsurf_t *surf, md5mesh_t *mesh)
-{
-	surf->numindicies = 0;
-	unsigned int *indicies = surf->indexbuffer;
-	
-	for(int i = 0; i < mesh->numtris; i++)
-	{
-		indicies[0] = mesh->tris[i].indicies[0];
-		indicies[1] = mesh->tris[i].indicies[1];
-		indicies[2] = mesh->tris[i].indicies[2];
-		indicies += 3;
-		surf->numindicies += 3;
-	}
-}
-
-static void ComputeVertexColors(drawsurf_t *surf)
-{
-	for(int i = 0; i < surf->numvertices; i++)
-	{
-		drawvert_t *v = surf->vertexbuffer + i;
-
-		v->color[0] = 0.5f + 0.5f * v->normal[0];
-		v->color[1] = 0.5f + 0.5f * v->normal[1];
-		v->color[2] = 0.5f + 0.5f * v->normal[2];
-	}
-}
-
-static void DrawNormals(drawsurf_t *surf)
-{
-	glBegin(GL_LINES);
-	{
-		for(int i = 0; i < surf->numvertices; i++)
-		{
-			drawvert_t *v = surf->vertexbuffer + i;
-			
-			glColor3f(1, 0, 0);
-			DrawVector(v->xyz, v->tangent[0]);
-
-			glColor3f(0, 1, 0);
-			DrawVector(v->xyz, v->tangent[1]);
-
-			glColor3f(0, 0, 1);
-			DrawVector(v->xyz, v->normal);
-		}
-	}
-	glEnd();
-}
-
-
-static void BuildVertexBuffer(drawsurf_t *surf, md5mesh_t *mesh, md5joint_t *joints)
-{
-	surf->numvertices = mesh->numvertices;
-
-	for(int i = 0; i < mesh->numvertices; i++)
-	{
-		md5vertex_t *v = &mesh->vertices[i];
-
-		// sum all the weights that affect this vertex
-		// multiply the weights by the matrix
-		float blendedvertex[3];
-		blendedvertex[0] = blendedvertex[1] = blendedvertex[2] = 0.0f;
-		for(int j = v->firstweight; j < v->firstweight + v->numweights; j++)
-		{
-			md5jointmat_t jointmat;
-			ComputeGlobalMatrix(&jointmat, mesh->weights[j].joint, joints);
-
-			float temp[3];
-			JointVertexMul(temp, &jointmat, mesh->weights[j].xyz);
-
-			// add this vertex to the total
-			blendedvertex[0] += mesh->weights[j].weight * temp[0];
-			blendedvertex[1] += mesh->weights[j].weight * temp[1];
-			blendedvertex[2] += mesh->weights[j].weight * temp[2];
-		}
-
-		surf->vertexbuffer[i].xyz[0] = blendedvertex[0];
-		surf->vertexbuffer[i].xyz[1] = blendedvertex[1];
-		surf->vertexbuffer[i].xyz[2] = blendedvertex[2];
-		surf->vertexbuffer[i].texcoord[0] = v->texcoords[0];
-		surf->vertexbuffer[i].texcoord[1] = v->texcoords[1];
-		//surf->vertexbuffer[i].color[0] = surf->vertexbuffer[i].texcoord[0];
-		//surf->vertexbuffer[i].color[1] = surf->vertexbuffer[i].texcoord[1];
-		//surf->vertexbuffer[i].color[2] = 0.0f;
-		surf->vertexbuffer[i].color[0] = 0.5f + 0.5f * surf->vertexbuffer[i].normal[0];
-		surf->vertexbuffer[i].color[1] = 0.5f + 0.5f * surf->vertexbuffer[i].normal[1];
-		surf->vertexbuffer[i].color[2] = 0.5f + 0.5f * surf->vertexbuffer[i].normal[2];
-	}
-}
-
-static void RenderGeometry(md5joint_t *joints)
-{
-	for(md5mesh_t *mesh = md5model->meshes; mesh; mesh = mesh->next)
-	{
-		BuildIndexBuffer(&trisurf, mesh);
-
-		BuildVertexBuffer(&trisurf, mesh, joints);
-
-		// These should be seperate to the other two
-		ComputeNormalsAndTangents(&trisurf);
-		ComputeVertexColors(&trisurf);
-
-		//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-		glEnableClientState(GL_VERTEX_ARRAY);
-		glEnableClientState(GL_COLOR_ARRAY);
-
-		glVertexPointer(3, GL_FLOAT, sizeof(drawvert_t), trisurf.vertexbuffer->xyz);
-		glColorPointer(3, GL_FLOAT, sizeof(drawvert_t), trisurf.vertexbuffer->color);
-		glDrawElements(GL_TRIANGLES, trisurf.numindicies, GL_UNSIGNED_INT, trisurf.indexbuffer);
-
-		glDisableClientState(GL_VERTEX_ARRAY);
-		glDisableClientState(GL_COLOR_ARRAY);
-
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-
-		DrawNormals(&trisurf);
-	}
-}
-
-// frame joints and matrices
-static md5joint_t	framejoints[256];
-static md5jointmat_t	framemats[256];
-static md5joint_t	framejoints2[2][256];
-// static currentanim
-
-// fixme: fill this out. all anim crap should go in here
-typedef struct animstate_s
-{
-
-} animstate_t;
-
-static void JointTest()
-{
-	//ComputeFrameJoints(framejoints, &md5model->anims[0], framenum % md5model->anims[0].numframes);
-	//PrintJointList(framejoints, md5model->numjoints);
-	float time = framenum * 0.032f;
-	float animtime = time * 6; //md5model->anims[0].framerate;
-	int frame0 = (int)floor(animtime) % md5model->anims[0].numframes;
-	int frame1 = (frame0 + 1) % md5model->anims[0].numframes;
-	float lerp = animtime - floor(animtime);
-
-	//if(frame0 > md5model->anims[0].numframes)
-	//	frame0 = md5model->anims[0].numframes - 1;
-	//if(frame1 > md5model->anims[0].numframes)
-	//	frame1 = md5model->anims[0].numframes - 1;
-	//frame0 = framenum % md5model->anims[0].numframes;
-	//frame1 = (framenum + 1) % md5model->anims[0].numframes;
-
-	//if(frame0 == 17)
-	//{
-	//	frame0 = 17;
-	//	frame1 = 19;
-	//}
-	//frame0 = 19; frame1 = 20;
-	//lerp = 0.0f;
-	
-	ComputeFrameJoints(framejoints2[0], &md5model->anims[0], frame0);
-
-	ComputeFrameJoints(framejoints2[1], &md5model->anims[0], frame1);
-
-	LerpJoints(framejoints, framejoints2[0], framejoints2[1], lerp, md5model->anims[0].numjoints);
-
-	//printf("frame %i\n", frame0);
-	//PrintJointList(framejoints2[0], md5model->anims[0].numjoints);
-	//PrintJointList(framejoints2[1], md5model->anims[0].numjoints);
-	//PrintJointList(framejoints, md5model->anims[0].numjoints);
-
-	RenderGeometry(framejoints);
-
-	RenderHierarchy(framejoints, md5model->numjoints);
-}
-
-//==============================================
-// simulation code
-
-static float viewangles[2];
-static float viewpos[3];
-static float viewvectors[3][3];
-
-typedef struct tickcmd_s
-{
-	float	forwardmove;
-	float	sidemove;
-	float	anglemove[2];
-
-} tickcmd_t;
-
-static tickcmd_t gcmd;
-
-// This must be part of game state or else movement becomes dependent on the rendering
-static void VectorsFromSphericalAngles(float vectors[3][3], float angles[2])
-{
-	float cx, sx, cy, sy, cz, sz;
-
-	cx = 1.0f;
-	sx = 0.0f;
-	cy = cosf(angles[0]);
-	sy = sinf(angles[0]);
-	cz = cosf(angles[1]);
-	sz = sinf(angles[1]);
-
-	vectors[0][0] = cy * cz;
-	vectors[0][1] = sz;
-	vectors[0][2] = -sy * cz;
-
-	vectors[1][0] = (-cx * cy * sz) + (sx * sy);
-	vectors[1][1] = cx * cz;
-	vectors[1][2] = (cx * sy * sz) + (sx * cy);
-
-	vectors[2][0] = (sx * cy * sz) + (cx * sy);
-	vectors[2][1] = (-sx * cz);
-	vectors[2][2] = (-sx * sy * sz) + (cx * cy);
-}
-
-// build a current command from the input state
-static void BuildTickCmd()
-{
-	tickcmd_t *cmd = &gcmd;
-	float scale;
-	
-	// Move forward ~512 units each second (60 * 4.2)
-	scale = 4.2f;
-
-	cmd->forwardmove = 0.0f;
-	cmd->sidemove = 0.0f;
-	cmd->anglemove[0] = 0.0f;
-	cmd->anglemove[1] = 0.0f;
-
-	if(input.keys['w'])
-	{
-		cmd->forwardmove += scale;
-	}
-
-	if(input.keys['s'])
-	{
-		cmd->forwardmove -= scale;
-	}
-
-	if(input.keys['d'])
-	{
-		cmd->sidemove += scale;
-	}
-
-	if(input.keys['a'])
-	{
-		cmd->sidemove -= scale;
-	}
-
-	// Handle mouse movement
-	if(input.lbuttondown)
-	{
-		cmd->anglemove[0] = -0.02f * (float)input.moused[0];
-		cmd->anglemove[1] = -0.02f * (float)input.moused[1];
-	}
-}
-
-// input capture
-static bool		inputcapture = false;
-static bool		inputplayback = false;
-static char*	inputfilename = NULL;
-static FILE*	fpinputcapture;
-static int		numinputswritten;
-static int	inputstartframe;
-static int	inputendframe;
-
-// fixme: how to setup output filename?
-static void BeginInputCapture()
-{
-	fpinputcapture = fopen("input.bin", "wb");
-
-	// capture initial state
-	fwrite(viewpos, sizeof(float), 3, fpinputcapture);
-	fwrite(viewangles, sizeof(float), 2, fpinputcapture);
-
-	numinputswritten = 0;
-}
-
-static void EndInputCapture()
-{
-	fclose(fpinputcapture);
-
-	printf("captured %d inputs\n", numinputswritten);
-}
-
-static void WriteInput()
-{
-	if(!inputcapture)
-		return;
-
-	fwrite(&gcmd, sizeof(tickcmd_t), 1, fpinputcapture);
-
-	numinputswritten++;
-}
-
-// input playback
-static void ReadNextInput()
-{
-	if(!inputplayback)
-		return;
-
-	if(!fpinputcapture)
-	{
-		fpinputcapture = fopen(inputfilename, "rb");
-		fread(viewpos, sizeof(float), 3, fpinputcapture);
-		fread(viewangles, sizeof(float), 2, fpinputcapture);
-		return;
-	}
-
-	fread(&gcmd, sizeof(tickcmd_t), 1, fpinputcapture);
-
-	if(feof(fpinputcapture))
-	{
-		inputplayback = false;
-		fclose(fpinputcapture);
-
-		printf("finished input playback\n");
-	}
-}
-
-// apply the tick command to the viewstate
-static void DoMove()
-{
-	tickcmd_t *cmd = &gcmd;
-
-	VectorsFromSphericalAngles(viewvectors, viewangles);
-
-	viewpos[0] += cmd->forwardmove * viewvectors[0][0];
-	viewpos[1] += cmd->forwardmove * viewvectors[0][1];
-	viewpos[2] += cmd->forwardmove * viewvectors[0][2];
-
-	viewpos[0] += cmd->sidemove * viewvectors[2][0];
-	viewpos[1] += cmd->sidemove * viewvectors[2][1];
-	viewpos[2] += cmd->sidemove * viewvectors[2][2];
-
-	viewangles[0] += cmd->anglemove[0];
-	viewangles[1] += cmd->anglemove[1];
-
-	if(viewangles[1] >= PI / 2.0f)
-		viewangles[1] = (PI / 2.0f) - 0.001f;
-	if(viewangles[1] <= -PI/ 2.0f)
-		viewangles[1] = (-PI / 2.0f) + 0.001f;
-}
-
-static void SetupDefaultViewPos()
-{
-	// look down negative z
-	viewangles[0] = PI / 2.0f;
-	viewangles[1] = 0.0f;
-	
-	viewpos[0] = 0.0f;
-	viewpos[1] = 0.0f;
-	viewpos[2] = 256.0f;
-}
-
-// Advance the state of everything by one frame
-static void Ticker()
-{
-	BuildTickCmd();
-	
-	ReadNextInput();
-
-	WriteInput();
-
-	DoMove();
-}
-
-// Called every frame to process the current mouse input state
-// We only get updates when the mouse moves so the current mouse
-// position is stored and may be used for multiple frames
-static void ProcessInput()
-{
-	// mousepos has current "frame" mouse pos
-	input.moused[0] = mousepos[0] - input.mousepos[0];
-	input.moused[1] = mousepos[1] - input.mousepos[1];
-	input.mousepos[0] = mousepos[0];
-	input.mousepos[1] = mousepos[1];
-}
-
-static void MainLoop()
-{
-	// initialize the base time
-	if(!oldtime)
-	{
-		oldtime = Sys_Milliseconds();
-	}
-
-	int newtime = Sys_Milliseconds();
-	int deltatime = newtime - oldtime;
-	oldtime = newtime;
-
-	// wait until some time has elapsed
-	if(deltatime < 1)
-	{
-		Sys_Sleep(0);
-		return;
-	}
-	
-	ProcessInput();
-
-	// figure out how many tick s to run?
-	// sync frames?
-	if(deltatime > 50)
-		deltatime = 0;
-
-	// update realtime
-	realtime += deltatime;
-
-	// run a tick if enough time has elapsed
-	// should realtime be clamped if we're dropping frames?
-	//if(realtime > framenum * 16)
-	while(realtime > framenum * 16)
-	{
-		framenum++;
-
-		Ticker();
-	}
-
-	// signal a screen redraw (should this be sync'd with simulation updates
-	// or free running?) glutPostRedisplay signals the draw callback to be called
-	// on the next pass through the glutMainLoop
-	// run as fast as possible to capture the mouse movements
-	glutPostRedisplay();
-}
-
-//==============================================
-// OpenGL rendering code
-//
-// this stuff touches some of the simulation state (viewvectors, viewpos etc)
-// guess it should really have an interface to extract that data?
-
-static int renderwidth;
-static int renderheight;
-
-static int rendermode = 0;
-typedef void (*drawfunc_t)();
-
-static void GL_LoadMatrix(float m[4][4])
-{
-	glLoadMatrixf((float*)m);
-}
-
-static void GL_LoadMatrixTranspose(float m[4][4])
-{
-	float t[4][4];
-
-	MatrixTranspose(t, m);
-	glLoadMatrixf((float*)t);
-}
-
-static void GL_MultMatrix(float m[4][4])
-{
-	glMultMatrixf((float*)m);
-}
-
-static void GL_MultMatrixTranspose(float m[4][4])
-{
-	float t[4][4];
-
-	MatrixTranspose(t, m);
-	glMultMatrixf((float*)t);
-}
-
-static void DrawAxis()
-{
-	glBegin(GL_LINES);
-	glColor3f(1, 0, 0);
-	glVertex3f(0, 0, 0);
-	glVertex3f(32, 0, 0);
-
-	glColor3f(0, 1, 0);
-	glVertex3f(0, 0, 0);
-	glVertex3f(0, 32, 0);
-
-	glColor3f(0, 0, 1);
-	glVertex3f(0, 0, 0);
-	glVertex3f(0, 0, 32);
-	glEnd();
-}
-
-static void SetModelViewMatrix()
-{
-	// matrix to transform from look down x to looking down -z
-	static float yrotate[4][4] =
-	{
-		{ 0, 0, 1, 0 },
-		{ 0, 1, 0, 0 },
-		{ -1, 0, 0, 0 },
-		{ 0, 0, 0, 1 }
-	};
-
-	// matrix to convert from doom coordinates to gl coordinates
-	static float doomtogl[4][4] =
-	{
-		{ 1, 0, 0, 0 },
-		{ 0, 0, 1, 0 },
-		{ 0, -1, 0, 0 },
-		{ 0, 0, 0, 1 }
-	};
-
-	float matrix[4][4];
-	matrix[0][0]	= viewvectors[0][0];
-	matrix[0][1]	= viewvectors[0][1];
-	matrix[0][2]	= viewvectors[0][2];
-	matrix[0][3]	= -(viewvectors[0][0] * viewpos[0]) - (viewvectors[0][1] * viewpos[1]) - (viewvectors[0][2] * viewpos[2]);
-
-	matrix[1][0]	= viewvectors[1][0];
-	matrix[1][1]	= viewvectors[1][1];
-	matrix[1][2]	= viewvectors[1][2];
-	matrix[1][3]	= -(viewvectors[1][0] * viewpos[0]) - (viewvectors[1][1] * viewpos[1]) - (viewvectors[1][2] * viewpos[2]);
-
-	matrix[2][0]	= viewvectors[2][0];
-	matrix[2][1]	= viewvectors[2][1];
-	matrix[2][2]	= viewvectors[2][2];
-	matrix[2][3]	= -(viewvectors[2][0] * viewpos[0]) - (viewvectors[2][1] * viewpos[1]) - (viewvectors[2][2] * viewpos[2]);
-
-	matrix[3][0]	= 0.0f;
-	matrix[3][1]	= 0.0f;
-	matrix[3][2]	= 0.0f;
-	matrix[3][3]	= 1.0f;
-
-	glMatrixMode(GL_MODELVIEW);
-	glLoadIdentity();
-	GL_MultMatrixTranspose(yrotate);
-	GL_MultMatrixTranspose(matrix);
-	GL_MultMatrixTranspose(doomtogl);
-}
-
-static void R_SetPerspectiveMatrix(float fov, float aspect, float znear, float zfar)
-{
-	float r, l, t, b;
-	float fovx, fovy;
-	float m[4][4];
-
-	// fixme: move this somewhere else
-	fovx = fov * (3.1415f / 360.0f);
-	float x = (renderwidth / 2.0f) / atan(fovx);
-	fovy = atan2(renderheight / 2.0f, x);
-
-	// Calcuate right, left, top and bottom values
-	r = znear * fovx; //tan(fovx * (3.1415f / 360.0f));
-	l = -r;
-
-	t = znear * fovy; //tan(fovy * (3.1415f / 360.0f));
-	b = -t;
-
-	m[0][0] = (2.0f * znear) / (r - l);
-	m[1][0] = 0;
-	m[2][0] = (r + l) / (r - l);
-	m[3][0] = 0;
-
-	m[0][1] = 0;
-	m[1][1] = (2.0f * znear) / (t - b);
-	m[2][1] = (t + b) / (t - b);
-	m[3][1] = 0;
-
-	m[0][2] = 0;
-	m[1][2] = 0;
-	m[2][2] = -(zfar + znear) / (zfar - znear);
-	m[3][2] = -2.0f * zfar * znear / (zfar - znear);
-
-	m[0][3] = 0;
-	m[1][3] = 0;
-	m[2][3] = -1;
-	m[3][3] = 0;
-
-	glMatrixMode(GL_PROJECTION);
-	GL_LoadMatrix(m);
-}
-
-static void BeginFrame()
-{
-	glClearColor(0.3f, 0.3f, 0.3f, 0.0f);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	glEnable(GL_DEPTH_TEST);
-	glFrontFace(GL_CW);
-	glEnable(GL_CULL_FACE);
-}
-
-static void Draw()
-{
-	BeginFrame();
-
-	SetModelViewMatrix();
-
-	DrawAxis();
-
-	JointTest();
-}
-
-//==============================================
-// GLUT/OS/windowing code
-
-static void DisplayFunc()
-{
-	Draw();
-
-	//if(glGetError() != GL_NO_ERROR)
-	//	Error("Got a GL error\n");
-	//glFlush();
-	//int time1 = Sys_Milliseconds();
-	//printf("preswap: %i\n", time1);
-	glutSwapBuffers();
-	//int time2 = Sys_Milliseconds();
-	//printf("pstswap: %i\n", time2);
-}
-
-static void KeyboardDownFunc(unsigned char key, int x, int y)
-{
-	input.keys[key] = true;
-
-	if(key == 'q')
-	{
-		inputcapture = !inputcapture;
-
-		if(inputcapture)
-		{
-			fprintf(stdout, "Begin input capture\n");
-			BeginInputCapture();
-		}
-		else
-		{
-			fprintf(stdout, "End input capture\n");
-			EndInputCapture();
-		}
-	}
-
-	if(key == 'r')
-	{
-		rendermode++;
-		if(rendermode == 2)
-			rendermode = 0;
-	}
-}
-
-static void KeyboardUpFunc(unsigned char key, int x, int y)
-{
-	input.keys[key] = false;
-}
-
-static void ReshapeFunc(int w, int h)
-{
-	renderwidth = w;
-	renderheight = h;
-
-	R_SetPerspectiveMatrix(90.0f, (float)w / (float)h, 3, 4096.0f);
-
-	glViewport(0, 0, w, h);
-}
-
-static void MouseFunc(int button, int state, int x, int y)
-{
-	if(button == GLUT_LEFT_BUTTON)
-		input.lbuttondown = (state == GLUT_DOWN);
-	if(button == GLUT_RIGHT_BUTTON)
-		input.rbuttondown = (state == GLUT_DOWN);
-}
-
-static void MouseMoveFunc(int x, int y)
-{
-	mousepos[0] = x;
-	mousepos[1] = y;
-}
-
-static void MainLoopFunc()
-{
-	MainLoop();
-}
-
-static void PrintUsage()
-{}
-
-static void ProcessCommandLine(int argc, char *argv[])
-{
-	int i;
-
-	for(i = 1; i < argc; i++)
-	{
-		if(argv[i][0] != '-')
-			break;
-
-		if(!strcmp(argv[i], "--input"))
-		{
-			inputplayback = true;
-			inputfilename = argv[i + i];
-			i++;
-		}
-		else if(!strcmp(argv[i], "--start-frame"))
-		{
-			Error("--start-frame not implemented\n");
-		}
-		else if(!strcmp(argv[i], "--end-frame"))
-		{
-			Error("--end-frame not implemented\n");
-		}
-		else
-		{
-			Error("Unknown option %s\n", argv[i]);
-		}
-	}
-
-	if(i == argc)
-	{
-		Error("No input file\n");
-	}
-}
-
-int main(int argc, char *argv[])
-{
-	glutInit(&argc, argv);
-	
-	glutInitWindowPosition(0, 0);
-	glutInitWindowSize(400, 400);
-	glutInitDisplayMode(GLUT_RGBA | GLUT_DEPTH | GLUT_DOUBLE);
-	glutCreateWindow("test");
-
-	ProcessCommandLine(argc, argv);
-
-	ProcessMD5Files(argc, argv);
-	
-	SetupDefaultViewPos();
-
-	glutReshapeFunc(ReshapeFunc);
-	glutDisplayFunc(DisplayFunc);
-	glutKeyboardFunc(KeyboardDownFunc);
-	glutKeyboardUpFunc(KeyboardUpFunc);
-	glutMouseFunc(MouseFunc);
-	glutMotionFunc(MouseMoveFunc);
-	glutPassiveMotionFunc(MouseMoveFunc);
-	glutIdleFunc(MainLoopFunc);
-	//glutIdleFunc(TimeDemoFunc);
-
-	glutMainLoop();
-
-	return 0;
-}
-
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <locale.h>
+//#include <windows.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#define USE_SIMD
+#endif
+
+// buffer objects are called directly, the driver has to export them
+#define GL_GLEXT_PROTOTYPES
+
+#ifdef WIN32
+#include "freeglut/include/GL/freeglut.h"
+#else
+#include <GL/freeglut.h>
+#endif
+
+#define PI 3.14159265358979323846f
+
+static int oldtime;
+static int realtime;
+static int framenum;
+
+// Input
+typedef struct input_s
+{
+	int mousepos[2];
+	int moused[2];
+	bool lbuttondown;
+	bool rbuttondown;
+	bool keys[256];
+
+} input_t;
+
+static int mousepos[2];
+static input_t input;
+
+
+// ==============================================
+// timing
+
+static unsigned int GetMilliseconds()
+{
+	struct timeval	tp;
+
+	gettimeofday(&tp, NULL);
+
+	return (tp.tv_sec * 1000) + (tp.tv_usec / 1000);
+}
+
+unsigned int Sys_Milliseconds (void)
+{
+	static unsigned int basetime;
+	static unsigned int curtime;
+
+	if (!basetime)
+	{
+		basetime = GetMilliseconds();
+	}
+
+	curtime = GetMilliseconds() - basetime;
+
+	return curtime;
+}
+
+// high resolution timer for profiling, not tied to the Sys_Milliseconds base
+double Sys_Microseconds()
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (ts.tv_sec * 1000000.0) + (ts.tv_nsec / 1000.0);
+}
+
+void Sys_Sleep(unsigned int msecs)
+{
+	usleep(msecs * 1000);
+}
+
+// ==============================================
+// cpu features
+
+#define CPU_SSE2		(1 << 0)
+#define CPU_AVX2		(1 << 1)	// also implies fma
+
+static int cpufeatures;
+
+// features can be masked off from the command line to compare code paths
+static int cpufeaturemask = -1;
+
+static void Sys_DetectCPU()
+{
+	cpufeatures = 0;
+
+#ifdef USE_SIMD
+	cpufeatures |= CPU_SSE2;
+
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+	{
+		cpufeatures |= CPU_AVX2;
+	}
+#endif
+
+	cpufeatures &= cpufeaturemask;
+}
+
+// ==============================================
+// memory allocation
+
+// a stack is a growable list of chunks that allocations are bumped out of.
+// every stack is a scope of its own, a model or anim lives in one and a frame's
+// scratch in another, so each can be reset or released without the others
+
+#define MEM_CHUNK_SIZE		(1024 * 1024)
+#define MEM_HUGE_PAGE_SIZE	(2 * 1024 * 1024)
+#define MEM_DEFAULT_ALIGN	16
+
+typedef struct memchunk_s
+{
+	struct memchunk_s *next;
+	size_t size;			// usable bytes after the header
+	size_t allocated;
+	size_t pad[5];			// keeps the data cache line aligned
+
+} memchunk_t;
+
+typedef struct memstack_s
+{
+	const char *name;
+	memchunk_t *chunks;		// in allocation order, kept over a reset
+	memchunk_t *current;
+	size_t used;			// bytes handed out since the last reset
+	size_t highwater;
+	size_t reserved;		// bytes mapped for chunks
+
+	struct memstack_s *next;
+
+} memstack_t;
+
+static memstack_t mainstack = { "main", NULL, NULL, 0, 0, 0, NULL };
+
+// allocations come from the calling thread's current stack. every thread
+// starts on the main stack, so jobs that allocate must switch to their own
+static __thread memstack_t *memstack = &mainstack;
+
+// all stacks that have been initialised, for reporting
+static memstack_t *memstacks = &mainstack;
+static pthread_mutex_t memstackslock = PTHREAD_MUTEX_INITIALIZER;
+
+static bool memhugepages;
+static bool memstats;
+
+// chunks mapped so far by every stack, for catching allocations in places
+// that shouldn't make any
+static int memnumchunks;
+
+static memchunk_t *Mem_AllocChunk(size_t numbytes)
+{
+	size_t size = numbytes + sizeof(memchunk_t);
+	size_t granularity = memhugepages ? MEM_HUGE_PAGE_SIZE : MEM_CHUNK_SIZE;
+
+	if(size < MEM_CHUNK_SIZE)
+	{
+		size = MEM_CHUNK_SIZE;
+	}
+	size = (size + granularity - 1) & ~(granularity - 1);
+
+	void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(mem == MAP_FAILED)
+	{
+		printf("Error: Mem: couldn't map %zu bytes\n", size);
+		abort();
+	}
+
+	// only a hint, the kernel may not have transparent huge pages enabled
+	if(memhugepages)
+	{
+		madvise(mem, size, MADV_HUGEPAGE);
+	}
+
+	__sync_fetch_and_add(&memnumchunks, 1);
+
+	memchunk_t *chunk = (memchunk_t*)mem;
+	chunk->next = NULL;
+	chunk->size = size - sizeof(memchunk_t);
+	chunk->allocated = 0;
+
+	return chunk;
+}
+
+// alignment must be a power of two no bigger than a page
+void *Mem_AllocAligned(int numbytes, int alignment)
+{
+	memstack_t *stack = memstack;
+	memchunk_t *chunk = stack->current;
+
+	for(;;)
+	{
+		if(chunk)
+		{
+			size_t offset = (chunk->allocated + alignment - 1) & ~(size_t)(alignment - 1);
+
+			if(offset + numbytes <= chunk->size)
+			{
+				stack->used += offset + numbytes - chunk->allocated;
+				if(stack->used > stack->highwater)
+				{
+					stack->highwater = stack->used;
+				}
+
+				chunk->allocated = offset + numbytes;
+				stack->current = chunk;
+
+				return (unsigned char*)(chunk + 1) + offset;
+			}
+
+			// chunks kept from before a reset are reused before mapping more
+			if(chunk->next)
+			{
+				chunk = chunk->next;
+				continue;
+			}
+		}
+
+		memchunk_t *newchunk = Mem_AllocChunk(numbytes + alignment);
+		stack->reserved += newchunk->size + sizeof(memchunk_t);
+
+		if(chunk)
+		{
+			chunk->next = newchunk;
+		}
+		else
+		{
+			stack->chunks = newchunk;
+		}
+		chunk = newchunk;
+	}
+}
+
+void *Mem_Alloc(int numbytes)
+{
+	return Mem_AllocAligned(numbytes, MEM_DEFAULT_ALIGN);
+}
+
+void Mem_InitStack(memstack_t *stack, const char *name)
+{
+	memset(stack, 0, sizeof(*stack));
+	stack->name = name;
+
+	pthread_mutex_lock(&memstackslock);
+	stack->next = memstacks;
+	memstacks = stack;
+	pthread_mutex_unlock(&memstackslock);
+}
+
+// makes everything in the stack available again, the chunks are kept so
+// filling it back up to the same size doesn't map anything
+void Mem_ResetStack(memstack_t *stack)
+{
+	for(memchunk_t *chunk = stack->chunks; chunk; chunk = chunk->next)
+	{
+		chunk->allocated = 0;
+	}
+
+	stack->current = stack->chunks;
+	stack->used = 0;
+}
+
+// gives the chunks back to the system, the stack can still be used afterwards
+void Mem_FreeStack(memstack_t *stack)
+{
+	memchunk_t *next;
+
+	for(memchunk_t *chunk = stack->chunks; chunk; chunk = next)
+	{
+		next = chunk->next;
+		munmap(chunk, chunk->size + sizeof(memchunk_t));
+	}
+
+	stack->chunks = stack->current = NULL;
+	stack->used = 0;
+	stack->reserved = 0;
+}
+
+// returns the previous stack so it can be restored
+memstack_t *Mem_SetStack(memstack_t *stack)
+{
+	memstack_t *oldstack = memstack;
+	memstack = stack;
+
+	return oldstack;
+}
+
+void Mem_PrintStats()
+{
+	size_t totalhighwater = 0;
+	size_t totalreserved = 0;
+
+	printf("%-40s %12s %12s %12s\n", "memory", "used", "high water", "reserved");
+
+	pthread_mutex_lock(&memstackslock);
+	for(memstack_t *stack = memstacks; stack; stack = stack->next)
+	{
+		printf("%-40s %12zu %12zu %12zu\n", stack->name, stack->used, stack->highwater, stack->reserved);
+
+		totalhighwater += stack->highwater;
+		totalreserved += stack->reserved;
+	}
+	pthread_mutex_unlock(&memstackslock);
+
+	printf("%-40s %12s %12zu %12zu\n", "total", "", totalhighwater, totalreserved);
+}
+
+// ==============================================
+// jobs
+//
+// a fixed pool of worker threads running parallel for loops. the thread that
+// starts a loop works on it as well and only waits once every index has been
+// handed out, so a job can start a loop of its own without starving the pool
+
+#define MAX_JOB_THREADS	64
+
+typedef void (*jobfunc_t)(void *data, int index);
+
+typedef struct jobbatch_s
+{
+	jobfunc_t	func;
+	void		*data;
+	int			count;
+	int			next;			// next index to hand out
+	int			done;
+
+	struct jobbatch_s *nextbatch;
+
+} jobbatch_t;
+
+// -1 starts one worker per extra core
+static int numjobthreads = -1;
+
+static pthread_mutex_t joblock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t jobwake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t jobdone = PTHREAD_COND_INITIALIZER;
+static jobbatch_t *jobbatches;
+
+// hands out the next index of a batch and takes the batch off the queue once
+// the last one is gone. called with joblock held
+static int Job_Claim(jobbatch_t *batch)
+{
+	if(batch->next == batch->count)
+	{
+		return -1;
+	}
+
+	int index = batch->next++;
+
+	if(batch->next == batch->count)
+	{
+		jobbatch_t **link = &jobbatches;
+		while(*link != batch)
+		{
+			link = &(*link)->nextbatch;
+		}
+		*link = batch->nextbatch;
+	}
+
+	return index;
+}
+
+// called with joblock held
+static void Job_Finish(jobbatch_t *batch)
+{
+	batch->done++;
+
+	if(batch->done == batch->count)
+	{
+		pthread_cond_broadcast(&jobdone);
+	}
+}
+
+static void *Job_Thread(void *)
+{
+	pthread_mutex_lock(&joblock);
+
+	for(;;)
+	{
+		while(!jobbatches)
+		{
+			pthread_cond_wait(&jobwake, &joblock);
+		}
+
+		// the batch can't go away before it is finished
+		jobbatch_t *batch = jobbatches;
+		int index = Job_Claim(batch);
+
+		pthread_mutex_unlock(&joblock);
+		batch->func(batch->data, index);
+		pthread_mutex_lock(&joblock);
+
+		Job_Finish(batch);
+	}
+
+	return NULL;
+}
+
+static void Job_Init()
+{
+	if(numjobthreads < 0)
+	{
+		numjobthreads = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+	}
+
+	if(numjobthreads > MAX_JOB_THREADS)
+	{
+		numjobthreads = MAX_JOB_THREADS;
+	}
+
+	for(int i = 0; i < numjobthreads; i++)
+	{
+		pthread_t thread;
+
+		if(pthread_create(&thread, NULL, Job_Thread, NULL))
+		{
+			numjobthreads = i;
+			break;
+		}
+
+		pthread_detach(thread);
+	}
+}
+
+// runs func for every index in [0, count) and returns when all of them are done
+static void Job_ParallelFor(int count, jobfunc_t func, void *data)
+{
+	if(numjobthreads <= 0 || count <= 1)
+	{
+		for(int i = 0; i < count; i++)
+		{
+			func(data, i);
+		}
+		return;
+	}
+
+	jobbatch_t batch;
+	batch.func = func;
+	batch.data = data;
+	batch.count = count;
+	batch.next = 0;
+	batch.done = 0;
+
+	pthread_mutex_lock(&joblock);
+
+	// newest first so nested loops finish before more outer work is started
+	batch.nextbatch = jobbatches;
+	jobbatches = &batch;
+	pthread_cond_broadcast(&jobwake);
+
+	int index;
+	while((index = Job_Claim(&batch)) != -1)
+	{
+		pthread_mutex_unlock(&joblock);
+		func(data, index);
+		pthread_mutex_lock(&joblock);
+
+		Job_Finish(&batch);
+	}
+
+	while(batch.done != batch.count)
+	{
+		pthread_cond_wait(&jobdone, &joblock);
+	}
+
+	pthread_mutex_unlock(&joblock);
+}
+
+// ==============================================
+// errors and warnings
+
+static void Error(const char *error, ...)
+{
+	va_list valist;
+	char buffer[2048];
+
+	va_start(valist, error);
+	vsprintf(buffer, error, valist);
+	va_end(valist);
+
+	printf("Error: %s", buffer);
+	exit(1);
+}
+
+static void Warning(const char *warning, ...)
+{
+	va_list valist;
+	char buffer[2048];
+
+	va_start(valist, warning);
+	vsprintf(buffer, warning, valist);
+	va_end(valist);
+
+	fprintf(stdout, "Warning: %s", buffer);
+}
+
+// ==============================================
+// Misc crap
+
+static float Vector_Dot(float a[3], float b[3])
+{
+	return (a[0] * b[0]) + (a[1] * b[1]) + (a[2] * b[2]);
+}
+
+static void Vector_Copy(float *a, float *b)
+{
+	a[0] = b[0];
+	a[1] = b[1];
+	a[2] = b[2];
+}
+
+static void Vector_Cross(float *c, float *a, float *b)
+{
+	c[0] = (a[1] * b[2]) - (a[2] * b[1]);
+	c[1] = (a[2] * b[0]) - (a[0] * b[2]);
+	c[2] = (a[0] * b[1]) - (a[1] * b[0]);
+}
+
+static void Vector_Normalize(float *v)
+{
+	float len, invlen;
+
+	len = sqrtf((v[0] * v[0]) + (v[1] * v[1]) + (v[2] * v[2]));
+	invlen = 1.0f / len;
+
+	v[0] *= invlen;
+	v[1] *= invlen;
+	v[2] *= invlen;
+}
+
+static void MatrixTranspose(float out[4][4], const float in[4][4])
+{
+	for( int i = 0; i < 4; i++ )
+	{
+		for( int j = 0; j < 4; j++ )
+		{
+			out[j][i] = in[i][j];
+		}
+	}
+}
+
+// ==============================================
+// MD5 model
+
+typedef struct md5joint_s
+{
+	int		parentindex;
+	int		flags;
+	float	p[3];
+	float	q[4];
+
+} md5joint_t;
+
+// names are kept out of the joints so the joint arrays are plain data that
+// can be used straight out of a cache file
+#define MD5_MAX_NAME	64
+
+typedef struct md5name_s
+{
+	char	string[MD5_MAX_NAME];
+
+} md5name_t;
+
+typedef struct md5vertex_s
+{
+	float	texcoords[2];
+	int		firstweight;
+	int		numweights;
+
+} md5vertex_t;
+
+typedef struct md5tri_s
+{
+	int		indicies[3];
+
+} md5tri_t;
+
+typedef struct md5weight_s
+{
+	int	joint;
+	float	weight;
+	float	xyz[3];
+
+} md5weight_t;
+
+#define MD5_MAX_VERTEX_WEIGHTS	4
+
+// bind pose vertex with its weights capped, built at load for palette skinning.
+// unused influences have a weight of zero
+typedef struct md5skinvert_s
+{
+	float	xyz[3];
+	float	normal[3];		// bind pose tangent frame
+	float	tangent[3];
+	int		tangentsign;	// side of the bitangent, -1 or 1
+	int		joints[MD5_MAX_VERTEX_WEIGHTS];
+	float	weights[MD5_MAX_VERTEX_WEIGHTS];
+
+} md5skinvert_t;
+
+// structure of arrays copy of the skin vertices for the simd kernels. the
+// vertex count is padded to a multiple of 8 with zero weight vertices and
+// every array is cache line aligned
+typedef struct md5skinstreams_s
+{
+	int		numvertices;
+	float	*xyz[3];
+	float	*normal[3];
+	float	*tangent[3];
+	unsigned int	*tangentw;		// packed w bits of the tangent
+	int		*joints[MD5_MAX_VERTEX_WEIGHTS];
+	float	*weights[MD5_MAX_VERTEX_WEIGHTS];
+
+} md5skinstreams_t;
+
+typedef struct md5jointmat_s
+{
+	float		m[3][4];
+
+} md5jointmat_t;
+
+// frames the gpu may still be reading from the persistent vertex ring
+#define VERTEX_RING_FRAMES	3
+
+// sized to the mesh at load. the index buffer never changes so it is built
+// once, with 16 bit indices when the vertex count allows it. the vertices
+// are split into streams and each stage of the frame only writes its own
+typedef struct drawsurf_s
+{
+	int				numvertices;
+	float			*xyz;			// 3 floats per vertex, written by skinning
+	unsigned int	*normals;		// signed 10:10:10:2
+	unsigned int	*tangents;		// signed 10:10:10:2, w is the sign of the bitangent
+	unsigned int	*colors;		// rgba8, from the normals
+	unsigned short	*texcoords;		// 2 half floats per vertex, set at load
+
+	void			*indexbuffer;
+	int				numindicies;
+	GLenum			indextype;		// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+
+	// created on the first draw, loading happens without a context
+	GLuint			vertexbufferobject;
+	GLuint			indexbufferobject;
+	size_t			vertexoffset;	// where this frame's vertices start in the buffer object
+	unsigned char	*ring;			// persistently mapped, VERTEX_RING_FRAMES copies
+	GLsync			ringfences[VERTEX_RING_FRAMES];
+	int				ringframe;
+
+	// the recomputed tangent frames are kept from frame to frame and only the
+	// blocks around joints that moved are rebuilt. like the streams above
+	// these follow one pose, so every instance of a mesh needs its own
+	float			*faces;			// the frame of every triangle
+	md5jointmat_t	*lastskinmats;	// each joint when its blocks were last rebuilt
+	bool			framesvalid;	// faces, normals and tangents match lastskinmats
+
+} drawsurf_t;
+
+// granularity of the incremental tangent frame updates, a multiple of 8 so
+// the simd kernels only see a scalar tail at the end of a mesh
+#define NORMALS_BLOCK_SIZE	64
+
+typedef struct md5mesh_s
+{
+	struct md5mesh_s	*next;
+
+	int				numvertices;
+	md5vertex_t		*vertices;
+	int				numtris;
+	md5tri_t		*tris;
+	int				numweights;
+	md5weight_t		*weights;
+	md5skinvert_t	*skinverts;
+	md5skinstreams_t	skinstreams;
+	int				*firstvertextri;	// numvertices + 1 row starts into vertextris
+	int				*vertextris;		// triangles using each vertex
+
+	// the triangle and vertex blocks whose tangent frames change when a
+	// joint moves, in compressed rows by joint
+	int				*firstjointtriblock;
+	int				*jointtriblocks;
+	int				*firstjointvertexblock;
+	int				*jointvertexblocks;
+	drawsurf_t		surf;
+
+} md5mesh_t;
+
+typedef struct md5bound_s
+{
+	float			min[3];
+	float			max[3];
+
+} md5bound_t;
+
+// a pose in structure of arrays form. each component of the joints has its
+// own plane of posestride floats so whole planes can go through simd, and
+// all the planes are one block so a component's slot is an offset from p[0]
+#define POSE_NUM_PLANES		7		// tx ty tz qx qy qz qw, in flag bit order
+#define POSE_STRIDE(numjoints)	(((numjoints) + 7) & ~7)
+
+typedef struct md5pose_s
+{
+	float	*p[3];
+	float	*q[4];
+
+} md5pose_t;
+
+// frames kept as 16 bit values instead of floats. components on their own
+// are quantized over their range, rotations with all three components
+// animated use the smallest three encoding. the shorts for a frame are the
+// tracks followed by the a, b and c of every rotation, each in a run.
+// an anim is quantized as soon as it is parsed and the floats are dropped,
+// so tracks and rotations are kept by the component they came from and only
+// get their place in the pose from the decode plan
+typedef struct md5quantanim_s
+{
+	int				numtracks;
+	int				*trackcomponents;
+	int				*trackslots;		// pose slot of each track
+	float			*trackmin;
+	float			*trackscale;
+
+	int				numrotations;
+	int				*rotationcomponents;	// the x, y and z follow on from it
+	int				*rotationjoints;
+
+	int				framepitch;			// shorts per frame
+	unsigned short	*frames;
+
+} md5quantanim_t;
+
+// every animated component as a track of sparse keys, with the frames
+// between two keys on the straight line through them. a track's keys are a
+// compressed row of times and values
+typedef struct md5reducedanim_s
+{
+	int				numtracks;
+	int				*trackslots;		// pose slot of each track
+	int				*firstkey;			// numtracks + 1
+	unsigned short	*keytimes;
+	float			*keyvalues;
+
+} md5reducedanim_t;
+
+typedef struct md5anim_s
+{
+	struct md5anim_s	*next;
+
+	char			*name;
+	int				numframes;
+	int				framerate;
+	int				numanimatedcomponents;
+	int				numjoints;
+	
+	md5joint_t		*joints;
+	md5name_t		*jointnames;
+	md5bound_t		*bounds;
+	float			*framedata;		// numanimatedcomponents per frame, NULL once quantized or reduced
+	memstack_t		*framestack;	// holds the parsed framedata, NULL when it is mapped from the cache
+
+	// joints without animated components whose parents are the same, so
+	// they come out the same every frame. built when the anim is linked to
+	// its model, both lists keep parents before children
+	int				numanimatedjoints;
+	int				*animatedjoints;
+	int				numstaticjoints;
+	int				*staticjoints;
+	md5jointmat_t	*staticpalette;		// numjoints, only the static joints are set
+	md5jointmat_t	*staticskinmats;
+
+	// the decode plan, also built once the joints are in their final order.
+	// every animated component has a slot in the pose it is written to, so a
+	// frame decodes as the base pose plus a straight copy of its components
+	int				posestride;
+	float			*basepose;		// the baseframe in pose layout
+	int				*decodeslots;	// numanimatedcomponents
+	int				*parents;
+	md5quantanim_t	*quant;			// decoded from instead of framedata when set
+	md5reducedanim_t	*reduced;		// the same, quantizing and reducing can't be mixed
+
+	// every frame decoded up front, for anims that are played enough to be
+	// worth the memory. NULL when the anim isn't baked
+	int				usecount;
+	int				bakedpitch;		// floats from one frame's pose to the next
+	float			*bakedposes;
+
+} md5anim_t;
+
+typedef struct md5model_s
+{
+	int				numjoints;
+	md5joint_t		*joints;
+	md5name_t		*jointnames;
+	md5jointmat_t	*inversebindmats;
+	int				nummeshes;
+	md5mesh_t		*meshes;
+	md5anim_t		*anims;
+
+	// maps joint indices in the file to the sorted order, NULL if the file
+	// already had every parent before its children
+	int				*jointremap;
+
+} md5model_t;
+
+#define MD5_ANIM_TX		(1 << 0)
+#define MD5_ANIM_TY		(1 << 1)
+#define MD5_ANIM_TZ		(1 << 2)
+
+#define MD5_ANIM_QX		(1 << 3)
+#define MD5_ANIM_QY		(1 << 4)
+#define MD5_ANIM_QZ		(1 << 5)
+
+static md5model_t* md5model;
+
+char *Mem_AllocString(const char *string, int length)
+{
+	char *buffer = (char*)Mem_Alloc(length + 1);
+	memcpy(buffer, string, length);
+	buffer[length] = '\0';
+
+	return buffer;
+}
+
+static md5joint_t *Mem_AllocMD5Joint(int numjoints)
+{
+	return (md5joint_t*)Mem_Alloc(numjoints * sizeof(md5joint_t));
+}
+
+static md5name_t *Mem_AllocMD5Name(int numnames)
+{
+	return (md5name_t*)Mem_Alloc(numnames * sizeof(md5name_t));
+}
+
+static md5vertex_t *Mem_AllocMD5Vertex(int numvertices)
+{
+	return (md5vertex_t*)Mem_Alloc(numvertices * sizeof(md5vertex_t));
+}
+
+static md5tri_t *Mem_AllocMD5Tri(int numtris)
+{
+	return (md5tri_t*)Mem_Alloc(numtris * sizeof(md5tri_t));
+}
+
+static md5weight_t *Mem_AllocMD5Weight(int numweights)
+{
+	return (md5weight_t*)Mem_Alloc(numweights * sizeof(md5weight_t));
+}
+
+static md5mesh_t *Mem_AllocMD5Mesh(int nummeshes)
+{
+	md5mesh_t *meshes = (md5mesh_t*)Mem_Alloc(nummeshes * sizeof(md5mesh_t));
+	memset(meshes, 0, nummeshes * sizeof(md5mesh_t));
+
+	return meshes;
+}
+
+static md5bound_t *Mem_AllocMD5Bound(int numbounds)
+{
+	return (md5bound_t*)Mem_Alloc(numbounds * sizeof(md5bound_t));
+}
+
+static md5anim_t *Mem_AllocMD5Anim(int numanims)
+{
+	md5anim_t *anims = (md5anim_t*)Mem_Alloc(numanims * sizeof(md5anim_t));
+	memset(anims, 0, numanims * sizeof(md5anim_t));
+
+	return anims;
+}
+
+static md5model_t *Mem_AllocMD5Model()
+{
+	md5model_t *model = (md5model_t*)Mem_Alloc(sizeof(md5model_t));
+	memset(model, 0, sizeof(md5model_t));
+
+	return model;
+}
+
+// model loading
+
+static float UnsignedIntToFloat(unsigned int u)
+{
+	union uf_t
+	{
+		unsigned int	u;
+		float			f;
+	} uf;
+	
+	uf.u = u;
+	return uf.f;
+}
+
+static unsigned int FloatToUnsignedInt(float f)
+{
+	union uf_t
+	{
+		unsigned int	u;
+		float			f;
+	} uf;
+	
+	uf.f = f;
+	return uf.u;
+}
+
+// ==============================================
+// lexer
+//
+// the file is mapped into memory and tokens point straight into it, nothing
+// is copied until something needs to be kept
+
+typedef struct lexer_s
+{
+	const char	*filename;
+	const char	*buffer;
+	size_t		size;
+	const char	*p;
+	const char	*end;
+	int			line;
+
+} lexer_t;
+
+typedef struct token_s
+{
+	const char	*string;
+	int			length;
+	bool		quoted;
+	int			line;
+
+} token_t;
+
+static void Lex_Error(lexer_t *lex, int line, const char *error, ...)
+{
+	va_list valist;
+	char buffer[2048];
+
+	va_start(valist, error);
+	vsnprintf(buffer, sizeof(buffer), error, valist);
+	va_end(valist);
+
+	Error("%s:%i: %s\n", lex->filename, line, buffer);
+}
+
+static bool Lex_Open(lexer_t *lex, const char *filename)
+{
+	lex->filename = filename;
+	lex->buffer = NULL;
+	lex->size = 0;
+	lex->line = 1;
+
+	int fd = open(filename, O_RDONLY);
+	if(fd == -1)
+	{
+		return false;
+	}
+
+	struct stat st;
+	if(fstat(fd, &st) == -1)
+	{
+		close(fd);
+		return false;
+	}
+
+	lex->size = st.st_size;
+
+	if(lex->size)
+	{
+		void *mem = mmap(NULL, lex->size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(mem == MAP_FAILED)
+		{
+			close(fd);
+			return false;
+		}
+
+		// the whole file is read front to back
+		madvise(mem, lex->size, MADV_SEQUENTIAL);
+		lex->buffer = (const char*)mem;
+	}
+
+	close(fd);
+
+	lex->p = lex->buffer;
+	lex->end = lex->buffer + lex->size;
+
+	return true;
+}
+
+static void Lex_Close(lexer_t *lex)
+{
+	if(lex->buffer)
+	{
+		munmap((void*)lex->buffer, lex->size);
+	}
+
+	lex->buffer = lex->p = lex->end = NULL;
+}
+
+static void Lex_SkipWhitespace(lexer_t *lex)
+{
+	const char *p = lex->p;
+	const char *end = lex->end;
+
+	while(p < end)
+	{
+		if(*p == '\n')
+		{
+			lex->line++;
+			p++;
+		}
+		else if(*p == ' ' || *p == '\t' || *p == '\r')
+		{
+			p++;
+		}
+		else if(*p == '/' && p + 1 < end && p[1] == '/')
+		{
+			while(p < end && *p != '\n')
+				p++;
+		}
+		else if(*p == '/' && p + 1 < end && p[1] == '*')
+		{
+			p += 2;
+			while(p < end && !(*p == '*' && p + 1 < end && p[1] == '/'))
+			{
+				if(*p == '\n')
+					lex->line++;
+				p++;
+			}
+			p += 2;
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	lex->p = p < end ? p : end;
+}
+
+static bool Lex_IsPunctuation(char c)
+{
+	return c == '(' || c == ')' || c == '{' || c == '}';
+}
+
+// returns false at the end of the file
+static bool Lex_ReadToken(lexer_t *lex, token_t *token)
+{
+	Lex_SkipWhitespace(lex);
+
+	const char *p = lex->p;
+	const char *end = lex->end;
+
+	token->line = lex->line;
+	token->quoted = false;
+
+	if(p == end)
+	{
+		token->string = p;
+		token->length = 0;
+		return false;
+	}
+
+	if(*p == '\"')
+	{
+		const char *start = ++p;
+		while(p < end && *p != '\"')
+		{
+			if(*p == '\n')
+				Lex_Error(lex, token->line, "newline in quoted string");
+			p++;
+		}
+		if(p == end)
+			Lex_Error(lex, token->line, "unterminated quoted string");
+
+		token->string = start;
+		token->length = p - start;
+		token->quoted = true;
+		lex->p = p + 1;
+		return true;
+	}
+
+	const char *start = p;
+	if(Lex_IsPunctuation(*p))
+	{
+		p++;
+	}
+	else
+	{
+		while(p < end && *p > ' ' && *p != '\"' && !Lex_IsPunctuation(*p))
+			p++;
+	}
+
+	token->string = start;
+	token->length = p - start;
+	lex->p = p;
+
+	return true;
+}
+
+static bool Lex_TokenIs(token_t *token, const char *string)
+{
+	int length = strlen(string);
+
+	return !token->quoted && token->length == length && !memcmp(token->string, string, length);
+}
+
+static void Lex_Expect(lexer_t *lex, const char *string)
+{
+	token_t token;
+
+	if(!Lex_ReadToken(lex, &token))
+		Lex_Error(lex, token.line, "expected '%s', found end of file", string);
+	if(!Lex_TokenIs(&token, string))
+		Lex_Error(lex, token.line, "expected '%s', found '%.*s'", string, token.length, token.string);
+}
+
+static token_t Lex_ReadQuotedString(lexer_t *lex)
+{
+	token_t token;
+
+	if(!Lex_ReadToken(lex, &token) || !token.quoted)
+		Lex_Error(lex, token.line, "expected quoted string, found '%.*s'", token.length, token.string);
+
+	return token;
+}
+
+static int Lex_ReadInt(lexer_t *lex)
+{
+	token_t token;
+
+	if(!Lex_ReadToken(lex, &token))
+		Lex_Error(lex, token.line, "expected integer, found end of file");
+
+	const char *p = token.string;
+	const char *end = token.string + token.length;
+
+	bool negative = false;
+	if(p < end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		p++;
+	}
+
+	if(p == end || token.quoted)
+		Lex_Error(lex, token.line, "expected integer, found '%.*s'", token.length, token.string);
+
+	int value = 0;
+	for(; p < end; p++)
+	{
+		if(*p < '0' || *p > '9')
+			Lex_Error(lex, token.line, "expected integer, found '%.*s'", token.length, token.string);
+
+		int digit = *p - '0';
+		if(value > (INT_MAX - digit) / 10)
+			Lex_Error(lex, token.line, "integer '%.*s' is out of range", token.length, token.string);
+
+		value = value * 10 + digit;
+	}
+
+	return negative ? -value : value;
+}
+
+// ==============================================
+// number parsing
+//
+// locale independent and correctly rounded. the common short decimal case is
+// done exactly in float or double arithmetic, anything that can't be proven
+// exact that way goes through strtof in the C locale
+
+static const float floatpowersof10[] =
+{
+	1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+static const double doublepowersof10[] =
+{
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// created once, files are parsed on several threads
+static locale_t clocale;
+static pthread_once_t clocaleonce = PTHREAD_ONCE_INIT;
+
+static void CreateCLocale()
+{
+	clocale = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+}
+
+static bool ParseFloat_Slow(const char *string, int length, float *result)
+{
+	char buffer[128];
+
+	if(length >= (int)sizeof(buffer))
+	{
+		return false;
+	}
+
+	pthread_once(&clocaleonce, CreateCLocale);
+
+	memcpy(buffer, string, length);
+	buffer[length] = '\0';
+
+	char *numberend;
+	*result = strtof_l(buffer, &numberend, clocale);
+
+	return length && numberend == buffer + length;
+}
+
+// turn a decimal mantissa and exponent into the nearest float if that can be
+// done exactly, returns false if it needs the slow path
+static bool DecimalToFloat(unsigned long long mantissa, int exponent, bool negative, float *result)
+{
+	float f;
+
+	if(mantissa == 0)
+	{
+		f = 0.0f;
+	}
+	else if(mantissa <= (1ull << 24) && exponent >= -10 && exponent <= 10)
+	{
+		// both values are exact floats so the single multiply or divide
+		// rounds correctly
+		f = (float)mantissa;
+		f = exponent < 0 ? f / floatpowersof10[-exponent] : f * floatpowersof10[exponent];
+	}
+	else if(mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22)
+	{
+		double d = (double)mantissa;
+		d = exponent < 0 ? d / doublepowersof10[-exponent] : d * doublepowersof10[exponent];
+
+		// rounding the correctly rounded double to float again is only wrong
+		// when the double lands exactly halfway between two floats
+		unsigned long long bits;
+		memcpy(&bits, &d, sizeof(bits));
+		if((bits & 0x1fffffffull) == 0x10000000ull)
+			return false;
+
+		// keep out of the float denormal and overflow ranges
+		if(d < 1.17549435e-38 || d > 3.40282347e+38)
+			return false;
+
+		f = (float)d;
+	}
+	else
+	{
+		return false;
+	}
+
+	*result = negative ? -f : f;
+	return true;
+}
+
+#ifdef USE_SIMD
+// convert up to 8 digits at once, the digits are shifted up so the unused
+// bytes act as leading zeros
+static unsigned long long ParseDigits8(const char *p, int numdigits)
+{
+	if(!numdigits)
+	{
+		return 0;
+	}
+
+	unsigned long long val;
+	memcpy(&val, p, sizeof(val));
+
+	val <<= 8 * (8 - numdigits);
+	val = ((val & 0x0f0f0f0f0f0f0f0full) * 2561) >> 8;
+	val = ((val & 0x00ff00ff00ff00ffull) * 6553601) >> 16;
+	return ((val & 0x0000ffff0000ffffull) * 42949672960001ull) >> 32;
+}
+
+// the common [-]digits.digits shape with up to 8 digits either side of the
+// point. the digit runs are found 16 bytes at a time, needs 32 readable bytes
+static bool ParseFloat_SSE2(const char *p, const char *end, float *result)
+{
+	bool negative = (*p == '-');
+	if(negative)
+	{
+		p++;
+	}
+
+	__m128i chars = _mm_loadu_si128((const __m128i*)p);
+	__m128i isdigit = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(chars, _mm_set1_epi8('9' + 1)));
+	unsigned int digitmask = _mm_movemask_epi8(isdigit);
+
+	int intdigits = __builtin_ctz(~digitmask);
+	if(intdigits == 0 || intdigits > 8 || p[intdigits] != '.')
+	{
+		return false;
+	}
+
+	int fracdigits = __builtin_ctz(~(digitmask >> (intdigits + 1)));
+	if(fracdigits > 8 || p + intdigits + 1 + fracdigits != end)
+	{
+		return false;
+	}
+
+	unsigned long long mantissa = ParseDigits8(p, intdigits) * (unsigned long long)doublepowersof10[fracdigits] + ParseDigits8(p + intdigits + 1, fracdigits);
+
+	return DecimalToFloat(mantissa, -fracdigits, negative, result);
+}
+#endif
+
+// general decimal parser, [sign] digits [. digits] [e [sign] digits]
+static bool ParseFloat_Generic(const char *p, const char *end, float *result)
+{
+	bool negative = false;
+	if(p < end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		p++;
+	}
+
+	unsigned long long mantissa = 0;
+	int numsignificant = 0;
+	int exponent = 0;
+	int numdigits = 0;
+
+	for(; p < end && *p >= '0' && *p <= '9'; p++, numdigits++)
+	{
+		if(mantissa == 0 && *p == '0')
+			continue;
+		if(numsignificant == 19)
+			return false;
+
+		mantissa = mantissa * 10 + (*p - '0');
+		numsignificant++;
+	}
+
+	if(p < end && *p == '.')
+	{
+		for(p++; p < end && *p >= '0' && *p <= '9'; p++, numdigits++)
+		{
+			exponent--;
+
+			if(mantissa == 0 && *p == '0')
+				continue;
+			if(numsignificant == 19)
+				return false;
+
+			mantissa = mantissa * 10 + (*p - '0');
+			numsignificant++;
+		}
+	}
+
+	if(!numdigits)
+	{
+		return false;
+	}
+
+	if(p < end && (*p == 'e' || *p == 'E'))
+	{
+		p++;
+
+		bool negativeexponent = false;
+		if(p < end && (*p == '-' || *p == '+'))
+		{
+			negativeexponent = (*p == '-');
+			p++;
+		}
+
+		if(p == end || *p < '0' || *p > '9')
+			return false;
+
+		int e = 0;
+		for(; p < end && *p >= '0' && *p <= '9'; p++)
+		{
+			if(e < 10000)
+				e = e * 10 + (*p - '0');
+		}
+
+		exponent += negativeexponent ? -e : e;
+	}
+
+	if(p != end)
+	{
+		return false;
+	}
+
+	return DecimalToFloat(mantissa, exponent, negative, result);
+}
+
+// bufferend is the end of the readable memory, which can be past the end of
+// the number so the vector scan can look ahead
+static bool ParseFloat(const char *string, int length, const char *bufferend, float *result)
+{
+	const char *end = string + length;
+
+#ifdef USE_SIMD
+	if(bufferend - string >= 32 && ParseFloat_SSE2(string, end, result))
+	{
+		return true;
+	}
+#endif
+
+	if(ParseFloat_Generic(string, end, result))
+	{
+		return true;
+	}
+
+	return ParseFloat_Slow(string, length, result);
+}
+
+static float Lex_ReadFloat(lexer_t *lex)
+{
+	token_t token;
+	float f;
+
+	if(!Lex_ReadToken(lex, &token))
+		Lex_Error(lex, token.line, "expected number, found end of file");
+	if(token.quoted || !ParseFloat(token.string, token.length, lex->end, &f))
+		Lex_Error(lex, token.line, "expected number, found '%.*s'", token.length, token.string);
+
+	return f;
+}
+
+// ======================================================================================
+// Mesh files
+
+static float ComputeQuatW(md5joint_t *j)
+{
+	//float t = 1.0f - (j->q[0] * j->q[0]) - (j->q[1] * j->q[1]) - (j->q[2] * j->q[2]);
+	//return (t < 0 ? 0.0 : -sqrtf(t));
+
+	return -sqrtf( fabs( 1.0f - (j->q[0] * j->q[0] + j->q[1] * j->q[1] + j->q[2] * j->q[2])));
+}
+
+static void ReadName(lexer_t *lex, md5name_t *name)
+{
+	token_t token = Lex_ReadQuotedString(lex);
+
+	if(token.length >= MD5_MAX_NAME)
+	{
+		Lex_Error(lex, token.line, "name \"%.*s\" is longer than %i characters", token.length, token.string, MD5_MAX_NAME - 1);
+	}
+
+	memset(name->string, 0, sizeof(name->string));
+	memcpy(name->string, token.string, token.length);
+}
+
+// the checks on what everything after loading indexes with. the text parser
+// and the cache loaders both go through them: the parser stops at the line
+// the bad element was on, a cache that fails is passed over for the text file
+
+// an error at the line when called from the parser, just false for a cache
+static bool CheckFailed(lexer_t *lex, const int *lines, int element, const char *error, ...)
+{
+	if(!lex)
+	{
+		return false;
+	}
+
+	va_list valist;
+	char buffer[1024];
+
+	va_start(valist, error);
+	vsnprintf(buffer, sizeof(buffer), error, valist);
+	va_end(valist);
+
+	Lex_Error(lex, lines ? lines[element] : lex->line, "%s", buffer);
+	return false;
+}
+
+static bool CheckMD5Joints(md5joint_t *joints, int numjoints, lexer_t *lex, const int *jointlines)
+{
+	for(int i = 0; i < numjoints; i++)
+	{
+		int parentindex = joints[i].parentindex;
+
+		if(parentindex < -1 || parentindex >= numjoints)
+		{
+			return CheckFailed(lex, jointlines, i, "joint %i has parent %i of %i joints", i, parentindex, numjoints);
+		}
+	}
+
+	return true;
+}
+
+static bool CheckMD5Mesh(md5mesh_t *mesh, int numjoints, lexer_t *lex, const int *vertlines, const int *trilines, const int *weightlines)
+{
+	for(int i = 0; i < mesh->numvertices; i++)
+	{
+		md5vertex_t *v = &mesh->vertices[i];
+
+		if(v->firstweight < 0 || v->numweights < 0 || v->firstweight > mesh->numweights - v->numweights)
+		{
+			return CheckFailed(lex, vertlines, i, "vert %i uses weights %i to %i of %i", i, v->firstweight, v->firstweight + v->numweights - 1, mesh->numweights);
+		}
+	}
+
+	for(int i = 0; i < mesh->numtris; i++)
+	{
+		for(int j = 0; j < 3; j++)
+		{
+			int vertex = mesh->tris[i].indicies[j];
+
+			if(vertex < 0 || vertex >= mesh->numvertices)
+			{
+				return CheckFailed(lex, trilines, i, "triangle %i uses vertex %i of %i", i, vertex, mesh->numvertices);
+			}
+		}
+	}
+
+	for(int i = 0; i < mesh->numweights; i++)
+	{
+		int joint = mesh->weights[i].joint;
+
+		if(joint < 0 || joint >= numjoints)
+		{
+			return CheckFailed(lex, weightlines, i, "weight %i uses joint %i of %i", i, joint, numjoints);
+		}
+	}
+
+	return true;
+}
+
+static void ReadJoint(lexer_t *lex, md5joint_t *j, md5name_t *name)
+{
+	ReadName(lex, name);
+	j->parentindex = Lex_ReadInt(lex);
+	Lex_Expect(lex, "(");
+	j->p[0] = Lex_ReadFloat(lex);
+	j->p[1] = Lex_ReadFloat(lex);
+	j->p[2] = Lex_ReadFloat(lex);
+	Lex_Expect(lex, ")");
+	Lex_Expect(lex, "(");
+	j->q[0] = Lex_ReadFloat(lex);
+	j->q[1] = Lex_ReadFloat(lex);
+	j->q[2] = Lex_ReadFloat(lex);
+	j->q[3] = ComputeQuatW(j);
+	Lex_Expect(lex, ")");
+}
+
+static void ReadJoints(lexer_t *lex, md5model_t *model)
+{
+	int *jointlines = (int*)Mem_Alloc(model->numjoints * sizeof(int));
+
+	Lex_Expect(lex, "{");
+
+	for(int i = 0; i < model->numjoints; i++)
+	{
+		ReadJoint(lex, model->joints + i, model->jointnames + i);
+		jointlines[i] = lex->line;
+	}
+
+	CheckMD5Joints(model->joints, model->numjoints, lex, jointlines);
+
+	Lex_Expect(lex, "}");
+}
+
+// reads an element index and checks it against the count given earlier
+static int ReadIndex(lexer_t *lex, int count, const char *what)
+{
+	int line = lex->line;
+	int i = Lex_ReadInt(lex);
+
+	if(i < 0 || i >= count)
+	{
+		Lex_Error(lex, line, "%s %i out of range (%i)", what, i, count);
+	}
+
+	return i;
+}
+
+// the counts that arrays are sized from, checked before anything is allocated
+#define MD5_MAX_COUNT	(1 << 22)
+
+static int ReadCount(lexer_t *lex, const char *what)
+{
+	int line = lex->line;
+	int count = Lex_ReadInt(lex);
+
+	if(count < 0 || count > MD5_MAX_COUNT)
+	{
+		Lex_Error(lex, line, "%s %i out of range (0 to %i)", what, count, MD5_MAX_COUNT);
+	}
+
+	return count;
+}
+
+static void ReadVertex(lexer_t *lex, md5vertex_t *v)
+{
+	Lex_Expect(lex, "(");
+	v->texcoords[0]		= Lex_ReadFloat(lex);
+	v->texcoords[1]		= Lex_ReadFloat(lex);
+	Lex_Expect(lex, ")");
+	v->firstweight		= Lex_ReadInt(lex);
+	v->numweights		= Lex_ReadInt(lex);
+}
+
+static void ReadTri(lexer_t *lex, md5tri_t *t)
+{
+	t->indicies[0]		= Lex_ReadInt(lex);
+	t->indicies[1]		= Lex_ReadInt(lex);
+	t->indicies[2]		= Lex_ReadInt(lex);
+}
+
+static void ReadWeight(lexer_t *lex, md5weight_t *w)
+{
+	w->joint		= Lex_ReadInt(lex);
+	w->weight		= Lex_ReadFloat(lex);
+	Lex_Expect(lex, "(");
+	w->xyz[0]		= Lex_ReadFloat(lex);
+	w->xyz[1]		= Lex_ReadFloat(lex);
+	w->xyz[2]		= Lex_ReadFloat(lex);
+	Lex_Expect(lex, ")");
+}
+
+// the line of every element, until it is read the line of its count
+static int *AllocElementLines(int count, int line)
+{
+	int *lines = (int*)Mem_Alloc(count * sizeof(int));
+
+	for(int i = 0; i < count; i++)
+	{
+		lines[i] = line;
+	}
+
+	return lines;
+}
+
+static void ReadMesh(lexer_t *lex, md5model_t *model)
+{
+	md5mesh_t *md5mesh = Mem_AllocMD5Mesh(1);
+
+	// link the mesh into the list
+	md5mesh->next = model->meshes;
+	model->meshes = md5mesh;
+
+	// everything is checked once the whole mesh is read, against the line
+	// each element was on. elements the file leaves out are zero, which
+	// passes, and are blamed on the count
+	int *vertlines = NULL;
+	int *trilines = NULL;
+	int *weightlines = NULL;
+
+	Lex_Expect(lex, "{");
+
+	while(1)
+	{
+		token_t token;
+
+		if(!Lex_ReadToken(lex, &token))
+		{
+			Lex_Error(lex, token.line, "unexpected end of file in mesh");
+		}
+
+		if(Lex_TokenIs(&token, "numverts"))
+		{
+			md5mesh->numvertices = ReadCount(lex, "numverts");
+			md5mesh->vertices = Mem_AllocMD5Vertex(md5mesh->numvertices);
+			memset(md5mesh->vertices, 0, md5mesh->numvertices * sizeof(md5vertex_t));
+			vertlines = AllocElementLines(md5mesh->numvertices, token.line);
+		}
+		else if(Lex_TokenIs(&token, "numtris"))
+		{
+			md5mesh->numtris = ReadCount(lex, "numtris");
+			md5mesh->tris = Mem_AllocMD5Tri(md5mesh->numtris);
+			memset(md5mesh->tris, 0, md5mesh->numtris * sizeof(md5tri_t));
+			trilines = AllocElementLines(md5mesh->numtris, token.line);
+		}
+		else if(Lex_TokenIs(&token, "numweights"))
+		{
+			md5mesh->numweights = ReadCount(lex, "numweights");
+			md5mesh->weights = Mem_AllocMD5Weight(md5mesh->numweights);
+			memset(md5mesh->weights, 0, md5mesh->numweights * sizeof(md5weight_t));
+			weightlines = AllocElementLines(md5mesh->numweights, token.line);
+		}
+		else if(Lex_TokenIs(&token, "vert"))
+		{
+			int i = ReadIndex(lex, md5mesh->numvertices, "vert");
+			ReadVertex(lex, md5mesh->vertices + i);
+			vertlines[i] = token.line;
+		}
+		else if(Lex_TokenIs(&token, "tri"))
+		{
+			int i = ReadIndex(lex, md5mesh->numtris, "tri");
+			ReadTri(lex, md5mesh->tris + i);
+			trilines[i] = token.line;
+		}
+		else if(Lex_TokenIs(&token, "weight"))
+		{
+			int i = ReadIndex(lex, md5mesh->numweights, "weight");
+			ReadWeight(lex, md5mesh->weights + i);
+			weightlines[i] = token.line;
+		}
+		else if(Lex_TokenIs(&token, "}"))
+		{
+			break;
+		}
+	}
+
+	CheckMD5Mesh(md5mesh, model->numjoints, lex, vertlines, trilines, weightlines);
+}
+
+// the palette is built in a single pass which needs every parent to come
+// before its children. exporters always write them that way but check anyway
+// and sort the joints if a file breaks the rule
+static void SortJoints(md5model_t *model, const char *filename)
+{
+	int numjoints = model->numjoints;
+	md5joint_t *joints = model->joints;
+
+	bool sorted = true;
+	for(int i = 0; i < numjoints; i++)
+	{
+		if(joints[i].parentindex >= i || joints[i].parentindex < -1)
+		{
+			sorted = false;
+			break;
+		}
+	}
+
+	if(sorted)
+	{
+		return;
+	}
+
+	Warning("joints in \"%s\" are not sorted parent first, reordering\n", filename);
+
+	int *remap = (int*)Mem_Alloc(numjoints * sizeof(int));
+	for(int i = 0; i < numjoints; i++)
+	{
+		remap[i] = -1;
+	}
+
+	// place joints whose parents have already been placed, keeping the file
+	// order as much as possible
+	int numplaced = 0;
+	while(numplaced < numjoints)
+	{
+		int oldnumplaced = numplaced;
+
+		for(int i = 0; i < numjoints; i++)
+		{
+			int parentindex = joints[i].parentindex;
+
+			if(remap[i] != -1)
+				continue;
+			if(parentindex >= numjoints)
+				Error("joint %i has invalid parent %i\n", i, parentindex);
+			if(parentindex != -1 && remap[parentindex] == -1)
+				continue;
+
+			remap[i] = numplaced++;
+		}
+
+		if(numplaced == oldnumplaced)
+		{
+			Error("joint hierarchy in \"%s\" has a cycle\n", filename);
+		}
+	}
+
+	md5joint_t *sortedjoints = Mem_AllocMD5Joint(numjoints);
+	for(int i = 0; i < numjoints; i++)
+	{
+		md5joint_t *j = &sortedjoints[remap[i]];
+
+		*j = joints[i];
+		if(j->parentindex != -1)
+		{
+			j->parentindex = remap[j->parentindex];
+		}
+	}
+
+	md5name_t *sortednames = Mem_AllocMD5Name(numjoints);
+	for(int i = 0; i < numjoints; i++)
+	{
+		sortednames[remap[i]] = model->jointnames[i];
+	}
+
+	for(md5mesh_t *mesh = model->meshes; mesh; mesh = mesh->next)
+	{
+		for(int i = 0; i < mesh->numweights; i++)
+		{
+			mesh->weights[i].joint = remap[mesh->weights[i].joint];
+		}
+	}
+
+	model->joints = sortedjoints;
+	model->jointnames = sortednames;
+	model->jointremap = remap;
+}
+
+static void ReadMD5Model(md5model_t *model, const char *filename)
+{
+	lexer_t lex;
+	if(!Lex_Open(&lex, filename))
+	{
+		Error("couldn't open file \"%s\"\n", filename);
+	}
+
+	token_t token;
+	while(Lex_ReadToken(&lex, &token))
+	{
+		if(Lex_TokenIs(&token, "numJoints"))
+		{
+			model->numjoints = ReadCount(&lex, "numJoints");
+			model->joints = Mem_AllocMD5Joint(model->numjoints);
+			model->jointnames = Mem_AllocMD5Name(model->numjoints);
+		}
+		else if(Lex_TokenIs(&token, "numMeshes"))
+		{
+			//model->nummeshes = Lex_ReadInt(&lex);
+			//model->meshes = Mem_AllocMD5Mesh(model->nummeshes);
+		}
+		else if(Lex_TokenIs(&token, "joints"))
+		{
+			ReadJoints(&lex, model);
+		}
+		else if(Lex_TokenIs(&token, "mesh"))
+		{
+			ReadMesh(&lex, model);
+		}
+	}
+
+	Lex_Close(&lex);
+}
+
+// ======================================================================================
+// Animation files
+
+static int NumAnimatedComponents(int flags)
+{
+	int count = 0;
+
+	for(int i = 0; i < 6; i++)
+	{
+		if(flags & (1 << i))
+		{
+			count++;
+		}
+	}
+
+	return count;
+}
+
+// put the anim's joints in the same order as the model they will be played on
+static void RemapAnimJoints(md5model_t *model, md5anim_t *md5anim)
+{
+	int *remap = model->jointremap;
+
+	if(!remap)
+	{
+		return;
+	}
+
+	if(md5anim->numjoints != model->numjoints)
+	{
+		Error("anim \"%s\" has %i joints, model has %i\n", md5anim->name, md5anim->numjoints, model->numjoints);
+	}
+
+	int numjoints = md5anim->numjoints;
+	int numcomponents = md5anim->numanimatedcomponents;
+
+	// find where each joint's components start in the unsorted frame data
+	int *firstcomponent = (int*)Mem_Alloc(numjoints * sizeof(int));
+	int c = 0;
+	for(int i = 0; i < numjoints; i++)
+	{
+		firstcomponent[i] = c;
+		c += NumAnimatedComponents(md5anim->joints[i].flags);
+	}
+
+	if(c != numcomponents)
+	{
+		Error("anim \"%s\" flags %i components, frames have %i\n", md5anim->name, c, numcomponents);
+	}
+
+	int *inverse = (int*)Mem_Alloc(numjoints * sizeof(int));
+	for(int i = 0; i < numjoints; i++)
+	{
+		inverse[remap[i]] = i;
+	}
+
+	// where each component goes once its joint has moved
+	int *componentremap = (int*)Mem_Alloc(numcomponents * sizeof(int));
+	c = 0;
+	for(int i = 0; i < numjoints; i++)
+	{
+		int oldindex = inverse[i];
+		int count = NumAnimatedComponents(md5anim->joints[oldindex].flags);
+
+		for(int k = 0; k < count; k++)
+		{
+			componentremap[firstcomponent[oldindex] + k] = c++;
+		}
+	}
+
+	md5joint_t *sortedjoints = Mem_AllocMD5Joint(numjoints);
+	for(int i = 0; i < numjoints; i++)
+	{
+		md5joint_t *j = &sortedjoints[remap[i]];
+
+		*j = md5anim->joints[i];
+		if(j->parentindex != -1)
+		{
+			j->parentindex = remap[j->parentindex];
+		}
+	}
+
+	md5name_t *sortednames = Mem_AllocMD5Name(numjoints);
+	for(int i = 0; i < numjoints; i++)
+	{
+		sortednames[remap[i]] = md5anim->jointnames[i];
+	}
+
+	// a frame at a time in place, which is fine for a private cache mapping too
+	if(md5anim->framedata)
+	{
+		float *frame = (float*)Mem_Alloc(numcomponents * sizeof(float));
+
+		for(int f = 0; f < md5anim->numframes; f++)
+		{
+			float *data = md5anim->framedata + f * numcomponents;
+
+			memcpy(frame, data, numcomponents * sizeof(float));
+			for(int k = 0; k < numcomponents; k++)
+			{
+				data[componentremap[k]] = frame[k];
+			}
+		}
+	}
+
+	md5quantanim_t *quant = md5anim->quant;
+	if(quant)
+	{
+		for(int k = 0; k < quant->numtracks; k++)
+		{
+			quant->trackcomponents[k] = componentremap[quant->trackcomponents[k]];
+		}
+		for(int k = 0; k < quant->numrotations; k++)
+		{
+			quant->rotationcomponents[k] = componentremap[quant->rotationcomponents[k]];
+		}
+	}
+
+	md5anim->joints = sortedjoints;
+	md5anim->jointnames = sortednames;
+}
+
+// the flags are what the frame data is walked by, so they are checked against
+// the start indices and numAnimatedComponents before anything reads a frame
+// the flags decide which frame components each joint takes, in joint order
+static bool CheckMD5Anim(md5anim_t *anim, lexer_t *lex, const int *jointlines)
+{
+	if(!CheckMD5Joints(anim->joints, anim->numjoints, lex, jointlines))
+	{
+		return false;
+	}
+
+	int numcomponents = 0;
+
+	for(int i = 0; i < anim->numjoints; i++)
+	{
+		int flags = anim->joints[i].flags;
+
+		if(flags & ~63)
+		{
+			return CheckFailed(lex, jointlines, i, "joint %i has invalid flags %i", i, flags);
+		}
+
+		numcomponents += NumAnimatedComponents(flags);
+		if(numcomponents > anim->numanimatedcomponents)
+		{
+			return CheckFailed(lex, jointlines, i, "joint %i flags more than the %i animated components", i, anim->numanimatedcomponents);
+		}
+	}
+
+	if(numcomponents != anim->numanimatedcomponents)
+	{
+		return CheckFailed(lex, NULL, 0, "joints flag %i components, numAnimatedComponents is %i", numcomponents, anim->numanimatedcomponents);
+	}
+
+	return true;
+}
+
+static void ReadHierarchy(lexer_t *lex, md5anim_t *md5anim)
+{
+	int *jointlines = (int*)Mem_Alloc(md5anim->numjoints * sizeof(int));
+	int *startindices = (int*)Mem_Alloc(md5anim->numjoints * sizeof(int));
+
+	Lex_Expect(lex, "{");
+
+	for(int i = 0; i < md5anim->numjoints; i++)
+	{
+		md5joint_t *j = md5anim->joints + i;
+
+		ReadName(lex, md5anim->jointnames + i);
+
+		jointlines[i] = lex->line;
+		j->parentindex	= Lex_ReadInt(lex);
+		j->flags		= Lex_ReadInt(lex);
+		startindices[i]	= Lex_ReadInt(lex);
+	}
+
+	CheckMD5Anim(md5anim, lex, jointlines);
+
+	// the components are always packed in joint order. the cache doesn't
+	// keep the start indices, so they are only checked here
+	int numcomponents = 0;
+
+	for(int i = 0; i < md5anim->numjoints; i++)
+	{
+		int flags = md5anim->joints[i].flags;
+
+		if(flags && startindices[i] != numcomponents)
+		{
+			Lex_Error(lex, jointlines[i], "joint %i starts at component %i, expected %i", i, startindices[i], numcomponents);
+		}
+
+		numcomponents += NumAnimatedComponents(flags);
+	}
+
+	Lex_Expect(lex, "}");
+}
+
+static void ReadBounds(lexer_t *lex, md5anim_t *md5anim)
+{
+	if(!md5anim->bounds)
+	{
+		md5anim->bounds = Mem_AllocMD5Bound(md5anim->numframes);
+	}
+
+	Lex_Expect(lex, "{");
+
+	for(int i = 0; i < md5anim->numframes; i++)
+	{
+		md5bound_t *b = md5anim->bounds + i;
+
+		Lex_Expect(lex, "(");
+		b->min[0] = Lex_ReadFloat(lex);
+		b->min[1] = Lex_ReadFloat(lex);
+		b->min[2] = Lex_ReadFloat(lex);
+		Lex_Expect(lex, ")");
+		Lex_Expect(lex, "(");
+		b->max[0] = Lex_ReadFloat(lex);
+		b->max[1] = Lex_ReadFloat(lex);
+		b->max[2] = Lex_ReadFloat(lex);
+		Lex_Expect(lex, ")");
+	}
+
+	Lex_Expect(lex, "}");
+}
+
+static void ReadBaseframe(lexer_t *lex, md5anim_t *md5anim)
+{
+	Lex_Expect(lex, "{");
+
+	for(int i = 0; i < md5anim->numjoints; i++)
+	{
+		md5joint_t *j = md5anim->joints + i;
+
+		Lex_Expect(lex, "(");
+		j->p[0] = Lex_ReadFloat(lex);
+		j->p[1] = Lex_ReadFloat(lex);
+		j->p[2] = Lex_ReadFloat(lex);
+		Lex_Expect(lex, ")");
+		Lex_Expect(lex, "(");
+		j->q[0] = Lex_ReadFloat(lex);
+		j->q[1] = Lex_ReadFloat(lex);
+		j->q[2] = Lex_ReadFloat(lex);
+		j->q[3] = ComputeQuatW(j);
+		Lex_Expect(lex, ")");
+	}
+
+	Lex_Expect(lex, "}");
+}
+
+// frame blocks are found with a quick scan first and then parsed on the job
+// threads, every block knows where its data goes so they can be done in any order
+
+#define FRAME_BLOCKS_PER_JOB	16
+
+typedef struct md5frameblock_s
+{
+	const char	*start;		// just after the opening brace
+	int			line;
+	int			framenum;
+
+} md5frameblock_t;
+
+typedef struct md5framejob_s
+{
+	lexer_t			*lex;
+	md5anim_t		*md5anim;
+	md5frameblock_t	*blocks;
+	int				numblocks;
+
+} md5framejob_t;
+
+// parses the contents of a frame block, the lexer is just after the opening brace
+static void ReadFrame(lexer_t *lex, md5anim_t *md5anim, int framenum)
+{
+	float *data = md5anim->framedata + framenum * md5anim->numanimatedcomponents;
+
+	for(int i = 0; i < md5anim->numanimatedcomponents; i++)
+	{
+		data[i] = Lex_ReadFloat(lex);
+	}
+
+	Lex_Expect(lex, "}");
+}
+
+static void ReadFrameBlocks(void *data, int index)
+{
+	md5framejob_t *job = (md5framejob_t*)data;
+
+	int first = index * FRAME_BLOCKS_PER_JOB;
+	int last = first + FRAME_BLOCKS_PER_JOB;
+	if(last > job->numblocks)
+	{
+		last = job->numblocks;
+	}
+
+	// each job reads through a lexer of its own
+	lexer_t lex = *job->lex;
+
+	for(int i = first; i < last; i++)
+	{
+		md5frameblock_t *block = &job->blocks[i];
+
+		lex.p = block->start;
+		lex.line = block->line;
+
+		ReadFrame(&lex, job->md5anim, block->framenum);
+	}
+}
+
+// skips to just past the closing brace of a block without parsing what is in
+// it. only comments and quoted strings need to go through the lexer
+static void SkipBlock(lexer_t *lex, int line)
+{
+	const char *p = lex->p;
+	const char *end = lex->end;
+
+	while(p < end)
+	{
+		if(*p == '}')
+		{
+			lex->p = p + 1;
+			return;
+		}
+
+		if(*p == '/' && p + 1 < end && (p[1] == '/' || p[1] == '*'))
+		{
+			lex->p = p;
+			Lex_SkipWhitespace(lex);
+			p = lex->p;
+			continue;
+		}
+
+		if(*p == '\"')
+		{
+			token_t token;
+
+			lex->p = p;
+			Lex_ReadToken(lex, &token);
+			p = lex->p;
+			continue;
+		}
+
+		if(*p == '\n')
+		{
+			lex->line++;
+		}
+		p++;
+	}
+
+	Lex_Error(lex, line, "unterminated block");
+}
+
+// reads a run of frame blocks, the "frame" token of the first one has already
+// been read. returns the number of frames read
+static int ReadFrames(lexer_t *lex, md5anim_t *md5anim)
+{
+	// allocate the framedata if it hasn't already been allocated, on a stack
+	// of its own so it can be given back if the anim is quantized or reduced
+	if(!md5anim->framedata)
+	{
+		if((long long)md5anim->numframes * md5anim->numanimatedcomponents > INT_MAX / (int)sizeof(float))
+		{
+			Lex_Error(lex, lex->line, "%i frames of %i components is too much frame data", md5anim->numframes, md5anim->numanimatedcomponents);
+		}
+
+		memstack_t *oldstack = Mem_SetStack(md5anim->framestack);
+		md5anim->framedata = (float*)Mem_Alloc(sizeof(float) * md5anim->numframes * md5anim->numanimatedcomponents);
+		Mem_SetStack(oldstack);
+	}
+
+	md5frameblock_t *blocks = (md5frameblock_t*)Mem_Alloc(md5anim->numframes * sizeof(md5frameblock_t));
+	unsigned char *seen = (unsigned char*)Mem_Alloc(md5anim->numframes);
+	memset(seen, 0, md5anim->numframes);
+
+	int numblocks = 0;
+	for(;;)
+	{
+		int framenum = ReadIndex(lex, md5anim->numframes, "frame");
+		if(seen[framenum])
+		{
+			Lex_Error(lex, lex->line, "frame %i appears more than once", framenum);
+		}
+		seen[framenum] = 1;
+
+		Lex_Expect(lex, "{");
+
+		md5frameblock_t *block = &blocks[numblocks++];
+		block->start = lex->p;
+		block->line = lex->line;
+		block->framenum = framenum;
+
+		SkipBlock(lex, block->line);
+
+		// stop at the first thing that isn't another frame
+		lexer_t next = *lex;
+		token_t token;
+		if(!Lex_ReadToken(&next, &token) || !Lex_TokenIs(&token, "frame"))
+		{
+			break;
+		}
+		*lex = next;
+	}
+
+	md5framejob_t job;
+	job.lex = lex;
+	job.md5anim = md5anim;
+	job.blocks = blocks;
+	job.numblocks = numblocks;
+
+	Job_ParallelFor((numblocks + FRAME_BLOCKS_PER_JOB - 1) / FRAME_BLOCKS_PER_JOB, ReadFrameBlocks, &job);
+
+	return numblocks;
+}
+
+static void ReadMD5Anim(md5anim_t *md5anim, const char *filename)
+{
+	// open the file
+	lexer_t lex;
+	if(!Lex_Open(&lex, filename))
+	{
+		Error("couldn't open file \"%s\"\n", filename);
+	}
+
+	int numframesread = 0;
+
+	token_t token;
+	while(Lex_ReadToken(&lex, &token))
+	{
+		if(Lex_TokenIs(&token, "numFrames"))
+		{
+			md5anim->numframes = ReadCount(&lex, "numFrames");
+		}
+		else if(Lex_TokenIs(&token, "numJoints"))
+		{
+			md5anim->numjoints = ReadCount(&lex, "numJoints");
+			md5anim->joints = Mem_AllocMD5Joint(md5anim->numjoints);
+			md5anim->jointnames = Mem_AllocMD5Name(md5anim->numjoints);
+		}
+		else if(Lex_TokenIs(&token, "frameRate"))
+		{
+			md5anim->framerate = Lex_ReadInt(&lex);
+		}
+		else if(Lex_TokenIs(&token, "numAnimatedComponents"))
+		{
+			md5anim->numanimatedcomponents = ReadCount(&lex, "numAnimatedComponents");
+		}
+		else if(Lex_TokenIs(&token, "hierarchy"))
+		{
+			ReadHierarchy(&lex, md5anim);
+		}
+		else if(Lex_TokenIs(&token, "bounds"))
+		{
+			ReadBounds(&lex, md5anim);
+		}
+		else if(Lex_TokenIs(&token, "baseframe"))
+		{
+			ReadBaseframe(&lex, md5anim);
+		}
+		else if(Lex_TokenIs(&token, "frame"))
+		{
+			numframesread += ReadFrames(&lex, md5anim);
+		}
+	}
+
+	if(numframesread != md5anim->numframes)
+	{
+		Lex_Error(&lex, lex.line, "expected %i frames, found %i", md5anim->numframes, numframesread);
+	}
+
+	Lex_Close(&lex);
+}
+
+// components that hold the same value in every frame, within this much of
+// the largest size of the value, are moved into the base frame
+#define MD5_CONSTANT_COMPONENT_EPSILON	1e-5f
+
+// exporters often flag components as animated that never change. they are
+// folded into the base frame and the frame data is compacted in place, which
+// is safe because every component only ever moves towards the start
+static void PruneConstantComponents(md5anim_t *md5anim)
+{
+	int numcomponents = md5anim->numanimatedcomponents;
+	int numframes = md5anim->numframes;
+
+	if(!numcomponents || !numframes)
+	{
+		return;
+	}
+
+	bool *keep = (bool*)Mem_Alloc(numcomponents * sizeof(bool));
+	int numkept = 0;
+
+	for(int i = 0, c = 0; i < md5anim->numjoints; i++)
+	{
+		md5joint_t *j = &md5anim->joints[i];
+		int flags = j->flags;
+
+		for(int k = 0; k < 6; k++)
+		{
+			if(!(flags & (1 << k)))
+				continue;
+
+			float minvalue = md5anim->framedata[c];
+			float maxvalue = minvalue;
+			for(int f = 1; f < numframes; f++)
+			{
+				float value = md5anim->framedata[f * numcomponents + c];
+				minvalue = value < minvalue ? value : minvalue;
+				maxvalue = value > maxvalue ? value : maxvalue;
+			}
+
+			float scale = fabs(minvalue) > fabs(maxvalue) ? fabs(minvalue) : fabs(maxvalue);
+			keep[c] = maxvalue - minvalue > MD5_CONSTANT_COMPONENT_EPSILON * (1.0f + scale);
+
+			if(keep[c])
+			{
+				numkept++;
+			}
+			else
+			{
+				// the middle of the range keeps every frame within half the epsilon
+				float value = 0.5f * (minvalue + maxvalue);
+
+				if(k < 3)
+					j->p[k] = value;
+				else
+					j->q[k - 3] = value;
+
+				j->flags &= ~(1 << k);
+			}
+
+			c++;
+		}
+	}
+
+	if(numkept == numcomponents)
+	{
+		return;
+	}
+
+	float *dst = md5anim->framedata;
+	for(int f = 0; f < numframes; f++)
+	{
+		float *src = md5anim->framedata + f * numcomponents;
+
+		for(int c = 0; c < numcomponents; c++)
+		{
+			if(keep[c])
+				*dst++ = src[c];
+		}
+	}
+
+	printf("pruned %i of %i animated components in \"%s\"\n", numcomponents - numkept, numcomponents, md5anim->name);
+
+	md5anim->numanimatedcomponents = numkept;
+}
+
+// ======================================================================================
+// Binary cache
+//
+// the parsed arrays are written next to the source file (.md5meshb/.md5animb)
+// at aligned offsets so the next run can map the file and point straight at
+// them. the cache is rebuilt whenever the source size or mtime changes
+
+// 2: anims are cached with their constant components pruned
+// 3: quantized anims are cached as just the quantized frames
+#define MD5_CACHE_VERSION	3
+#define MD5_CACHE_ALIGN		64
+
+static bool usecache = true;
+static bool quantizeanims;
+
+typedef struct md5cacheheader_s
+{
+	char		magic[4];		// "MD5M" or "MD5A"
+	int			version;
+	int			layout;			// catches builds that disagree on structure sizes
+	int			pad;
+	long long	sourcesize;
+	long long	sourcemtime;	// nanoseconds
+
+} md5cacheheader_t;
+
+typedef struct md5meshcacheentry_s
+{
+	int			numvertices;
+	int			numtris;
+	int			numweights;
+	int			pad;
+	long long	vertices;
+	long long	tris;
+	long long	weights;
+
+} md5meshcacheentry_t;
+
+// offsets are from the start of the file
+typedef struct md5meshcache_s
+{
+	md5cacheheader_t	header;
+	int			numjoints;
+	int			nummeshes;
+	long long	joints;
+	long long	jointnames;
+	long long	meshes;			// md5meshcacheentry_t, in model list order
+
+} md5meshcache_t;
+
+typedef struct md5animcache_s
+{
+	md5cacheheader_t	header;
+	int			numframes;
+	int			numjoints;
+	int			framerate;
+	int			numanimatedcomponents;
+	int			quantized;		// then there are no float frames
+	int			numtracks;
+	int			numrotations;
+	long long	joints;
+	long long	jointnames;
+	long long	bounds;
+	long long	framedata;
+	long long	trackcomponents;
+	long long	trackmin;
+	long long	trackscale;
+	long long	rotationcomponents;
+	long long	quantframes;
+
+} md5animcache_t;
+
+typedef struct cachewriter_s
+{
+	FILE		*fp;
+	long long	offset;
+
+} cachewriter_t;
+
+static int CacheLayout()
+{
+	int layout = sizeof(md5cacheheader_t);
+
+	layout = layout * 31 + sizeof(md5joint_t);
+	layout = layout * 31 + sizeof(md5name_t);
+	layout = layout * 31 + sizeof(md5vertex_t);
+	layout = layout * 31 + sizeof(md5tri_t);
+	layout = layout * 31 + sizeof(md5weight_t);
+	layout = layout * 31 + sizeof(md5bound_t);
+
+	return layout;
+}
+
+// false if the name doesn't fit, the file is then just not cached
+static bool CacheFileName(char *buffer, int size, const char *sourcefilename)
+{
+	int length = snprintf(buffer, size, "%sb", sourcefilename);
+
+	return length >= 0 && length < size;
+}
+
+static bool StatSourceFile(const char *filename, long long *size, long long *mtime)
+{
+	struct stat st;
+
+	if(stat(filename, &st) == -1)
+	{
+		return false;
+	}
+
+	*size = st.st_size;
+	*mtime = (long long)st.st_mtim.tv_sec * 1000000000ll + st.st_mtim.tv_nsec;
+
+	return true;
+}
+
+// maps a cache file if it exists and was built from the current source.
+// the mapping is private and writable so load time fixes like joint sorting
+// can still be applied in place. once its sections are checked it is never
+// unmapped, until then the caller unmaps it if they don't fit
+static void *MapCacheFile(const char *sourcefilename, const char *magic, size_t *size)
+{
+	char filename[1024];
+	long long sourcesize, sourcemtime;
+
+	if(!usecache || !StatSourceFile(sourcefilename, &sourcesize, &sourcemtime))
+	{
+		return NULL;
+	}
+
+	if(!CacheFileName(filename, sizeof(filename), sourcefilename))
+	{
+		return NULL;
+	}
+
+	int fd = open(filename, O_RDONLY);
+	if(fd == -1)
+	{
+		return NULL;
+	}
+
+	struct stat st;
+	if(fstat(fd, &st) == -1 || st.st_size < (off_t)sizeof(md5cacheheader_t))
+	{
+		close(fd);
+		return NULL;
+	}
+
+	void *mem = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if(mem == MAP_FAILED)
+	{
+		return NULL;
+	}
+
+	md5cacheheader_t *header = (md5cacheheader_t*)mem;
+	if(memcmp(header->magic, magic, 4) || header->version != MD5_CACHE_VERSION || header->layout != CacheLayout() ||
+		header->sourcesize != sourcesize || header->sourcemtime != sourcemtime)
+	{
+		munmap(mem, st.st_size);
+		return NULL;
+	}
+
+	*size = st.st_size;
+	return mem;
+}
+
+// returns a pointer to a section of the mapped file, NULL if it doesn't fit
+static void *CacheSection(void *base, size_t size, long long offset, long long count, size_t elementsize)
+{
+	if(offset < 0 || count < 0 || offset % MD5_CACHE_ALIGN || offset + count * (long long)elementsize > (long long)size)
+	{
+		return NULL;
+	}
+
+	return (unsigned char*)base + offset;
+}
+
+static bool BeginCacheFile(cachewriter_t *writer, const char *sourcefilename, char *tempfilename, int size)
+{
+	char filename[1024];
+
+	if(!CacheFileName(filename, sizeof(filename), sourcefilename))
+	{
+		return false;
+	}
+
+	int length = snprintf(tempfilename, size, "%s.tmp", filename);
+	if(length < 0 || length >= size)
+	{
+		return false;
+	}
+
+	writer->fp = fopen(tempfilename, "wb");
+	writer->offset = 0;
+
+	return writer->fp != NULL;
+}
+
+// writes an array at the next aligned offset and returns where it went
+static long long WriteCacheSection(cachewriter_t *writer, const void *data, size_t size)
+{
+	static const unsigned char zeros[MD5_CACHE_ALIGN] = { 0 };
+
+	int padding = (MD5_CACHE_ALIGN - (writer->offset % MD5_CACHE_ALIGN)) % MD5_CACHE_ALIGN;
+	fwrite(zeros, 1, padding, writer->fp);
+	writer->offset += padding;
+
+	long long offset = writer->offset;
+	fwrite(data, 1, size, writer->fp);
+	writer->offset += size;
+
+	return offset;
+}
+
+// the header goes at the front once all the offsets are known, then the file
+// is renamed over the old cache so a partly written one is never picked up
+static void EndCacheFile(cachewriter_t *writer, const char *sourcefilename, const char *tempfilename, md5cacheheader_t *header, size_t headersize)
+{
+	char filename[1024];
+	long long sourcesize, sourcemtime;
+
+	CacheFileName(filename, sizeof(filename), sourcefilename);
+
+	if(!StatSourceFile(sourcefilename, &sourcesize, &sourcemtime))
+	{
+		sourcesize = sourcemtime = -1;
+	}
+
+	header->version = MD5_CACHE_VERSION;
+	header->layout = CacheLayout();
+	header->pad = 0;
+	header->sourcesize = sourcesize;
+	header->sourcemtime = sourcemtime;
+
+	fseek(writer->fp, 0, SEEK_SET);
+	fwrite(header, 1, headersize, writer->fp);
+
+	bool failed = ferror(writer->fp) != 0;
+	if(fclose(writer->fp))
+	{
+		failed = true;
+	}
+
+	if(failed || rename(tempfilename, filename))
+	{
+		Warning("couldn't write cache file \"%s\"\n", filename);
+		remove(tempfilename);
+	}
+}
+
+// every section, and the indices in it the text parser would have checked, is
+// checked before any of it is handed to the model, so a bad cache leaves the
+// model as it was for the text parser
+static bool LoadMD5ModelCache(md5model_t *model, const char *filename)
+{
+	size_t size;
+	void *base = MapCacheFile(filename, "MD5M", &size);
+	if(!base)
+	{
+		return false;
+	}
+
+	md5meshcache_t *cache = (md5meshcache_t*)base;
+	md5meshcacheentry_t *entries = NULL;
+	md5joint_t *joints = NULL;
+	md5name_t *jointnames = NULL;
+
+	if(size >= sizeof(md5meshcache_t))
+	{
+		entries = (md5meshcacheentry_t*)CacheSection(base, size, cache->meshes, cache->nummeshes, sizeof(md5meshcacheentry_t));
+		joints = (md5joint_t*)CacheSection(base, size, cache->joints, cache->numjoints, sizeof(md5joint_t));
+		jointnames = (md5name_t*)CacheSection(base, size, cache->jointnames, cache->numjoints, sizeof(md5name_t));
+	}
+
+	bool valid = entries && joints && jointnames && CheckMD5Joints(joints, cache->numjoints, NULL, NULL);
+
+	for(int i = 0; valid && i < cache->nummeshes; i++)
+	{
+		md5meshcacheentry_t *entry = &entries[i];
+		md5mesh_t mesh;
+
+		mesh.numvertices = entry->numvertices;
+		mesh.vertices = (md5vertex_t*)CacheSection(base, size, entry->vertices, entry->numvertices, sizeof(md5vertex_t));
+		mesh.numtris = entry->numtris;
+		mesh.tris = (md5tri_t*)CacheSection(base, size, entry->tris, entry->numtris, sizeof(md5tri_t));
+		mesh.numweights = entry->numweights;
+		mesh.weights = (md5weight_t*)CacheSection(base, size, entry->weights, entry->numweights, sizeof(md5weight_t));
+
+		valid = mesh.vertices && mesh.tris && mesh.weights && CheckMD5Mesh(&mesh, cache->numjoints, NULL, NULL, NULL, NULL);
+	}
+
+	if(!valid)
+	{
+		munmap(base, size);
+		return false;
+	}
+
+	model->numjoints = cache->numjoints;
+	model->joints = joints;
+	model->jointnames = jointnames;
+
+	// link in reverse so the list comes out in the stored order
+	md5mesh_t *meshes = NULL;
+	for(int i = cache->nummeshes - 1; i >= 0; i--)
+	{
+		md5meshcacheentry_t *entry = &entries[i];
+		md5mesh_t *md5mesh = Mem_AllocMD5Mesh(1);
+
+		md5mesh->numvertices = entry->numvertices;
+		md5mesh->vertices = (md5vertex_t*)CacheSection(base, size, entry->vertices, entry->numvertices, sizeof(md5vertex_t));
+		md5mesh->numtris = entry->numtris;
+		md5mesh->tris = (md5tri_t*)CacheSection(base, size, entry->tris, entry->numtris, sizeof(md5tri_t));
+		md5mesh->numweights = entry->numweights;
+		md5mesh->weights = (md5weight_t*)CacheSection(base, size, entry->weights, entry->numweights, sizeof(md5weight_t));
+
+		md5mesh->next = meshes;
+		meshes = md5mesh;
+	}
+
+	model->meshes = meshes;
+
+	return true;
+}
+
+static void WriteMD5ModelCache(md5model_t *model, const char *filename)
+{
+	cachewriter_t writer;
+	char tempfilename[1024];
+
+	if(!usecache || !BeginCacheFile(&writer, filename, tempfilename, sizeof(tempfilename)))
+	{
+		return;
+	}
+
+	md5meshcache_t cache;
+	memset(&cache, 0, sizeof(cache));
+	memcpy(cache.header.magic, "MD5M", 4);
+
+	// reserve the header
+	WriteCacheSection(&writer, &cache, sizeof(cache));
+
+	cache.numjoints = model->numjoints;
+	cache.joints = WriteCacheSection(&writer, model->joints, model->numjoints * sizeof(md5joint_t));
+	cache.jointnames = WriteCacheSection(&writer, model->jointnames, model->numjoints * sizeof(md5name_t));
+
+	cache.nummeshes = 0;
+	for(md5mesh_t *mesh = model->meshes; mesh; mesh = mesh->next)
+	{
+		cache.nummeshes++;
+	}
+
+	md5meshcacheentry_t *entries = (md5meshcacheentry_t*)Mem_Alloc(cache.nummeshes * sizeof(md5meshcacheentry_t));
+	md5mesh_t *mesh = model->meshes;
+	for(int i = 0; i < cache.nummeshes; i++, mesh = mesh->next)
+	{
+		md5meshcacheentry_t *entry = &entries[i];
+
+		entry->numvertices = mesh->numvertices;
+		entry->numtris = mesh->numtris;
+		entry->numweights = mesh->numweights;
+		entry->pad = 0;
+		entry->vertices = WriteCacheSection(&writer, mesh->vertices, mesh->numvertices * sizeof(md5vertex_t));
+		entry->tris = WriteCacheSection(&writer, mesh->tris, mesh->numtris * sizeof(md5tri_t));
+		entry->weights = WriteCacheSection(&writer, mesh->weights, mesh->numweights * sizeof(md5weight_t));
+	}
+
+	cache.meshes = WriteCacheSection(&writer, entries, cache.nummeshes * sizeof(md5meshcacheentry_t));
+
+	EndCacheFile(&writer, filename, tempfilename, &cache.header, sizeof(cache));
+}
+
+// as with the model, nothing is set unless the whole cache checks out. the
+// text parser only allocates the bounds and frame data when they are unset.
+// a cache quantized or not the other way to how anims are being loaded is
+// passed over so it gets rebuilt
+static bool LoadMD5AnimCache(md5anim_t *md5anim, const char *filename)
+{
+	size_t size;
+	void *base = MapCacheFile(filename, "MD5A", &size);
+	if(!base)
+	{
+		return false;
+	}
+
+	md5animcache_t *cache = (md5animcache_t*)base;
+	md5joint_t *joints = NULL;
+	md5name_t *jointnames = NULL;
+	md5bound_t *bounds = NULL;
+	float *framedata = NULL;
+	int *trackcomponents = NULL;
+	float *trackmin = NULL;
+	float *trackscale = NULL;
+	int *rotationcomponents = NULL;
+	unsigned short *quantframes = NULL;
+	bool valid = false;
+
+	if(size >= sizeof(md5animcache_t) && cache->quantized == (int)quantizeanims)
+	{
+		joints = (md5joint_t*)CacheSection(base, size, cache->joints, cache->numjoints, sizeof(md5joint_t));
+		jointnames = (md5name_t*)CacheSection(base, size, cache->jointnames, cache->numjoints, sizeof(md5name_t));
+		bounds = (md5bound_t*)CacheSection(base, size, cache->bounds, cache->numframes, sizeof(md5bound_t));
+
+		if(!cache->quantized)
+		{
+			framedata = (float*)CacheSection(base, size, cache->framedata, (long long)cache->numframes * cache->numanimatedcomponents, sizeof(float));
+			valid = joints && jointnames && bounds && framedata;
+		}
+		else
+		{
+			long long framepitch = (long long)cache->numtracks + 3ll * cache->numrotations;
+
+			trackcomponents = (int*)CacheSection(base, size, cache->trackcomponents, cache->numtracks, sizeof(int));
+			trackmin = (float*)CacheSection(base, size, cache->trackmin, cache->numtracks, sizeof(float));
+			trackscale = (float*)CacheSection(base, size, cache->trackscale, cache->numtracks, sizeof(float));
+			rotationcomponents = (int*)CacheSection(base, size, cache->rotationcomponents, cache->numrotations, sizeof(int));
+			quantframes = (unsigned short*)CacheSection(base, size, cache->quantframes, cache->numframes * framepitch, sizeof(unsigned short));
+
+			valid = joints && jointnames && bounds && trackcomponents && trackmin && trackscale && rotationcomponents && quantframes;
+
+			// the decode plan indexes by these
+			for(int k = 0; valid && k < cache->numtracks; k++)
+			{
+				valid = trackcomponents[k] >= 0 && trackcomponents[k] < cache->numanimatedcomponents;
+			}
+			for(int k = 0; valid && k < cache->numrotations; k++)
+			{
+				valid = rotationcomponents[k] >= 0 && rotationcomponents[k] + 2 < cache->numanimatedcomponents;
+			}
+		}
+	}
+
+	if(valid)
+	{
+		md5anim_t check;
+
+		check.numjoints = cache->numjoints;
+		check.numanimatedcomponents = cache->numanimatedcomponents;
+		check.joints = joints;
+
+		valid = CheckMD5Anim(&check, NULL, NULL);
+	}
+
+	if(!valid)
+	{
+		munmap(base, size);
+		return false;
+	}
+
+	md5anim->numframes = cache->numframes;
+	md5anim->numjoints = cache->numjoints;
+	md5anim->framerate = cache->framerate;
+	md5anim->numanimatedcomponents = cache->numanimatedcomponents;
+	md5anim->joints = joints;
+	md5anim->jointnames = jointnames;
+	md5anim->bounds = bounds;
+	md5anim->framedata = framedata;
+
+	if(cache->quantized)
+	{
+		md5quantanim_t *quant = (md5quantanim_t*)Mem_Alloc(sizeof(md5quantanim_t));
+
+		quant->numtracks = cache->numtracks;
+		quant->trackcomponents = trackcomponents;
+		quant->trackslots = (int*)Mem_Alloc(quant->numtracks * sizeof(int));
+		quant->trackmin = trackmin;
+		quant->trackscale = trackscale;
+		quant->numrotations = cache->numrotations;
+		quant->rotationcomponents = rotationcomponents;
+		quant->rotationjoints = (int*)Mem_Alloc(quant->numrotations * sizeof(int));
+		quant->framepitch = quant->numtracks + 3 * quant->numrotations;
+		quant->frames = quantframes;
+
+		md5anim->quant = quant;
+	}
+
+	return true;
+}
+
+static void WriteMD5AnimCache(md5anim_t *md5anim, const char *filename)
+{
+	cachewriter_t writer;
+	char tempfilename[1024];
+
+	if(!usecache || !BeginCacheFile(&writer, filename, tempfilename, sizeof(tempfilename)))
+	{
+		return;
+	}
+
+	md5animcache_t cache;
+	memset(&cache, 0, sizeof(cache));
+	memcpy(cache.header.magic, "MD5A", 4);
+
+	// reserve the header
+	WriteCacheSection(&writer, &cache, sizeof(cache));
+
+	cache.numframes = md5anim->numframes;
+	cache.numjoints = md5anim->numjoints;
+	cache.framerate = md5anim->framerate;
+	cache.numanimatedcomponents = md5anim->numanimatedcomponents;
+	cache.joints = WriteCacheSection(&writer, md5anim->joints, md5anim->numjoints * sizeof(md5joint_t));
+	cache.jointnames = WriteCacheSection(&writer, md5anim->jointnames, md5anim->numjoints * sizeof(md5name_t));
+	cache.bounds = WriteCacheSection(&writer, md5anim->bounds, md5anim->numframes * sizeof(md5bound_t));
+
+	md5quantanim_t *quant = md5anim->quant;
+	if(!quant)
+	{
+		cache.framedata = WriteCacheSection(&writer, md5anim->framedata, (size_t)md5anim->numframes * md5anim->numanimatedcomponents * sizeof(float));
+	}
+	else
+	{
+		cache.quantized = 1;
+		cache.numtracks = quant->numtracks;
+		cache.numrotations = quant->numrotations;
+		cache.trackcomponents = WriteCacheSection(&writer, quant->trackcomponents, quant->numtracks * sizeof(int));
+		cache.trackmin = WriteCacheSection(&writer, quant->trackmin, quant->numtracks * sizeof(float));
+		cache.trackscale = WriteCacheSection(&writer, quant->trackscale, quant->numtracks * sizeof(float));
+		cache.rotationcomponents = WriteCacheSection(&writer, quant->rotationcomponents, quant->numrotations * sizeof(int));
+		cache.quantframes = WriteCacheSection(&writer, quant->frames, (size_t)md5anim->numframes * quant->framepitch * sizeof(unsigned short));
+	}
+
+	EndCacheFile(&writer, filename, tempfilename, &cache.header, sizeof(cache));
+}
+
+// Model rendering
+
+static void Quat_Copy(float *a, float *b)
+{
+	a[0] = b[0];
+	a[1] = b[1];
+	a[2] = b[2];
+	a[3] = b[3];
+}
+
+static void Quat_Negate(float *a, float *b)
+{
+	a[0] = -b[0];
+	a[1] = -b[1];
+	a[2] = -b[2];
+	a[3] = -b[3];
+}
+
+static float Quat_Dot(float *a, float *b)
+{
+	return (a[0] * b[0]) + (a[1] * b[1]) + (a[2] * b[2]) + (a[3] * b[3]);
+}
+
+static void Quat_Normalize(float *q)
+{
+	float len, invlen;
+
+	len = sqrtf((q[0] * q[0]) + (q[1] * q[1]) + (q[2] * q[2]) + (q[3] * q[3]));
+	invlen = 1.0f / len;
+
+	q[0] *= invlen;
+	q[1] *= invlen;
+	q[2] *= invlen;
+	q[3] *= invlen;
+}
+
+#if 0
+static void Quat_NLerp(float* result, float *from, float *to, float t)
+{
+	float dot = Quat_Dot(from, to);
+	if(dot < 0.0f)
+	{
+		Quat_Negate(to, to);
+	}
+
+	result[0] = ((1 - t) * from[0]) + (t * to[0]);
+	result[1] = ((1 - t) * from[1]) + (t * to[1]);
+	result[2] = ((1 - t) * from[2]) + (t * to[2]);
+	result[3] = ((1 - t) * from[3]) + (t * to[3]);
+
+	Quat_Normalize(result);
+}
+#endif
+
+#if 0
+/*
+=====================
+idQuat::Slerp
+
+Spherical linear interpolation between two quaternions.
+=====================
+*/
+idQuat &idQuat::Slerp( float *result, float *from, float *to, float t ) {
+	idQuat	temp;
+	float	omega, cosom, sinom, scale0, scale1;
+
+	/*
+	if(t <= 0.0f)
+	{
+		Quat_Copy(result, from);
+		return;
+	}
+
+	if(t >= 1.0f)
+	{
+		Quat_Copy(result, to);
+		return;
+	}
+
+	if(from == to)
+	{
+		*this = to;
+		return *this;
+	}
+*/
+
+	cosom = Quat_Dot(from, to);
+	if(cosom < 0.0f)
+	{
+		Quat_Negate(temp, to);
+		cosom = -cosom;
+	}
+	else
+	{
+		Quat_Copy(temp, to);
+	}
+
+	if((1.0f - cosom) > 1e-6f)
+	{
+#if 0
+		omega = acos( cosom );
+		sinom = 1.0f / sin( omega );
+		scale0 = sin( ( 1.0f - t ) * omega ) * sinom;
+		scale1 = sin( t * omega ) * sinom;
+#else
+		scale0 = 1.0f - cosom * cosom;
+		sinom = idMath::InvSqrt( scale0 );
+		omega = idMath::ATan16( scale0 * sinom, cosom );
+		scale0 = idMath::Sin16( ( 1.0f - t ) * omega ) * sinom;
+		scale1 = idMath::Sin16( t * omega ) * sinom;
+#endif
+	} else {
+		scale0 = 1.0f - t;
+		scale1 = t;
+	}
+
+	*this = ( scale0 * from ) + ( scale1 * temp );
+	return *this;
+}
+#endif
+
+#if 0
+static void JointToMatrix(md5jointmat_t *m, md5joint_t *j)
+{
+	float	wx, wy, wz;
+	float	xx, yy, yz;
+	float	xy, xz, zz;
+	float	x2, y2, z2;
+
+	x2 = j->q[0] + j->q[0];
+	y2 = j->q[1] + j->q[1];
+	z2 = j->q[2] + j->q[2];
+
+	xx = j->q[0] * x2;
+	xy = j->q[0] * y2;
+	xz = j->q[0] * z2;
+
+	yy = j->q[1] * y2;
+	yz = j->q[1] * z2;
+	zz = j->q[2] * z2;
+
+	wx = j->q[3] * x2;
+	wy = j->q[3] * y2;
+	wz = j->q[3] * z2;
+
+	m->m[0][0] = 1.0f - (yy + zz);
+	m->m[0][1] = (xy - wz);
+	m->m[0][2] = (xz + wy);
+	m->m[0][3] = j->p[0];
+
+	m->m[1][0] = (xy + wz);
+	m->m[1][1] = 1.0f - (xx + zz);
+	m->m[1][2] = (yz - wx);
+	m->m[1][3] = j->p[1];
+
+	m->m[2][0] = (xz - wy);
+	m->m[2][1] = (yz + wx);
+	m->m[2][2] = 1.0f - (xx + yy);
+	m->m[2][3] = j->p[2];
+}
+#endif
+
+#if 1
+static void JointToMatrix(md5jointmat_t *m, md5joint_t *j)
+{
+	float xx, xy, xz, xw;
+	float yy, yz, yw;
+	float zz, zw;
+
+	xx = j->q[0] * j->q[0];
+	xy = j->q[0] * j->q[1];
+	xz = j->q[0] * j->q[2];
+	xw = j->q[0] * j->q[3];
+
+	yy = j->q[1] * j->q[1];
+	yz = j->q[1] * j->q[2];
+	yw = j->q[1] * j->q[3];
+
+	zz = j->q[2] * j->q[2];
+	zw = j->q[2] * j->q[3];
+
+	m->m[0][0] = 1.0f - 2.0f * (yy + zz);
+	m->m[0][1] = 2.0f * (xy - zw);
+	m->m[0][2] = 2.0f * (xz + yw);
+	m->m[0][3] = j->p[0];
+
+	m->m[1][0] = 2.0f * (xy + zw);
+	m->m[1][1] = 1.0f - 2.0f * (xx + zz);
+	m->m[1][2] = 2.0f * (yz - xw);
+	m->m[1][3] = j->p[1];
+
+	m->m[2][0] = 2.0f * (xz - yw);
+	m->m[2][1] = 2.0f * (yz + xw);
+	m->m[2][2] = 1.0f - 2.0f * (xx + yy);
+	m->m[2][3] = j->p[2];
+}
+#endif
+
+static void JointMatrixMul(md5jointmat_t *c, md5jointmat_t *a, md5jointmat_t *b)
+{
+	c->m[0][0] = a->m[0][0] * b->m[0][0] + a->m[0][1] * b->m[1][0] + a->m[0][2] * b->m[2][0];
+	c->m[0][1] = a->m[0][0] * b->m[0][1] + a->m[0][1] * b->m[1][1] + a->m[0][2] * b->m[2][1];
+	c->m[0][2] = a->m[0][0] * b->m[0][2] + a->m[0][1] * b->m[1][2] + a->m[0][2] * b->m[2][2];
+	c->m[0][3] = a->m[0][0] * b->m[0][3] + a->m[0][1] * b->m[1][3] + a->m[0][2] * b->m[2][3] + a->m[0][3];
+
+	c->m[1][0] = a->m[1][0] * b->m[0][0] + a->m[1][1] * b->m[1][0] + a->m[1][2] * b->m[2][0];
+	c->m[1][1] = a->m[1][0] * b->m[0][1] + a->m[1][1] * b->m[1][1] + a->m[1][2] * b->m[2][1];
+	c->m[1][2] = a->m[1][0] * b->m[0][2] + a->m[1][1] * b->m[1][2] + a->m[1][2] * b->m[2][2];
+	c->m[1][3] = a->m[1][0] * b->m[0][3] + a->m[1][1] * b->m[1][3] + a->m[1][2] * b->m[2][3] + a->m[1][3];
+
+	c->m[2][0] = a->m[2][0] * b->m[0][0] + a->m[2][1] * b->m[1][0] + a->m[2][2] * b->m[2][0];
+	c->m[2][1] = a->m[2][0] * b->m[0][1] + a->m[2][1] * b->m[1][1] + a->m[2][2] * b->m[2][1];
+	c->m[2][2] = a->m[2][0] * b->m[0][2] + a->m[2][1] * b->m[1][2] + a->m[2][2] * b->m[2][2];
+	c->m[2][3] = a->m[2][0] * b->m[0][3] + a->m[2][1] * b->m[1][3] + a->m[2][2] * b->m[2][3] + a->m[2][3];
+}
+
+static void JointVertexMul(float *c, md5jointmat_t *m, float *v)
+{
+	c[0] = m->m[0][0] * v[0] + m->m[0][1] * v[1] + m->m[0][2] * v[2] + m->m[0][3];
+	c[1] = m->m[1][0] * v[0] + m->m[1][1] * v[1] + m->m[1][2] * v[2] + m->m[1][3];
+	c[2] = m->m[2][0] * v[0] + m->m[2][1] * v[1] + m->m[2][2] * v[2] + m->m[2][3];
+}
+
+static void PrintMatrix(md5jointmat_t *m)
+{
+	printf("\n");
+	printf("%3.6f, %3.6f, %3.6f, %3.6f\n", m->m[0][0], m->m[0][1], m->m[0][2], m->m[0][3]);
+	printf("%3.6f, %3.6f, %3.6f, %3.6f\n", m->m[1][0], m->m[1][1], m->m[1][2], m->m[1][3]);
+	printf("%3.6f, %3.6f, %3.6f, %3.6f\n", m->m[2][0], m->m[2][1], m->m[2][2], m->m[2][3]);
+}
+
+static void PrintJoint(md5joint_t *j)
+{
+	printf("joint (%3.6f, %3.6f, %3.6f) (%3.6f, %3.6f, %3.6f %3.6f)\n",
+		j->p[0], j->p[1], j->p[2],
+		j->q[0], j->q[1], j->q[2], j->q[3]);
+}
+
+static void ComputeLocalMatrices(md5jointmat_t *matrices, md5joint_t *joints, int numjoints)
+{
+	for(int i = 0; i < numjoints; i++)
+	{
+		JointToMatrix(&matrices[i], &joints[i]);
+	}
+}
+
+static void PoseToMatrix(md5jointmat_t *m, md5pose_t *pose, int i)
+{
+	md5joint_t j;
+
+	j.p[0] = pose->p[0][i];
+	j.p[1] = pose->p[1][i];
+	j.p[2] = pose->p[2][i];
+	j.q[0] = pose->q[0][i];
+	j.q[1] = pose->q[1][i];
+	j.q[2] = pose->q[2][i];
+	j.q[3] = pose->q[3][i];
+
+	JointToMatrix(m, &j);
+}
+
+// builds the global matrix palette for a pose in a single pass. joints are
+// sorted at load so a parent is always before its children, which means the
+// parent's global matrix is ready by the time the child needs it. only the
+// animated joints are in the pose, the static ones are copied in first
+static void ComputeGlobalMatrices_Generic(md5jointmat_t *matrices, md5pose_t *pose, md5anim_t *anim)
+{
+	for(int k = 0; k < anim->numstaticjoints; k++)
+	{
+		int i = anim->staticjoints[k];
+		matrices[i] = anim->staticpalette[i];
+	}
+
+	for(int k = 0; k < anim->numanimatedjoints; k++)
+	{
+		int i = anim->animatedjoints[k];
+		int parentindex = anim->parents[i];
+
+		if(parentindex == -1)
+		{
+			PoseToMatrix(&matrices[i], pose, i);
+			continue;
+		}
+
+		md5jointmat_t localjointmat;
+		PoseToMatrix(&localjointmat, pose, i);
+		JointMatrixMul(&matrices[i], &matrices[parentindex], &localjointmat);
+	}
+}
+
+// one spare float past the planes for the components that are dropped
+#define POSE_FLOATS(stride)	(POSE_NUM_PLANES * (stride) + 1)
+
+static void Pose_SetPlanes(md5pose_t *pose, float *planes, int stride)
+{
+	for(int i = 0; i < 3; i++)
+	{
+		pose->p[i] = planes + i * stride;
+	}
+	for(int i = 0; i < 4; i++)
+	{
+		pose->q[i] = planes + (3 + i) * stride;
+	}
+}
+
+static void Mem_AllocPose(md5pose_t *pose, int stride)
+{
+	Pose_SetPlanes(pose, (float*)Mem_AllocAligned(POSE_FLOATS(stride) * sizeof(float), 64), stride);
+}
+
+// the decode plan is made after the anim's joints have been sorted and its
+// constant components pruned, so it is never out of step with the frame data
+static void BuildDecodePlan(md5anim_t *md5anim)
+{
+	int numjoints = md5anim->numjoints;
+	int stride = POSE_STRIDE(numjoints);
+
+	// the old decode walked the flags without checking, a mismatch read past
+	// the end of the frame
+	int numcomponents = 0;
+	for(int i = 0; i < numjoints; i++)
+	{
+		numcomponents += NumAnimatedComponents(md5anim->joints[i].flags);
+	}
+
+	if(numcomponents != md5anim->numanimatedcomponents)
+	{
+		Error("anim \"%s\" flags %i components, frames have %i\n", md5anim->name, numcomponents, md5anim->numanimatedcomponents);
+	}
+
+	md5anim->posestride = stride;
+	md5anim->parents = (int*)Mem_Alloc(numjoints * sizeof(int));
+	md5anim->decodeslots = (int*)Mem_Alloc(numcomponents * sizeof(int));
+
+	// the padding joints are identity rotations so the loops over whole
+	// planes never see garbage
+	md5anim->basepose = (float*)Mem_AllocAligned(POSE_NUM_PLANES * stride * sizeof(float), 64);
+	memset(md5anim->basepose, 0, POSE_NUM_PLANES * stride * sizeof(float));
+
+	int numslots = 0;
+	for(int i = 0; i < numjoints; i++)
+	{
+		md5joint_t *j = &md5anim->joints[i];
+
+		md5anim->parents[i] = j->parentindex;
+
+		// don't offset the base joint, its translation goes to the spare float
+		for(int c = 0; c < 3; c++)
+		{
+			md5anim->basepose[c * stride + i] = (i == 0) ? 0.0f : j->p[c];
+			md5anim->basepose[(3 + c) * stride + i] = j->q[c];
+		}
+
+		// the components are packed in flag bit order, which is also the
+		// order of the planes
+		for(int c = 0; c < 6; c++)
+		{
+			if(!(j->flags & (1 << c)))
+				continue;
+
+			md5anim->decodeslots[numslots++] = (i == 0 && c < 3) ? POSE_NUM_PLANES * stride : c * stride + i;
+		}
+	}
+
+	// quantized tracks go where their components would have. a rotation has
+	// to be all three of a joint's, which only a bad cache could get wrong
+	md5quantanim_t *quant = md5anim->quant;
+	if(quant)
+	{
+		for(int k = 0; k < quant->numtracks; k++)
+		{
+			quant->trackslots[k] = md5anim->decodeslots[quant->trackcomponents[k]];
+		}
+
+		for(int k = 0; k < quant->numrotations; k++)
+		{
+			int c = quant->rotationcomponents[k];
+			int slot = md5anim->decodeslots[c];
+			int joint = slot - 3 * stride;
+
+			if(c + 2 >= numcomponents || joint < 0 || joint >= numjoints ||
+				md5anim->decodeslots[c + 1] != slot + stride || md5anim->decodeslots[c + 2] != slot + 2 * stride)
+			{
+				Error("anim \"%s\" has a quantized rotation that isn't one joint's\n", md5anim->name);
+			}
+
+			quant->rotationjoints[k] = joint;
+		}
+	}
+}
+
+// w comes back from the unit length of every rotation at once, count is a
+// multiple of 8
+static void ComputePoseW_Generic(md5pose_t *pose, int count)
+{
+	for(int i = 0; i < count; i++)
+	{
+		float x = pose->q[0][i];
+		float y = pose->q[1][i];
+		float z = pose->q[2][i];
+
+		pose->q[3][i] = -sqrtf(fabs(1.0f - (x * x + y * y + z * z)));
+	}
+}
+
+#ifdef USE_SIMD
+static void ComputePoseW_SSE2(md5pose_t *pose, int count)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 signbit = _mm_set1_ps(-0.0f);
+
+	for(int i = 0; i < count; i += 4)
+	{
+		__m128 x = _mm_load_ps(pose->q[0] + i);
+		__m128 y = _mm_load_ps(pose->q[1] + i);
+		__m128 z = _mm_load_ps(pose->q[2] + i);
+
+		__m128 t = _mm_sub_ps(one, _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+		t = _mm_sqrt_ps(_mm_andnot_ps(signbit, t));
+
+		_mm_store_ps(pose->q[3] + i, _mm_or_ps(t, signbit));
+	}
+}
+
+// no fma here, a fused square sum would make w differ from the other paths
+__attribute__((target("avx2")))
+static void ComputePoseW_AVX2(md5pose_t *pose, int count)
+{
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 signbit = _mm256_set1_ps(-0.0f);
+
+	for(int i = 0; i < count; i += 8)
+	{
+		__m256 x = _mm256_load_ps(pose->q[0] + i);
+		__m256 y = _mm256_load_ps(pose->q[1] + i);
+		__m256 z = _mm256_load_ps(pose->q[2] + i);
+
+		__m256 t = _mm256_sub_ps(one, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z)));
+		t = _mm256_sqrt_ps(_mm256_andnot_ps(signbit, t));
+
+		_mm256_store_ps(pose->q[3] + i, _mm256_or_ps(t, signbit));
+	}
+}
+#endif
+
+typedef void (*posewfunc_t)(md5pose_t *pose, int count);
+
+static posewfunc_t ComputePoseW = ComputePoseW_Generic;
+
+// smallest three: the largest component is dropped and rebuilt from the
+// others, which are then all within +-1/sqrt(2). two of the three carry a
+// bit of the dropped component's index in their top bit
+#define QUANT_ROTATION_RANGE	0.70710678f
+#define QUANT_ROTATION_SCALE	(2.0f * QUANT_ROTATION_RANGE / 32767.0f)
+
+// the simd versions finish off their last few with these
+static void DecodeTrackRange(float *planes, md5quantanim_t *quant, const unsigned short *data, int first, int last)
+{
+	for(int k = first; k < last; k++)
+	{
+		planes[quant->trackslots[k]] = (float)data[k] * quant->trackscale[k] + quant->trackmin[k];
+	}
+}
+
+static void DecodeRotation(float *q, unsigned short a, unsigned short b, unsigned short c)
+{
+	float s[3];
+	s[0] = (float)(a & 0x7fff) * QUANT_ROTATION_SCALE - QUANT_ROTATION_RANGE;
+	s[1] = (float)(b & 0x7fff) * QUANT_ROTATION_SCALE - QUANT_ROTATION_RANGE;
+	s[2] = (float)(c & 0x7fff) * QUANT_ROTATION_SCALE - QUANT_ROTATION_RANGE;
+
+	float t = 1.0f - (s[0] * s[0] + s[1] * s[1] + s[2] * s[2]);
+	float largest = sqrtf(t > 0.0f ? t : 0.0f);
+
+	int index = (a >> 15) | ((b >> 15) << 1);
+
+	for(int i = 0, j = 0; i < 4; i++)
+	{
+		q[i] = (i == index) ? largest : s[j++];
+	}
+}
+
+static void DecodeRotationRange(md5pose_t *pose, md5quantanim_t *quant, const unsigned short *data, int first, int last)
+{
+	int n = quant->numrotations;
+	const unsigned short *da = data + quant->numtracks;
+	const unsigned short *db = da + n;
+	const unsigned short *dc = db + n;
+
+	for(int k = first; k < last; k++)
+	{
+		float q[4];
+		DecodeRotation(q, da[k], db[k], dc[k]);
+
+		int joint = quant->rotationjoints[k];
+
+		for(int c = 0; c < 4; c++)
+		{
+			pose->q[c][joint] = q[c];
+		}
+	}
+}
+
+static void DecodeTracks_Generic(float *planes, md5quantanim_t *quant, const unsigned short *data)
+{
+	DecodeTrackRange(planes, quant, data, 0, quant->numtracks);
+}
+
+static void DecodeRotations_Generic(md5pose_t *pose, md5quantanim_t *quant, const unsigned short *data)
+{
+	DecodeRotationRange(pose, quant, data, 0, quant->numrotations);
+}
+
+#ifdef USE_SIMD
+static void DecodeTracks_SSE2(float *planes, md5quantanim_t *quant, const unsigned short *data)
+{
+	const __m128i zero = _mm_setzero_si128();
+	int k = 0;
+
+	for(; k + 8 <= quant->numtracks; k += 8)
+	{
+		__m128i u = _mm_loadu_si128((const __m128i*)(data + k));
+
+		__m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(u, zero));
+		__m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(u, zero));
+
+		float v[8];
+		_mm_storeu_ps(v, _mm_add_ps(_mm_mul_ps(lo, _mm_loadu_ps(quant->trackscale + k)), _mm_loadu_ps(quant->trackmin + k)));
+		_mm_storeu_ps(v + 4, _mm_add_ps(_mm_mul_ps(hi, _mm_loadu_ps(quant->trackscale + k + 4)), _mm_loadu_ps(quant->trackmin + k + 4)));
+
+		for(int i = 0; i < 8; i++)
+		{
+			planes[quant->trackslots[k + i]] = v[i];
+		}
+	}
+
+	DecodeTrackRange(planes, quant, data, k, quant->numtracks);
+}
+
+static __m128 Select_SSE2(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static void DecodeRotations_SSE2(md5pose_t *pose, md5quantanim_t *quant, const unsigned short *data)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i low15 = _mm_set1_epi32(0x7fff);
+	const __m128 scale = _mm_set1_ps(QUANT_ROTATION_SCALE);
+	const __m128 range = _mm_set1_ps(QUANT_ROTATION_RANGE);
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	int n = quant->numrotations;
+	const unsigned short *da = data + quant->numtracks;
+	const unsigned short *db = da + n;
+	const unsigned short *dc = db + n;
+	int k = 0;
+
+	for(; k + 4 <= n; k += 4)
+	{
+		__m128i ua = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(da + k)), zero);
+		__m128i ub = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(db + k)), zero);
+		__m128i uc = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(dc + k)), zero);
+
+		__m128 a = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(ua, low15)), scale), range);
+		__m128 b = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(ub, low15)), scale), range);
+		__m128 c = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(uc, low15)), scale), range);
+
+		__m128 t = _mm_sub_ps(one, _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, a), _mm_mul_ps(b, b)), _mm_mul_ps(c, c)));
+		__m128 largest = _mm_sqrt_ps(_mm_max_ps(t, _mm_setzero_ps()));
+
+		__m128i index = _mm_or_si128(_mm_srli_epi32(ua, 15), _mm_slli_epi32(_mm_srli_epi32(ub, 15), 1));
+		__m128 m0 = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(0)));
+		__m128 m1 = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(1)));
+		__m128 m2 = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(2)));
+		__m128 m3 = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(3)));
+
+		float q[4][4];
+		_mm_storeu_ps(q[0], Select_SSE2(m0, largest, a));
+		_mm_storeu_ps(q[1], Select_SSE2(m0, a, Select_SSE2(m1, largest, b)));
+		_mm_storeu_ps(q[2], Select_SSE2(m3, c, Select_SSE2(m2, largest, b)));
+		_mm_storeu_ps(q[3], Select_SSE2(m3, largest, c));
+
+		for(int i = 0; i < 4; i++)
+		{
+			int joint = quant->rotationjoints[k + i];
+
+			pose->q[0][joint] = q[0][i];
+			pose->q[1][joint] = q[1][i];
+			pose->q[2][joint] = q[2][i];
+			pose->q[3][joint] = q[3][i];
+		}
+	}
+
+	DecodeRotationRange(pose, quant, data, k, n);
+}
+
+// no fma, so every path decodes to the same bits
+__attribute__((target("avx2")))
+static void DecodeTracks_AVX2(float *planes, md5quantanim_t *quant, const unsigned short *data)
+{
+	int k = 0;
+
+	for(; k + 8 <= quant->numtracks; k += 8)
+	{
+		__m256 u = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(data + k))));
+
+		float v[8];
+		_mm256_storeu_ps(v, _mm256_add_ps(_mm256_mul_ps(u, _mm256_loadu_ps(quant->trackscale + k)), _mm256_loadu_ps(quant->trackmin + k)));
+
+		for(int i = 0; i < 8; i++)
+		{
+			planes[quant->trackslots[k + i]] = v[i];
+		}
+	}
+
+	DecodeTrackRange(planes, quant, data, k, quant->numtracks);
+}
+
+__attribute__((target("avx2")))
+static __m256 Select_AVX2(__m256 mask, __m256 a, __m256 b)
+{
+	return _mm256_blendv_ps(b, a, mask);
+}
+
+__attribute__((target("avx2")))
+static void DecodeRotations_AVX2(md5pose_t *pose, md5quantanim_t *quant, const unsigned short *data)
+{
+	const __m256i low15 = _mm256_set1_epi32(0x7fff);
+	const __m256 scale = _mm256_set1_ps(QUANT_ROTATION_SCALE);
+	const __m256 range = _mm256_set1_ps(QUANT_ROTATION_RANGE);
+	const __m256 one = _mm256_set1_ps(1.0f);
+
+	int n = quant->numrotations;
+	const unsigned short *da = data + quant->numtracks;
+	const unsigned short *db = da + n;
+	const unsigned short *dc = db + n;
+	int k = 0;
+
+	for(; k + 8 <= n; k += 8)
+	{
+		__m256i ua = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(da + k)));
+		__m256i ub = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(db + k)));
+		__m256i uc = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(dc + k)));
+
+		__m256 a = _mm256_sub_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(ua, low15)), scale), range);
+		__m256 b = _mm256_sub_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(ub, low15)), scale), range);
+		__m256 c = _mm256_sub_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(uc, low15)), scale), range);
+
+		__m256 t = _mm256_sub_ps(one, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a, a), _mm256_mul_ps(b, b)), _mm256_mul_ps(c, c)));
+		__m256 largest = _mm256_sqrt_ps(_mm256_max_ps(t, _mm256_setzero_ps()));
+
+		__m256i index = _mm256_or_si256(_mm256_srli_epi32(ua, 15), _mm256_slli_epi32(_mm256_srli_epi32(ub, 15), 1));
+		__m256 m0 = _mm256_castsi256_ps(_mm256_cmpeq_epi32(index, _mm256_set1_epi32(0)));
+		__m256 m1 = _mm256_castsi256_ps(_mm256_cmpeq_epi32(index, _mm256_set1_epi32(1)));
+		__m256 m2 = _mm256_castsi256_ps(_mm256_cmpeq_epi32(index, _mm256_set1_epi32(2)));
+		__m256 m3 = _mm256_castsi256_ps(_mm256_cmpeq_epi32(index, _mm256_set1_epi32(3)));
+
+		float q[4][8];
+		_mm256_storeu_ps(q[0], Select_AVX2(m0, largest, a));
+		_mm256_storeu_ps(q[1], Select_AVX2(m0, a, Select_AVX2(m1, largest, b)));
+		_mm256_storeu_ps(q[2], Select_AVX2(m3, c, Select_AVX2(m2, largest, b)));
+		_mm256_storeu_ps(q[3], Select_AVX2(m3, largest, c));
+
+		for(int i = 0; i < 8; i++)
+		{
+			int joint = quant->rotationjoints[k + i];
+
+			pose->q[0][joint] = q[0][i];
+			pose->q[1][joint] = q[1][i];
+			pose->q[2][joint] = q[2][i];
+			pose->q[3][joint] = q[3][i];
+		}
+	}
+
+	DecodeRotationRange(pose, quant, data, k, n);
+}
+#endif
+
+// the keys either side of the frame are found with a binary search
+static float EvaluateReducedTrack(md5reducedanim_t *reduced, int track, int frame)
+{
+	int lo = reduced->firstkey[track];
+	int hi = reduced->firstkey[track + 1] - 1;
+	int last = hi;
+
+	// the last key at or before the frame, the first key is always frame 0
+	while(lo < hi)
+	{
+		int mid = (lo + hi + 1) >> 1;
+
+		if(reduced->keytimes[mid] <= frame)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	float v0 = reduced->keyvalues[lo];
+
+	if(lo == last)
+	{
+		return v0;
+	}
+
+	int t0 = reduced->keytimes[lo];
+	int t1 = reduced->keytimes[lo + 1];
+	float frac = (float)(frame - t0) / (float)(t1 - t0);
+
+	return v0 + (reduced->keyvalues[lo + 1] - v0) * frac;
+}
+
+static void EvaluateReducedTracks(float *planes, md5reducedanim_t *reduced, int frame)
+{
+	for(int t = 0; t < reduced->numtracks; t++)
+	{
+		planes[reduced->trackslots[t]] = EvaluateReducedTrack(reduced, t, frame);
+	}
+}
+
+typedef void (*tracksfunc_t)(float *planes, md5quantanim_t *quant, const unsigned short *data);
+typedef void (*rotationsfunc_t)(md5pose_t *pose, md5quantanim_t *quant, const unsigned short *data);
+
+static tracksfunc_t DecodeTracks = DecodeTracks_Generic;
+static rotationsfunc_t DecodeRotations = DecodeRotations_Generic;
+
+// the base pose covers every joint, so the frame's own components are all
+// that is left to copy in. static joints have none, they just come along.
+// quantized rotations bring their own w, so they go in after it is rebuilt
+static void ComputeFramePose(md5pose_t *pose, md5anim_t *anim, int frame)
+{
+	float *planes = pose->p[0];
+
+	memcpy(planes, anim->basepose, (POSE_NUM_PLANES - 1) * anim->posestride * sizeof(float));
+
+	if(anim->reduced)
+	{
+		EvaluateReducedTracks(planes, anim->reduced, frame);
+		ComputePoseW(pose, anim->posestride);
+		return;
+	}
+
+	md5quantanim_t *quant = anim->quant;
+	if(quant)
+	{
+		const unsigned short *data = quant->frames + frame * quant->framepitch;
+
+		DecodeTracks(planes, quant, data);
+		ComputePoseW(pose, anim->posestride);
+		DecodeRotations(pose, quant, data);
+		return;
+	}
+
+	const float *framedata = anim->framedata + frame * anim->numanimatedcomponents;
+	const int *slots = anim->decodeslots;
+
+	for(int k = 0; k < anim->numanimatedcomponents; k++)
+	{
+		planes[slots[k]] = framedata[k];
+	}
+
+	ComputePoseW(pose, anim->posestride);
+}
+
+static unsigned short QuantizeRotationComponent(float v, int topbit)
+{
+	int u = (int)floorf((v + QUANT_ROTATION_RANGE) / QUANT_ROTATION_SCALE + 0.5f);
+
+	if(u < 0)
+		u = 0;
+	if(u > 32767)
+		u = 32767;
+
+	return (unsigned short)(u | (topbit << 15));
+}
+
+// largest difference between two poses' components, with each rotation
+// taken on whichever side is closer since q and -q are the same rotation.
+// also gives back the largest angle between the rotations in degrees
+static float MaxPoseError(md5pose_t *a, md5pose_t *b, int numjoints, float *maxangle)
+{
+	float maxerror = 0.0f;
+
+	for(int i = 0; i < numjoints; i++)
+	{
+		for(int c = 0; c < 3; c++)
+		{
+			float error = fabs(a->p[c][i] - b->p[c][i]);
+			if(error > maxerror)
+				maxerror = error;
+		}
+
+		// in double and over the lengths, acos near 1 would turn float
+		// rounding into the whole answer
+		double cosom = 0.0, lena = 0.0, lenb = 0.0;
+		for(int c = 0; c < 4; c++)
+		{
+			cosom += (double)a->q[c][i] * b->q[c][i];
+			lena += (double)a->q[c][i] * a->q[c][i];
+			lenb += (double)b->q[c][i] * b->q[c][i];
+		}
+		float sign = (cosom < 0.0) ? -1.0f : 1.0f;
+
+		for(int c = 0; c < 4; c++)
+		{
+			float error = fabs(sign * a->q[c][i] - b->q[c][i]);
+			if(error > maxerror)
+				maxerror = error;
+		}
+
+		if(maxangle)
+		{
+			float angle = (float)(2.0 * acos(fmin(1.0, fabs(cosom) / sqrt(lena * lenb))) * (180.0 / PI));
+			if(angle > *maxangle)
+				*maxangle = angle;
+		}
+	}
+
+	return maxerror;
+}
+
+// the floats aren't kept once the anim decodes from something smaller.
+// parsed ones go with their stack, mapped ones give back the pages they cover
+static void ReleaseFrameData(md5anim_t *anim)
+{
+	if(anim->framestack)
+	{
+		Mem_FreeStack(anim->framestack);
+	}
+	else
+	{
+		size_t pagesize = sysconf(_SC_PAGESIZE);
+		size_t start = (size_t)anim->framedata;
+		size_t end = start + (size_t)anim->numframes * anim->numanimatedcomponents * sizeof(float);
+
+		start = (start + pagesize - 1) & ~(pagesize - 1);
+		end &= ~(pagesize - 1);
+
+		if(end > start)
+		{
+			munmap((void*)start, end - start);
+		}
+	}
+
+	anim->framedata = NULL;
+}
+
+// builds the 16 bit frames from the float ones straight after parsing, with
+// the components still in file order, and drops the floats. what was lost is
+// measured with the generic decoders, --verify checks the others against them.
+// the root's translation is kept as a track since which joint is the root
+// isn't settled until the anim is linked to its model
+static void QuantizeAnim(md5anim_t *anim, memstack_t *tempstack)
+{
+	const int rotationflags = MD5_ANIM_QX | MD5_ANIM_QY | MD5_ANIM_QZ;
+	int numjoints = anim->numjoints;
+	int numcomponents = anim->numanimatedcomponents;
+	int numframes = anim->numframes;
+
+	md5quantanim_t *quant = (md5quantanim_t*)Mem_Alloc(sizeof(md5quantanim_t));
+	memset(quant, 0, sizeof(*quant));
+
+	for(int i = 0; i < numjoints; i++)
+	{
+		int flags = anim->joints[i].flags;
+
+		if((flags & rotationflags) == rotationflags)
+		{
+			quant->numrotations++;
+			flags &= ~rotationflags;
+		}
+		quant->numtracks += NumAnimatedComponents(flags);
+	}
+
+	quant->trackcomponents = (int*)Mem_Alloc(quant->numtracks * sizeof(int));
+	quant->trackslots = (int*)Mem_Alloc(quant->numtracks * sizeof(int));
+	quant->trackmin = (float*)Mem_Alloc(quant->numtracks * sizeof(float));
+	quant->trackscale = (float*)Mem_Alloc(quant->numtracks * sizeof(float));
+	quant->rotationcomponents = (int*)Mem_Alloc(quant->numrotations * sizeof(int));
+	quant->rotationjoints = (int*)Mem_Alloc(quant->numrotations * sizeof(int));
+
+	// until the decode plan is built the tracks decode back to their own
+	// components and the rotations to a lane each
+	for(int i = 0, c = 0, t = 0, r = 0; i < numjoints; i++)
+	{
+		int flags = anim->joints[i].flags;
+
+		for(int k = 0; k < 6; k++)
+		{
+			if(!(flags & (1 << k)))
+				continue;
+
+			if(k < 3 || (flags & rotationflags) != rotationflags)
+			{
+				quant->trackcomponents[t] = c;
+				quant->trackslots[t++] = c;
+			}
+			else if(k == 3)
+			{
+				quant->rotationcomponents[r] = c;
+				quant->rotationjoints[r] = r;
+				r++;
+			}
+			c++;
+		}
+	}
+
+	quant->framepitch = quant->numtracks + 3 * quant->numrotations;
+	quant->frames = (unsigned short*)Mem_AllocAligned(numframes * quant->framepitch * sizeof(unsigned short), 16);
+
+	memstack_t *animstack = Mem_SetStack(tempstack);
+
+	// the range of every track
+	float *trackmax = (float*)Mem_Alloc(quant->numtracks * sizeof(float));
+	for(int k = 0; k < quant->numtracks; k++)
+	{
+		const float *src = anim->framedata + quant->trackcomponents[k];
+
+		quant->trackmin[k] = trackmax[k] = src[0];
+		for(int f = 1; f < numframes; f++)
+		{
+			float v = src[f * numcomponents];
+
+			if(v < quant->trackmin[k])
+				quant->trackmin[k] = v;
+			if(v > trackmax[k])
+				trackmax[k] = v;
+		}
+
+		quant->trackscale[k] = (trackmax[k] - quant->trackmin[k]) / 65535.0f;
+	}
+
+	// the rotations with w rebuilt the way ComputePoseW does it, in lanes
+	md5pose_t source, decoded;
+	int rotationstride = POSE_STRIDE(quant->numrotations);
+	Mem_AllocPose(&source, rotationstride);
+	Mem_AllocPose(&decoded, rotationstride);
+	memset(source.p[0], 0, POSE_FLOATS(rotationstride) * sizeof(float));
+	memset(decoded.p[0], 0, POSE_FLOATS(rotationstride) * sizeof(float));
+
+	float *components = (float*)Mem_Alloc(numcomponents * sizeof(float));
+	float maxerror = 0.0f;
+	float maxangle = 0.0f;
+
+	for(int f = 0; f < numframes; f++)
+	{
+		const float *src = anim->framedata + f * numcomponents;
+		unsigned short *data = quant->frames + f * quant->framepitch;
+
+		for(int k = 0; k < quant->numtracks; k++)
+		{
+			float v = src[quant->trackcomponents[k]];
+			int u = quant->trackscale[k] ? (int)floorf((v - quant->trackmin[k]) / quant->trackscale[k] + 0.5f) : 0;
+
+			data[k] = (unsigned short)(u < 0 ? 0 : (u > 65535 ? 65535 : u));
+		}
+
+		unsigned short *da = data + quant->numtracks;
+		unsigned short *db = da + quant->numrotations;
+		unsigned short *dc = db + quant->numrotations;
+
+		for(int k = 0; k < quant->numrotations; k++)
+		{
+			const float *xyz = src + quant->rotationcomponents[k];
+
+			float q[4];
+			for(int c = 0; c < 3; c++)
+			{
+				q[c] = source.q[c][k] = xyz[c];
+			}
+			q[3] = source.q[3][k] = -sqrtf(fabs(1.0f - (q[0] * q[0] + q[1] * q[1] + q[2] * q[2])));
+			Quat_Normalize(q);
+
+			int index = 0;
+			for(int c = 1; c < 4; c++)
+			{
+				if(fabs(q[c]) > fabs(q[index]))
+					index = c;
+			}
+
+			// the dropped component is rebuilt positive
+			float sign = (q[index] < 0.0f) ? -1.0f : 1.0f;
+
+			float smallest[3];
+			for(int c = 0, j = 0; c < 4; c++)
+			{
+				if(c != index)
+					smallest[j++] = sign * q[c];
+			}
+
+			da[k] = QuantizeRotationComponent(smallest[0], index & 1);
+			db[k] = QuantizeRotationComponent(smallest[1], index >> 1);
+			dc[k] = QuantizeRotationComponent(smallest[2], 0);
+		}
+
+		DecodeTracks_Generic(components, quant, data);
+		DecodeRotations_Generic(&decoded, quant, data);
+
+		for(int k = 0; k < quant->numtracks; k++)
+		{
+			int c = quant->trackcomponents[k];
+
+			float error = fabs(components[c] - src[c]);
+			if(error > maxerror)
+				maxerror = error;
+		}
+
+		float error = MaxPoseError(&decoded, &source, quant->numrotations, &maxangle);
+		if(error > maxerror)
+			maxerror = error;
+	}
+
+	Mem_SetStack(animstack);
+
+	size_t floatsize = (size_t)numframes * numcomponents * sizeof(float);
+	size_t quantsize = sizeof(md5quantanim_t) + (size_t)numframes * quant->framepitch * sizeof(unsigned short) +
+		quant->numtracks * (2 * sizeof(int) + 2 * sizeof(float)) + quant->numrotations * 2 * sizeof(int);
+
+	printf("quantized \"%s\": %zu KB to %zu KB (%.1fx), %i tracks, %i rotations, max error %g, max rotation error %.4f degrees\n",
+		anim->name, floatsize / 1024, quantsize / 1024, (double)floatsize / quantsize,
+		quant->numtracks, quant->numrotations, maxerror, maxangle);
+
+	ReleaseFrameData(anim);
+	anim->quant = quant;
+}
+
+// whole planes are blended, static joints and padding included, which keeps
+// the loops plain enough for the compiler to vectorize
+static void LerpJoints(md5pose_t *result, md5pose_t *from, md5pose_t *to, float t, md5anim_t *anim)
+{
+	int stride = anim->posestride;
+
+	for(int c = 0; c < 3; c++)
+	{
+		float *r = result->p[c];
+		const float *a = from->p[c];
+		const float *b = to->p[c];
+
+		for(int i = 0; i < stride; i++)
+		{
+			r[i] = ((1 - t) * a[i]) + (t * b[i]);
+		}
+	}
+
+	// normalized lerp a lane at a time, the short way round
+	for(int i = 0; i < stride; i++)
+	{
+		float cosom = from->q[0][i] * to->q[0][i] + from->q[1][i] * to->q[1][i] + from->q[2][i] * to->q[2][i] + from->q[3][i] * to->q[3][i];
+
+		float scale0 = 1.0f - t;
+		float scale1 = ( cosom > 0.0f ) ? t : -t;
+
+		float x = scale0 * from->q[0][i] + scale1 * to->q[0][i];
+		float y = scale0 * from->q[1][i] + scale1 * to->q[1][i];
+		float z = scale0 * from->q[2][i] + scale1 * to->q[2][i];
+		float w = scale0 * from->q[3][i] + scale1 * to->q[3][i];
+
+		float s = 1.0f / sqrtf( x * x + y * y + z * z + w * w );
+
+		result->q[0][i] = x * s;
+		result->q[1][i] = y * s;
+		result->q[2][i] = z * s;
+		result->q[3][i] = w * s;
+	}
+}
+
+static void PrintJointList(md5joint_t *joints, int numjoints)
+{
+	for(int i = 0; i < numjoints; i++)
+	{
+		if(i != 62)
+			continue;
+		PrintJoint(&joints[i]);
+	}
+}
+
+static void PrintMatrixList(md5jointmat_t *matrices, int nummatrices)
+{
+	for(int i = 0; i < nummatrices; i++)
+	{
+		if(i != 62)
+			continue;
+
+		PrintMatrix(&matrices[i]);
+	}
+}
+
+// ======================================================================================
+// Skinning setup
+
+// inverse of a rigid joint matrix, the rotation part is transposed and the
+// translation taken back through it
+static void JointMatrixInverse(md5jointmat_t *inv, md5jointmat_t *m)
+{
+	for(int i = 0; i < 3; i++)
+	{
+		for(int j = 0; j < 3; j++)
+		{
+			inv->m[i][j] = m->m[j][i];
+		}
+	}
+
+	for(int i = 0; i < 3; i++)
+	{
+		inv->m[i][3] = -(inv->m[i][0] * m->m[0][3] + inv->m[i][1] * m->m[1][3] + inv->m[i][2] * m->m[2][3]);
+	}
+}
+
+// the skinning matrix takes a bind pose vertex to the current pose
+static void ComputeSkinMatrices_Generic(md5jointmat_t *skinmats, md5jointmat_t *palette, md5jointmat_t *inversebindmats, md5anim_t *anim)
+{
+	for(int k = 0; k < anim->numstaticjoints; k++)
+	{
+		int i = anim->staticjoints[k];
+		skinmats[i] = anim->staticskinmats[i];
+	}
+
+	for(int k = 0; k < anim->numanimatedjoints; k++)
+	{
+		int i = anim->animatedjoints[k];
+		JointMatrixMul(&skinmats[i], &palette[i], &inversebindmats[i]);
+	}
+}
+
+#ifdef USE_SIMD
+// the batched palette turns the pose into local matrices 4 or 8 joints at a
+// time straight from the planes, then concatenates them parents first. a row
+// of the product is the parent's row spread over the child's rows, summed in
+// the same order as JointMatrixMul, so every path gives the same bits
+
+static void StoreMatrices_SSE2(md5jointmat_t *mats, int count, __m128 m[3][4])
+{
+	for(int r = 0; r < 3; r++)
+	{
+		__m128 row[4] = { m[r][0], m[r][1], m[r][2], m[r][3] };
+
+		_MM_TRANSPOSE4_PS(row[0], row[1], row[2], row[3]);
+
+		for(int i = 0; i < count; i++)
+		{
+			_mm_storeu_ps(mats[i].m[r], row[i]);
+		}
+	}
+}
+
+static void PoseToMatrices_SSE2(md5jointmat_t *matrices, md5pose_t *pose, int numjoints)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+
+	for(int i = 0; i < numjoints; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(pose->q[0] + i);
+		__m128 y = _mm_loadu_ps(pose->q[1] + i);
+		__m128 z = _mm_loadu_ps(pose->q[2] + i);
+		__m128 w = _mm_loadu_ps(pose->q[3] + i);
+
+		__m128 xx = _mm_mul_ps(x, x), xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), xw = _mm_mul_ps(x, w);
+		__m128 yy = _mm_mul_ps(y, y), yz = _mm_mul_ps(y, z), yw = _mm_mul_ps(y, w);
+		__m128 zz = _mm_mul_ps(z, z), zw = _mm_mul_ps(z, w);
+
+		__m128 m[3][4];
+
+		m[0][0] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz)));
+		m[0][1] = _mm_mul_ps(two, _mm_sub_ps(xy, zw));
+		m[0][2] = _mm_mul_ps(two, _mm_add_ps(xz, yw));
+		m[0][3] = _mm_loadu_ps(pose->p[0] + i);
+
+		m[1][0] = _mm_mul_ps(two, _mm_add_ps(xy, zw));
+		m[1][1] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz)));
+		m[1][2] = _mm_mul_ps(two, _mm_sub_ps(yz, xw));
+		m[1][3] = _mm_loadu_ps(pose->p[1] + i);
+
+		m[2][0] = _mm_mul_ps(two, _mm_sub_ps(xz, yw));
+		m[2][1] = _mm_mul_ps(two, _mm_add_ps(yz, xw));
+		m[2][2] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)));
+		m[2][3] = _mm_loadu_ps(pose->p[2] + i);
+
+		StoreMatrices_SSE2(matrices + i, numjoints - i < 4 ? numjoints - i : 4, m);
+	}
+}
+
+// the translation goes in the last lane, and -0 in the others leaves them as
+// they are where +0 would turn a -0 around
+static const union { unsigned int u[4]; __m128 v; } translationmask = { { 0, 0, 0, 0xffffffff } };
+static const union { unsigned int u[4]; __m128 v; } translationzero = { { 0x80000000, 0x80000000, 0x80000000, 0 } };
+
+// c = a * b, c may be b
+static void JointMatrixMul_SSE2(md5jointmat_t *c, const md5jointmat_t *a, const md5jointmat_t *b)
+{
+	__m128 b0 = _mm_loadu_ps(b->m[0]);
+	__m128 b1 = _mm_loadu_ps(b->m[1]);
+	__m128 b2 = _mm_loadu_ps(b->m[2]);
+
+	for(int r = 0; r < 3; r++)
+	{
+		__m128 sum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a->m[r][0]), b0), _mm_mul_ps(_mm_set1_ps(a->m[r][1]), b1)), _mm_mul_ps(_mm_set1_ps(a->m[r][2]), b2));
+		__m128 translation = _mm_or_ps(_mm_and_ps(_mm_set1_ps(a->m[r][3]), translationmask.v), translationzero.v);
+
+		_mm_storeu_ps(c->m[r], _mm_add_ps(sum, translation));
+	}
+}
+
+static void ConcatenateJoints_SSE2(md5jointmat_t *matrices, md5anim_t *anim)
+{
+	for(int k = 0; k < anim->numstaticjoints; k++)
+	{
+		int i = anim->staticjoints[k];
+		matrices[i] = anim->staticpalette[i];
+	}
+
+	// roots are left as their local matrix
+	for(int k = 0; k < anim->numanimatedjoints; k++)
+	{
+		int i = anim->animatedjoints[k];
+		int parentindex = anim->parents[i];
+
+		if(parentindex != -1)
+		{
+			JointMatrixMul_SSE2(&matrices[i], &matrices[parentindex], &matrices[i]);
+		}
+	}
+}
+
+static void ComputeGlobalMatrices_SSE2(md5jointmat_t *matrices, md5pose_t *pose, md5anim_t *anim)
+{
+	PoseToMatrices_SSE2(matrices, pose, anim->numjoints);
+	ConcatenateJoints_SSE2(matrices, anim);
+}
+
+static void ComputeSkinMatrices_SSE2(md5jointmat_t *skinmats, md5jointmat_t *palette, md5jointmat_t *inversebindmats, md5anim_t *anim)
+{
+	for(int k = 0; k < anim->numstaticjoints; k++)
+	{
+		int i = anim->staticjoints[k];
+		skinmats[i] = anim->staticskinmats[i];
+	}
+
+	for(int k = 0; k < anim->numanimatedjoints; k++)
+	{
+		int i = anim->animatedjoints[k];
+		JointMatrixMul_SSE2(&skinmats[i], &palette[i], &inversebindmats[i]);
+	}
+}
+
+// avx2 does 8 joints to the transpose and broadcasts straight from memory.
+// no fma, for the same bits as the others
+__attribute__((target("avx2")))
+static void Transpose4x4_AVX2(__m256 *a, __m256 *b, __m256 *c, __m256 *d)
+{
+	__m256 t0 = _mm256_unpacklo_ps(*a, *b);
+	__m256 t1 = _mm256_unpacklo_ps(*c, *d);
+	__m256 t2 = _mm256_unpackhi_ps(*a, *b);
+	__m256 t3 = _mm256_unpackhi_ps(*c, *d);
+
+	*a = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+	*b = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+	*c = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+	*d = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+// joints 4-7 come out of the transpose in the upper halves
+__attribute__((target("avx2")))
+static void StoreMatrices_AVX2(md5jointmat_t *mats, int count, __m256 m[3][4])
+{
+	for(int r = 0; r < 3; r++)
+	{
+		__m256 row[4] = { m[r][0], m[r][1], m[r][2], m[r][3] };
+
+		Transpose4x4_AVX2(&row[0], &row[1], &row[2], &row[3]);
+
+		for(int i = 0; i < count; i++)
+		{
+			__m128 half = i < 4 ? _mm256_castps256_ps128(row[i]) : _mm256_extractf128_ps(row[i - 4], 1);
+			_mm_storeu_ps(mats[i].m[r], half);
+		}
+	}
+}
+
+__attribute__((target("avx2")))
+static void PoseToMatrices_AVX2(md5jointmat_t *matrices, md5pose_t *pose, int numjoints)
+{
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 two = _mm256_set1_ps(2.0f);
+
+	for(int i = 0; i < numjoints; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(pose->q[0] + i);
+		__m256 y = _mm256_loadu_ps(pose->q[1] + i);
+		__m256 z = _mm256_loadu_ps(pose->q[2] + i);
+		__m256 w = _mm256_loadu_ps(pose->q[3] + i);
+
+		__m256 xx = _mm256_mul_ps(x, x), xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), xw = _mm256_mul_ps(x, w);
+		__m256 yy = _mm256_mul_ps(y, y), yz = _mm256_mul_ps(y, z), yw = _mm256_mul_ps(y, w);
+		__m256 zz = _mm256_mul_ps(z, z), zw = _mm256_mul_ps(z, w);
+
+		__m256 m[3][4];
+
+		m[0][0] = _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz)));
+		m[0][1] = _mm256_mul_ps(two, _mm256_sub_ps(xy, zw));
+		m[0][2] = _mm256_mul_ps(two, _mm256_add_ps(xz, yw));
+		m[0][3] = _mm256_loadu_ps(pose->p[0] + i);
+
+		m[1][0] = _mm256_mul_ps(two, _mm256_add_ps(xy, zw));
+		m[1][1] = _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz)));
+		m[1][2] = _mm256_mul_ps(two, _mm256_sub_ps(yz, xw));
+		m[1][3] = _mm256_loadu_ps(pose->p[1] + i);
+
+		m[2][0] = _mm256_mul_ps(two, _mm256_sub_ps(xz, yw));
+		m[2][1] = _mm256_mul_ps(two, _mm256_add_ps(yz, xw));
+		m[2][2] = _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy)));
+		m[2][3] = _mm256_loadu_ps(pose->p[2] + i);
+
+		StoreMatrices_AVX2(matrices + i, numjoints - i < 8 ? numjoints - i : 8, m);
+	}
+}
+
+__attribute__((target("avx2")))
+static void JointMatrixMul_AVX2(md5jointmat_t *c, const md5jointmat_t *a, const md5jointmat_t *b)
+{
+	__m128 b0 = _mm_loadu_ps(b->m[0]);
+	__m128 b1 = _mm_loadu_ps(b->m[1]);
+	__m128 b2 = _mm_loadu_ps(b->m[2]);
+
+	for(int r = 0; r < 3; r++)
+	{
+		__m128 sum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_broadcast_ss(&a->m[r][0]), b0), _mm_mul_ps(_mm_broadcast_ss(&a->m[r][1]), b1)), _mm_mul_ps(_mm_broadcast_ss(&a->m[r][2]), b2));
+		__m128 translation = _mm_blend_ps(translationzero.v, _mm_broadcast_ss(&a->m[r][3]), 8);
+
+		_mm_storeu_ps(c->m[r], _mm_add_ps(sum, translation));
+	}
+}
+
+__attribute__((target("avx2")))
+static void ConcatenateJoints_AVX2(md5jointmat_t *matrices, md5anim_t *anim)
+{
+	for(int k = 0; k < anim->numstaticjoints; k++)
+	{
+		int i = anim->staticjoints[k];
+		matrices[i] = anim->staticpalette[i];
+	}
+
+	for(int k = 0; k < anim->numanimatedjoints; k++)
+	{
+		int i = anim->animatedjoints[k];
+		int parentindex = anim->parents[i];
+
+		if(parentindex != -1)
+		{
+			JointMatrixMul_AVX2(&matrices[i], &matrices[parentindex], &matrices[i]);
+		}
+	}
+}
+
+__attribute__((target("avx2")))
+static void ComputeGlobalMatrices_AVX2(md5jointmat_t *matrices, md5pose_t *pose, md5anim_t *anim)
+{
+	PoseToMatrices_AVX2(matrices, pose, anim->numjoints);
+	ConcatenateJoints_AVX2(matrices, anim);
+}
+
+__attribute__((target("avx2")))
+static void ComputeSkinMatrices_AVX2(md5jointmat_t *skinmats, md5jointmat_t *palette, md5jointmat_t *inversebindmats, md5anim_t *anim)
+{
+	for(int k = 0; k < anim->numstaticjoints; k++)
+	{
+		int i = anim->staticjoints[k];
+		skinmats[i] = anim->staticskinmats[i];
+	}
+
+	for(int k = 0; k < anim->numanimatedjoints; k++)
+	{
+		int i = anim->animatedjoints[k];
+		JointMatrixMul_AVX2(&skinmats[i], &palette[i], &inversebindmats[i]);
+	}
+}
+#endif
+
+typedef void (*globalmatricesfunc_t)(md5jointmat_t *matrices, md5pose_t *pose, md5anim_t *anim);
+typedef void (*skinmatricesfunc_t)(md5jointmat_t *skinmats, md5jointmat_t *palette, md5jointmat_t *inversebindmats, md5anim_t *anim);
+
+static globalmatricesfunc_t ComputeGlobalMatrices = ComputeGlobalMatrices_Generic;
+static skinmatricesfunc_t ComputeSkinMatrices = ComputeSkinMatrices_Generic;
+
+// splits the joints into the ones that animate and the static subtrees that
+// don't. the static matrices come from building the first frame with every
+// joint counted as animated, the joints have to be sorted already
+static void FindStaticJoints(md5model_t *model, md5anim_t *anim)
+{
+	int numjoints = anim->numjoints;
+
+	if(numjoints != model->numjoints)
+	{
+		Error("anim \"%s\" has %i joints, model has %i\n", anim->name, numjoints, model->numjoints);
+	}
+
+	anim->animatedjoints = (int*)Mem_Alloc(numjoints * sizeof(int));
+	anim->staticjoints = (int*)Mem_Alloc(numjoints * sizeof(int));
+	anim->staticpalette = (md5jointmat_t*)Mem_AllocAligned(numjoints * sizeof(md5jointmat_t), 64);
+	anim->staticskinmats = (md5jointmat_t*)Mem_AllocAligned(numjoints * sizeof(md5jointmat_t), 64);
+
+	for(int i = 0; i < numjoints; i++)
+	{
+		anim->animatedjoints[i] = i;
+	}
+	anim->numanimatedjoints = numjoints;
+	anim->numstaticjoints = 0;
+
+	md5pose_t pose;
+	Mem_AllocPose(&pose, anim->posestride);
+	ComputeFramePose(&pose, anim, 0);
+	ComputeGlobalMatrices_Generic(anim->staticpalette, &pose, anim);
+	ComputeSkinMatrices_Generic(anim->staticskinmats, anim->staticpalette, model->inversebindmats, anim);
+
+	bool *isstatic = (bool*)Mem_Alloc(numjoints * sizeof(bool));
+
+	anim->numanimatedjoints = 0;
+	for(int i = 0; i < numjoints; i++)
+	{
+		int parentindex = anim->joints[i].parentindex;
+
+		isstatic[i] = !anim->joints[i].flags && (parentindex == -1 || isstatic[parentindex]);
+
+		if(isstatic[i])
+			anim->staticjoints[anim->numstaticjoints++] = i;
+		else
+			anim->animatedjoints[anim->numanimatedjoints++] = i;
+	}
+}
+
+// keyframe reduction. every track keeps the fewest keys that hold it within
+// its own tolerance, which comes from how far the joint is from the vertices
+// it carries. joint errors add up down the hierarchy, so the result is
+// checked at the skinned vertices and done again tighter if it is over
+
+static float reducetolerance;			// model units at the vertices, 0 keeps every frame
+static float reduceangle = 0.5f;		// degrees at any joint
+
+// a key at least this often keeps the fitting cheap
+#define REDUCE_MAX_KEY_GAP	64
+
+// whether the line from key a to key b holds every frame in between
+static bool ReduceSegmentFits(const float *values, int a, int b, float tolerance)
+{
+	for(int f = a + 1; f < b; f++)
+	{
+		// the same sum EvaluateReducedTracks does
+		float frac = (float)(f - a) / (float)(b - a);
+		float v = values[a] + (values[b] - values[a]) * frac;
+
+		if(fabs(v - values[f]) > tolerance)
+			return false;
+	}
+
+	return true;
+}
+
+// largest distance from each vertex to the joints that move it, ancestors included
+static float *ReduceJointRadii(md5model_t *model)
+{
+	int numjoints = model->numjoints;
+	float *radii = (float*)Mem_Alloc(numjoints * sizeof(float));
+	memset(radii, 0, numjoints * sizeof(float));
+
+	for(md5mesh_t *mesh = model->meshes; mesh; mesh = mesh->next)
+	{
+		for(int v = 0; v < mesh->numvertices; v++)
+		{
+			md5skinvert_t *sv = &mesh->skinverts[v];
+
+			for(int w = 0; w < MD5_MAX_VERTEX_WEIGHTS; w++)
+			{
+				if(sv->weights[w] == 0.0f)
+					continue;
+
+				for(int j = sv->joints[w]; j != -1; j = model->joints[j].parentindex)
+				{
+					float d[3];
+					for(int c = 0; c < 3; c++)
+					{
+						d[c] = sv->xyz[c] - model->joints[j].p[c];
+					}
+
+					float r = sqrtf(Vector_Dot(d, d));
+					if(r > radii[j])
+						radii[j] = r;
+				}
+			}
+		}
+	}
+
+	return radii;
+}
+
+// largest distance between the vertices skinned with two sets of matrices.
+// skinning is linear, so it is done once with the difference of the two
+static float MaxSkinnedVertexError(md5model_t *model, md5jointmat_t *a, md5jointmat_t *b, md5jointmat_t *difference)
+{
+	float maxerror = 0.0f;
+
+	for(int i = 0; i < model->numjoints; i++)
+	{
+		for(int r = 0; r < 3; r++)
+		{
+			for(int c = 0; c < 4; c++)
+			{
+				difference[i].m[r][c] = a[i].m[r][c] - b[i].m[r][c];
+			}
+		}
+	}
+
+	for(md5mesh_t *mesh = model->meshes; mesh; mesh = mesh->next)
+	{
+		for(int v = 0; v < mesh->numvertices; v++)
+		{
+			md5skinvert_t *sv = &mesh->skinverts[v];
+			float d[3] = { 0.0f, 0.0f, 0.0f };
+
+			for(int w = 0; w < MD5_MAX_VERTEX_WEIGHTS; w++)
+			{
+				float t[3];
+				JointVertexMul(t, &difference[sv->joints[w]], sv->xyz);
+
+				for(int c = 0; c < 3; c++)
+				{
+					d[c] += sv->weights[w] * t[c];
+				}
+			}
+
+			float error = sqrtf(Vector_Dot(d, d));
+			if(error > maxerror)
+				maxerror = error;
+		}
+	}
+
+	return maxerror;
+}
+
+// fits the keys for every track at the given fraction of its tolerance
+static void ReduceTracks(md5reducedanim_t *reduced, const float *values, const float *tolerances, int numframes, float scale)
+{
+	int numkeys = 0;
+
+	for(int t = 0; t < reduced->numtracks; t++)
+	{
+		const float *v = values + t * numframes;
+		float tolerance = tolerances[t] * scale;
+
+		reduced->firstkey[t] = numkeys;
+		reduced->keytimes[numkeys] = 0;
+		reduced->keyvalues[numkeys++] = v[0];
+
+		for(int a = 0; a < numframes - 1; )
+		{
+			int b = a + 1;
+			while(b + 1 < numframes && b + 1 - a <= REDUCE_MAX_KEY_GAP && ReduceSegmentFits(v, a, b + 1, tolerance))
+			{
+				b++;
+			}
+
+			reduced->keytimes[numkeys] = (unsigned short)b;
+			reduced->keyvalues[numkeys++] = v[b];
+			a = b;
+		}
+	}
+
+	reduced->firstkey[reduced->numtracks] = numkeys;
+}
+
+// the joint lists have to be built already, the error is measured through
+// the whole palette. the fitting is done on the temporary stack with room
+// for every key, only the keys that are kept are copied to the anim's, and
+// the floats are dropped once the reduced tracks are used
+static void ReduceAnim(md5model_t *model, md5anim_t *anim, memstack_t *tempstack)
+{
+	int numjoints = anim->numjoints;
+	int numframes = anim->numframes;
+	int stride = anim->posestride;
+
+	if(numframes > 65536)
+	{
+		Warning("anim \"%s\" has too many frames to reduce\n", anim->name);
+		return;
+	}
+
+	md5reducedanim_t *reduced = (md5reducedanim_t*)Mem_Alloc(sizeof(md5reducedanim_t));
+	memset(reduced, 0, sizeof(*reduced));
+
+	// the root joint's translation is never used
+	int discard = POSE_NUM_PLANES * stride;
+	for(int k = 0; k < anim->numanimatedcomponents; k++)
+	{
+		if(anim->decodeslots[k] != discard)
+			reduced->numtracks++;
+	}
+
+	reduced->trackslots = (int*)Mem_Alloc(reduced->numtracks * sizeof(int));
+	reduced->firstkey = (int*)Mem_Alloc((reduced->numtracks + 1) * sizeof(int));
+
+	memstack_t *animstack = Mem_SetStack(tempstack);
+
+	reduced->keytimes = (unsigned short*)Mem_Alloc(reduced->numtracks * numframes * sizeof(unsigned short));
+	reduced->keyvalues = (float*)Mem_Alloc(reduced->numtracks * numframes * sizeof(float));
+
+	float *radii = ReduceJointRadii(model);
+	float *tolerances = (float*)Mem_Alloc(reduced->numtracks * sizeof(float));
+	float anglelimit = reduceangle * (PI / 180.0f);
+
+	for(int k = 0, t = 0; k < anim->numanimatedcomponents; k++)
+	{
+		int slot = anim->decodeslots[k];
+		if(slot == discard)
+			continue;
+
+		int plane = slot / stride;
+		int joint = slot % stride;
+
+		reduced->trackslots[t] = slot;
+
+		// a rotation component off by e turns the joint by about 2e
+		if(plane < 3)
+		{
+			tolerances[t] = reducetolerance;
+		}
+		else
+		{
+			float angle = anglelimit;
+			if(radii[joint] * angle > reducetolerance)
+				angle = reducetolerance / radii[joint];
+
+			tolerances[t] = 0.5f * angle;
+		}
+		t++;
+	}
+
+	// every track's value in every frame
+	md5pose_t source, decoded;
+	Mem_AllocPose(&source, stride);
+	Mem_AllocPose(&decoded, stride);
+
+	float *values = (float*)Mem_Alloc(reduced->numtracks * numframes * sizeof(float));
+	for(int f = 0; f < numframes; f++)
+	{
+		ComputeFramePose(&source, anim, f);
+
+		for(int t = 0; t < reduced->numtracks; t++)
+		{
+			values[t * numframes + f] = source.p[0][reduced->trackslots[t]];
+		}
+	}
+
+	md5jointmat_t *palette = (md5jointmat_t*)Mem_AllocAligned(numjoints * sizeof(md5jointmat_t), 64);
+	md5jointmat_t *skinmats = (md5jointmat_t*)Mem_AllocAligned(numjoints * sizeof(md5jointmat_t), 64);
+	md5jointmat_t *sourceskinmats = (md5jointmat_t*)Mem_AllocAligned(numjoints * sizeof(md5jointmat_t), 64);
+	md5jointmat_t *difference = (md5jointmat_t*)Mem_AllocAligned(numjoints * sizeof(md5jointmat_t), 64);
+
+	float scale = 1.0f;
+	float maxerror, vertexerror, maxangle;
+	int numtries = 0;
+
+	for(;;)
+	{
+		ReduceTracks(reduced, values, tolerances, numframes, scale);
+		numtries++;
+
+		maxerror = 0.0f;
+		vertexerror = 0.0f;
+		maxangle = 0.0f;
+
+		for(int f = 0; f < numframes; f++)
+		{
+			anim->reduced = NULL;
+			ComputeFramePose(&source, anim, f);
+			ComputeGlobalMatrices(palette, &source, anim);
+			ComputeSkinMatrices(sourceskinmats, palette, model->inversebindmats, anim);
+
+			anim->reduced = reduced;
+			ComputeFramePose(&decoded, anim, f);
+			ComputeGlobalMatrices(palette, &decoded, anim);
+			ComputeSkinMatrices(skinmats, palette, model->inversebindmats, anim);
+
+			float error = MaxPoseError(&decoded, &source, numjoints, &maxangle);
+			if(error > maxerror)
+				maxerror = error;
+
+			error = MaxSkinnedVertexError(model, skinmats, sourceskinmats, difference);
+			if(error > vertexerror)
+				vertexerror = error;
+		}
+
+		// the last go is close enough to keeping every frame that it stands
+		if((vertexerror <= reducetolerance && maxangle <= reduceangle) || numtries == 8)
+			break;
+
+		scale *= 0.5f;
+	}
+
+	Mem_SetStack(animstack);
+
+	int numkeys = reduced->firstkey[reduced->numtracks];
+	size_t floatsize = (size_t)numframes * anim->numanimatedcomponents * sizeof(float);
+	size_t reducedsize = sizeof(md5reducedanim_t) + (size_t)numkeys * (sizeof(unsigned short) + sizeof(float)) +
+		(2 * reduced->numtracks + 1) * sizeof(int);
+
+	// few frames of busy motion can keep nearly every key, which is bigger
+	// than the floats were
+	if(reducedsize >= floatsize)
+	{
+		anim->reduced = NULL;
+
+		printf("reduced \"%s\": kept %i of %i keys, no smaller than the %zu KB of floats so not used\n",
+			anim->name, numkeys, reduced->numtracks * numframes, floatsize / 1024);
+		return;
+	}
+
+	unsigned short *keytimes = (unsigned short*)Mem_Alloc(numkeys * sizeof(unsigned short));
+	float *keyvalues = (float*)Mem_Alloc(numkeys * sizeof(float));
+
+	memcpy(keytimes, reduced->keytimes, numkeys * sizeof(unsigned short));
+	memcpy(keyvalues, reduced->keyvalues, numkeys * sizeof(float));
+	reduced->keytimes = keytimes;
+	reduced->keyvalues = keyvalues;
+
+	ReleaseFrameData(anim);
+
+	printf("reduced \"%s\": kept %i of %i keys (%.1f%%), %zu KB to %zu KB, max error %g, max vertex error %g, max rotation error %.4f degrees, %i %s\n",
+		anim->name, numkeys, reduced->numtracks * numframes, reduced->numtracks ? 100.0 * numkeys / (reduced->numtracks * numframes) : 0.0,
+		floatsize / 1024, reducedsize / 1024, maxerror, vertexerror, maxangle, numtries, numtries == 1 ? "pass" : "passes");
+}
+
+// per vertex normal, tangent and bitangent averaged from the triangles around
+// it. done once on the bind pose at load, and every frame when the normals
+// are recomputed from the skinned positions. every triangle's frame is built
+// first, then each vertex gathers the triangles it is used by, so both passes
+// can be split up without two threads adding into the same vertex
+typedef struct tangentframe_s
+{
+	float	normal[3];
+	float	tangent[2][3];
+
+} tangentframe_t;
+
+// the triangle frames padded out to 16 byte vectors, normal, tangent and
+// bitangent with a zero after each
+#define FACEFRAME_FLOATS	12
+
+// vertex to triangle adjacency in compressed rows, the triangles using vertex
+// i are vertextris[firstvertextri[i]] up to firstvertextri[i + 1] in the order
+// they are in the mesh
+static void BuildVertexAdjacency(md5mesh_t *mesh)
+{
+	mesh->firstvertextri = (int*)Mem_Alloc((mesh->numvertices + 1) * sizeof(int));
+	mesh->vertextris = (int*)Mem_Alloc(mesh->numtris * 3 * sizeof(int));
+
+	memset(mesh->firstvertextri, 0, (mesh->numvertices + 1) * sizeof(int));
+
+	for(int i = 0; i < mesh->numtris; i++)
+	{
+		for(int j = 0; j < 3; j++)
+		{
+			int vertex = mesh->tris[i].indicies[j];
+
+			if(vertex < 0 || vertex >= mesh->numvertices)
+			{
+				Error("triangle %i uses vertex %i of %i\n", i, vertex, mesh->numvertices);
+			}
+
+			mesh->firstvertextri[vertex + 1]++;
+		}
+	}
+
+	for(int i = 0; i < mesh->numvertices; i++)
+	{
+		mesh->firstvertextri[i + 1] += mesh->firstvertextri[i];
+	}
+
+	// fill in triangle order, then walk the starts back down into place
+	for(int i = 0; i < mesh->numtris; i++)
+	{
+		for(int j = 0; j < 3; j++)
+		{
+			int vertex = mesh->tris[i].indicies[j];
+			mesh->vertextris[mesh->firstvertextri[vertex]++] = i;
+		}
+	}
+
+	for(int i = mesh->numvertices; i > 0; i--)
+	{
+		mesh->firstvertextri[i] = mesh->firstvertextri[i - 1];
+	}
+	mesh->firstvertextri[0] = 0;
+}
+
+static float *Mem_AllocFaceFrames(int numtris)
+{
+	return (float*)Mem_AllocAligned(numtris * FACEFRAME_FLOATS * sizeof(float), 64);
+}
+
+// frames for the triangles in [first, last), xyz is three floats per vertex
+static void ComputeFaceFrames_Generic(float *faces, const float *xyz, md5mesh_t *mesh, int first, int last)
+{
+	for(int i = first; i < last; i++)
+	{
+		// get the three vertices for the triangle
+		int ia = mesh->tris[i].indicies[0];
+		int ib = mesh->tris[i].indicies[1];
+		int ic = mesh->tris[i].indicies[2];
+
+		const float *axyz = xyz + ia * 3;
+		const float *bxyz = xyz + ib * 3;
+		const float *cxyz = xyz + ic * 3;
+
+		// the full precision texcoords, the half float stream is only for drawing
+		const float *ast = mesh->vertices[ia].texcoords;
+		const float *bst = mesh->vertices[ib].texcoords;
+		const float *cst = mesh->vertices[ic].texcoords;
+
+		// compute direction vectors
+		float d0[5];
+		d0[0] = bxyz[0] - axyz[0];
+		d0[1] = bxyz[1] - axyz[1];
+		d0[2] = bxyz[2] - axyz[2];
+		d0[3] = bst[0] - ast[0];
+		d0[4] = bst[1] - ast[1];
+		
+		float d1[5];
+		d1[0] = cxyz[0] - axyz[0];
+		d1[1] = cxyz[1] - axyz[1];
+		d1[2] = cxyz[2] - axyz[2];
+		d1[3] = cst[0] - ast[0];
+		d1[4] = cst[1] - ast[1];
+		
+		// calculate normal
+		float normal[3];
+		normal[0] = d1[1] * d0[2] - d1[2] * d0[1];
+		normal[1] = d1[2] * d0[0] - d1[0] * d0[2];
+		normal[2] = d1[0] * d0[1] - d1[1] * d0[0];
+
+		const float f0 = 1.0f / sqrtf( normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2] );
+		
+		normal[0] *= f0;
+		normal[1] *= f0;
+		normal[2] *= f0;
+
+		// texture area sign bit
+		const float area = d0[3] * d1[4] - d0[4] * d1[3];
+		unsigned int signbit = FloatToUnsignedInt(area) & ( 1 << 31 );
+		
+		// calculate tangents
+		float tangent[3];
+		tangent[0] = d0[0] * d1[4] - d0[4] * d1[0];
+		tangent[1] = d0[1] * d1[4] - d0[4] * d1[1];
+		tangent[2] = d0[2] * d1[4] - d0[4] * d1[2];
+		
+		float f1 = 1.0f / sqrtf( tangent[0] * tangent[0] + tangent[1] * tangent[1] + tangent[2] * tangent[2] );
+		f1 = UnsignedIntToFloat(FloatToUnsignedInt(f1) ^ signbit);
+		
+		tangent[0] *= f1;
+		tangent[1] *= f1;
+		tangent[2] *= f1;
+		
+		float bitangent[3];
+		bitangent[0] = d0[3] * d1[0] - d0[0] * d1[3];
+		bitangent[1] = d0[3] * d1[1] - d0[1] * d1[3];
+		bitangent[2] = d0[3] * d1[2] - d0[2] * d1[3];
+		
+		float f2 = 1.0f / sqrtf( bitangent[0] * bitangent[0] + bitangent[1] * bitangent[1] + bitangent[2] * bitangent[2] );
+		f2 = UnsignedIntToFloat(FloatToUnsignedInt(f2) ^ signbit);
+		
+		bitangent[0] *= f2;
+		bitangent[1] *= f2;
+		bitangent[2] *= f2;
+
+		float *face = faces + i * FACEFRAME_FLOATS;
+		face[0] = normal[0];
+		face[1] = normal[1];
+		face[2] = normal[2];
+		face[3] = 0.0f;
+		face[4] = tangent[0];
+		face[5] = tangent[1];
+		face[6] = tangent[2];
+		face[7] = 0.0f;
+		face[8] = bitangent[0];
+		face[9] = bitangent[1];
+		face[10] = bitangent[2];
+		face[11] = 0.0f;
+	}
+}
+
+// sums the frames of the triangles using a vertex, before normalizing
+static void GatherTangentFrame(tangentframe_t *v, const float *faces, md5mesh_t *mesh, int vertex)
+{
+	v->normal[0] = v->normal[1] = v->normal[2] = 0.0f;
+	v->tangent[0][0] = v->tangent[0][1] = v->tangent[0][2] = 0.0f;
+	v->tangent[1][0] = v->tangent[1][1] = v->tangent[1][2] = 0.0f;
+
+	for(int i = mesh->firstvertextri[vertex]; i < mesh->firstvertextri[vertex + 1]; i++)
+	{
+		const float *face = faces + mesh->vertextris[i] * FACEFRAME_FLOATS;
+
+		v->normal[0] += face[0];
+		v->normal[1] += face[1];
+		v->normal[2] += face[2];
+		v->tangent[0][0] += face[4];
+		v->tangent[0][1] += face[5];
+		v->tangent[0][2] += face[6];
+		v->tangent[1][0] += face[8];
+		v->tangent[1][1] += face[9];
+		v->tangent[1][2] += face[10];
+	}
+}
+
+// returns the side of the bitangent
+static int NormalizeTangentFrame(tangentframe_t *v)
+{
+	const float f0 = 1.0f / sqrtf( v->normal[0] * v->normal[0] + v->normal[1] * v->normal[1] + v->normal[2] * v->normal[2] );
+
+	v->normal[0] *= f0;
+	v->normal[1] *= f0;
+	v->normal[2] *= f0;
+
+	const float f1 = 1.0f / sqrtf( v->tangent[0][0] * v->tangent[0][0] + v->tangent[0][1] * v->tangent[0][1] + v->tangent[0][2] * v->tangent[0][2] );
+
+	v->tangent[0][0] *= f1;
+	v->tangent[0][1] *= f1;
+	v->tangent[0][2] *= f1;
+
+	const float f2 = 1.0f / sqrtf( v->tangent[1][0] * v->tangent[1][0] + v->tangent[1][1] * v->tangent[1][1] + v->tangent[1][2] * v->tangent[1][2] );
+
+	v->tangent[1][0] *= f2;
+	v->tangent[1][1] *= f2;
+	v->tangent[1][2] *= f2;
+
+	// the bitangent is rebuilt from the other two, only its side is kept
+	float cross[3];
+	Vector_Cross(cross, v->normal, v->tangent[0]);
+	int sign = Vector_Dot(cross, v->tangent[1]) < 0.0f ? -1 : 1;
+
+	return sign;
+}
+
+// the skinned normals mode takes these through the blended joint matrices
+// every frame instead of rebuilding them from the triangles
+static void BuildBindTangentFrames(md5mesh_t *mesh)
+{
+	float *xyz = (float*)Mem_Alloc(mesh->numvertices * 3 * sizeof(float));
+	float *faces = Mem_AllocFaceFrames(mesh->numtris);
+
+	for(int i = 0; i < mesh->numvertices; i++)
+	{
+		Vector_Copy(xyz + i * 3, mesh->skinverts[i].xyz);
+	}
+
+	ComputeFaceFrames_Generic(faces, xyz, mesh, 0, mesh->numtris);
+
+	for(int i = 0; i < mesh->numvertices; i++)
+	{
+		md5skinvert_t *sv = &mesh->skinverts[i];
+
+		tangentframe_t frame;
+		GatherTangentFrame(&frame, faces, mesh, i);
+
+		sv->tangentsign = NormalizeTangentFrame(&frame);
+		Vector_Copy(sv->normal, frame.normal);
+		Vector_Copy(sv->tangent, frame.tangent[0]);
+	}
+}
+
+static void BuildSkinStreams(md5mesh_t *mesh)
+{
+	md5skinstreams_t *streams = &mesh->skinstreams;
+
+	streams->numvertices = (mesh->numvertices + 7) & ~7;
+
+	for(int i = 0; i < 3; i++)
+	{
+		streams->xyz[i] = (float*)Mem_AllocAligned(streams->numvertices * sizeof(float), 64);
+		streams->normal[i] = (float*)Mem_AllocAligned(streams->numvertices * sizeof(float), 64);
+		streams->tangent[i] = (float*)Mem_AllocAligned(streams->numvertices * sizeof(float), 64);
+	}
+	streams->tangentw = (unsigned int*)Mem_AllocAligned(streams->numvertices * sizeof(unsigned int), 64);
+	for(int k = 0; k < MD5_MAX_VERTEX_WEIGHTS; k++)
+	{
+		streams->joints[k] = (int*)Mem_AllocAligned(streams->numvertices * sizeof(int), 64);
+		streams->weights[k] = (float*)Mem_AllocAligned(streams->numvertices * sizeof(float), 64);
+	}
+
+	for(int i = 0; i < streams->numvertices; i++)
+	{
+		if(i >= mesh->numvertices)
+		{
+			for(int j = 0; j < 3; j++)
+			{
+				streams->xyz[j][i] = 0.0f;
+				streams->normal[j][i] = 0.0f;
+				streams->tangent[j][i] = 0.0f;
+			}
+			streams->tangentw[i] = 0;
+			for(int k = 0; k < MD5_MAX_VERTEX_WEIGHTS; k++)
+			{
+				streams->joints[k][i] = 0;
+				streams->weights[k][i] = 0.0f;
+			}
+			continue;
+		}
+
+		md5skinvert_t *sv = &mesh->skinverts[i];
+
+		for(int j = 0; j < 3; j++)
+		{
+			streams->xyz[j][i] = sv->xyz[j];
+			streams->normal[j][i] = sv->normal[j];
+			streams->tangent[j][i] = sv->tangent[j];
+		}
+		streams->tangentw[i] = (sv->tangentsign & 3) << 30;
+		for(int k = 0; k < MD5_MAX_VERTEX_WEIGHTS; k++)
+		{
+			streams->joints[k][i] = sv->joints[k];
+			streams->weights[k][i] = sv->weights[k];
+		}
+	}
+}
+
+// convert the per weight joint space offsets into a single bind pose position
+// per vertex with at most MD5_MAX_VERTEX_WEIGHTS influences. the mesh joints
+// are already in model space so they give the bind pose directly
+static void BuildSkinVertices(md5model_t *model)
+{
+	md5jointmat_t *bindmats = (md5jointmat_t*)Mem_Alloc(model->numjoints * sizeof(md5jointmat_t));
+	model->inversebindmats = (md5jointmat_t*)Mem_Alloc(model->numjoints * sizeof(md5jointmat_t));
+
+	for(int i = 0; i < model->numjoints; i++)
+	{
+		JointToMatrix(&bindmats[i], &model->joints[i]);
+		JointMatrixInverse(&model->inversebindmats[i], &bindmats[i]);
+	}
+
+	for(md5mesh_t *mesh = model->meshes; mesh; mesh = mesh->next)
+	{
+		int numpruned = 0;
+		float maxdroppedweight = 0.0f;
+		float maxerror = 0.0f;
+
+		mesh->skinverts = (md5skinvert_t*)Mem_Alloc(mesh->numvertices * sizeof(md5skinvert_t));
+
+		for(int i = 0; i < mesh->numvertices; i++)
+		{
+			md5vertex_t *v = &mesh->vertices[i];
+			md5skinvert_t *sv = &mesh->skinverts[i];
+			md5weight_t *weights = mesh->weights + v->firstweight;
+
+			// bind pose position using every weight
+			float xyz[3] = { 0.0f, 0.0f, 0.0f };
+			for(int j = 0; j < v->numweights; j++)
+			{
+				float temp[3];
+				JointVertexMul(temp, &bindmats[weights[j].joint], weights[j].xyz);
+
+				xyz[0] += weights[j].weight * temp[0];
+				xyz[1] += weights[j].weight * temp[1];
+				xyz[2] += weights[j].weight * temp[2];
+			}
+
+			// pick the heaviest influences
+			int chosen[MD5_MAX_VERTEX_WEIGHTS];
+			int numinfluences = v->numweights < MD5_MAX_VERTEX_WEIGHTS ? v->numweights : MD5_MAX_VERTEX_WEIGHTS;
+			float total = 0.0f;
+			float pruned[3] = { 0.0f, 0.0f, 0.0f };
+
+			for(int k = 0; k < MD5_MAX_VERTEX_WEIGHTS; k++)
+			{
+				sv->joints[k] = 0;
+				sv->weights[k] = 0.0f;
+
+				if(k >= numinfluences)
+					continue;
+
+				int best = -1;
+				for(int j = 0; j < v->numweights; j++)
+				{
+					bool used = false;
+					for(int c = 0; c < k; c++)
+					{
+						if(chosen[c] == j)
+							used = true;
+					}
+
+					if(!used && (best == -1 || weights[j].weight > weights[best].weight))
+						best = j;
+				}
+
+				chosen[k] = best;
+				sv->joints[k] = weights[best].joint;
+				sv->weights[k] = weights[best].weight;
+				total += weights[best].weight;
+
+				float temp[3];
+				JointVertexMul(temp, &bindmats[weights[best].joint], weights[best].xyz);
+				pruned[0] += weights[best].weight * temp[0];
+				pruned[1] += weights[best].weight * temp[1];
+				pruned[2] += weights[best].weight * temp[2];
+			}
+
+			if(v->numweights > MD5_MAX_VERTEX_WEIGHTS)
+			{
+				float alltotal = 0.0f;
+				for(int j = 0; j < v->numweights; j++)
+				{
+					alltotal += weights[j].weight;
+				}
+
+				// renormalize what is left so the vertex keeps its total weight
+				float scale = alltotal / total;
+				for(int k = 0; k < numinfluences; k++)
+				{
+					sv->weights[k] *= scale;
+				}
+
+				// error from the dropped weights against the full bind position
+				float delta[3];
+				delta[0] = scale * pruned[0] - xyz[0];
+				delta[1] = scale * pruned[1] - xyz[1];
+				delta[2] = scale * pruned[2] - xyz[2];
+				float error = sqrtf(Vector_Dot(delta, delta));
+
+				if(error > maxerror)
+					maxerror = error;
+				if(alltotal - total > maxdroppedweight)
+					maxdroppedweight = alltotal - total;
+
+				numpruned++;
+			}
+
+			Vector_Copy(sv->xyz, xyz);
+		}
+
+		BuildVertexAdjacency(mesh);
+		BuildBindTangentFrames(mesh);
+		BuildSkinStreams(mesh);
+
+		if(numpruned)
+		{
+			printf("pruned %i of %i vertices to %i weights, max dropped weight %f, max bind pose error %f\n",
+				numpruned, mesh->numvertices, MD5_MAX_VERTEX_WEIGHTS, maxdroppedweight, maxerror);
+		}
+	}
+}
+
+// round to nearest even, only used at load
+static unsigned short FloatToHalf(float f)
+{
+	unsigned int u = FloatToUnsignedInt(f);
+	unsigned int sign = (u >> 16) & 0x8000;
+	int exponent = (int)((u >> 23) & 0xff) - 127 + 15;
+	unsigned int mantissa = u & 0x7fffff;
+
+	if(exponent >= 31)
+	{
+		// overflow goes to infinity, nan stays nan
+		bool nan = ((u >> 23) & 0xff) == 0xff && mantissa;
+		return sign | 0x7c00 | (nan ? 0x200 : 0);
+	}
+
+	if(exponent <= 0)
+	{
+		if(exponent < -10)
+		{
+			return sign;
+		}
+
+		// denormal, shift the implicit one in
+		mantissa |= 0x800000;
+		int shift = 14 - exponent;
+		unsigned int half = mantissa >> shift;
+		unsigned int remainder = mantissa & ((1 << shift) - 1);
+		unsigned int halfway = 1 << (shift - 1);
+
+		if(remainder > halfway || (remainder == halfway && (half & 1)))
+			half++;
+
+		return sign | half;
+	}
+
+	unsigned int half = (exponent << 10) | (mantissa >> 13);
+	unsigned int remainder = mantissa & 0x1fff;
+
+	// a carry out of the mantissa bumps the exponent, which is still right
+	if(remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+		half++;
+
+	return sign | half;
+}
+
+// unit vector to GL_INT_2_10_10_10_REV, w is -1 or 1
+static unsigned int PackNormal(const float *v, int w)
+{
+	unsigned int packed = (w & 3) << 30;
+
+	for(int i = 0; i < 3; i++)
+	{
+		// written so it compiles to min and max, the signs are random enough
+		// that branches here cost more than the rest of the packing
+		float f = v[i];
+		f = f > 1.0f ? 1.0f : f;
+		f = f < -1.0f ? -1.0f : f;
+
+		// adding 1.5 * 2^23 rounds to the nearest integer and leaves it in
+		// the low mantissa bits as two's complement
+		float rounded = f * 511.0f + 12582912.0f;
+		packed |= (FloatToUnsignedInt(rounded) & 0x3ff) << (i * 10);
+	}
+
+	return packed;
+}
+
+// returns w
+static int UnpackNormal(float *v, unsigned int packed)
+{
+	for(int i = 0; i < 3; i++)
+	{
+		// sign extend the 10 bit field
+		int x = (int)(packed << (22 - i * 10)) >> 22;
+		v[i] = x < -511 ? -1.0f : x / 511.0f;
+	}
+
+	return (int)packed >> 30;
+}
+
+static void BuildIndexBuffer(drawsurf_t *surf, md5mesh_t *mesh)
+{
+	surf->numindicies = mesh->numtris * 3;
+
+	if(mesh->numvertices <= 65536)
+	{
+		unsigned short *indicies = (unsigned short*)Mem_AllocAligned(surf->numindicies * sizeof(unsigned short), 64);
+
+		for(int i = 0; i < mesh->numtris; i++)
+		{
+			indicies[0] = mesh->tris[i].indicies[0];
+			indicies[1] = mesh->tris[i].indicies[1];
+			indicies[2] = mesh->tris[i].indicies[2];
+			indicies += 3;
+		}
+
+		surf->indexbuffer = indicies - surf->numindicies;
+		surf->indextype = GL_UNSIGNED_SHORT;
+	}
+	else
+	{
+		unsigned int *indicies = (unsigned int*)Mem_AllocAligned(surf->numindicies * sizeof(unsigned int), 64);
+
+		for(int i = 0; i < mesh->numtris; i++)
+		{
+			indicies[0] = mesh->tris[i].indicies[0];
+			indicies[1] = mesh->tris[i].indicies[1];
+			indicies[2] = mesh->tris[i].indicies[2];
+			indicies += 3;
+		}
+
+		surf->indexbuffer = indicies - surf->numindicies;
+		surf->indextype = GL_UNSIGNED_INT;
+	}
+}
+
+// every mesh draws from a surface of its own
+// calls func for every joint that can move the given triangle's frame, which
+// is every weighted influence of its three corners
+typedef void (*jointvisitfunc_t)(void *data, int joint);
+
+static void VisitTriangleJoints(md5mesh_t *mesh, int tri, jointvisitfunc_t func, void *data)
+{
+	for(int j = 0; j < 3; j++)
+	{
+		md5skinvert_t *sv = &mesh->skinverts[mesh->tris[tri].indicies[j]];
+
+		for(int k = 0; k < MD5_MAX_VERTEX_WEIGHTS; k++)
+		{
+			if(sv->weights[k] != 0.0f)
+				func(data, sv->joints[k]);
+		}
+	}
+}
+
+typedef struct jointblockmap_s
+{
+	int		*blockstamp;	// last block each joint was added for
+	int		*counts;		// blocks per joint on the first pass, the next free slot of its row on the second
+	int		*blocks;
+	int		block;
+
+} jointblockmap_t;
+
+static void CountJointBlock(void *data, int joint)
+{
+	jointblockmap_t *map = (jointblockmap_t*)data;
+
+	if(map->blockstamp[joint] != map->block)
+	{
+		map->blockstamp[joint] = map->block;
+		map->counts[joint]++;
+	}
+}
+
+static void AddJointBlock(void *data, int joint)
+{
+	jointblockmap_t *map = (jointblockmap_t*)data;
+
+	if(map->blockstamp[joint] != map->block)
+	{
+		map->blockstamp[joint] = map->block;
+		map->blocks[map->counts[joint]++] = map->block;
+	}
+}
+
+// visits the joints of every triangle in a block of triangles, or for a
+// block of vertices the joints of every triangle around those vertices
+static void VisitBlockJoints(md5mesh_t *mesh, bool vertexblock, int block, jointvisitfunc_t func, void *data)
+{
+	int first = block * NORMALS_BLOCK_SIZE;
+	int last = first + NORMALS_BLOCK_SIZE;
+
+	if(!vertexblock)
+	{
+		if(last > mesh->numtris)
+			last = mesh->numtris;
+
+		for(int i = first; i < last; i++)
+		{
+			VisitTriangleJoints(mesh, i, func, data);
+		}
+		return;
+	}
+
+	if(last > mesh->numvertices)
+		last = mesh->numvertices;
+
+	for(int i = first; i < last; i++)
+	{
+		for(int j = mesh->firstvertextri[i]; j < mesh->firstvertextri[i + 1]; j++)
+		{
+			VisitTriangleJoints(mesh, mesh->vertextris[j], func, data);
+		}
+	}
+}
+
+// joint to block rows in two passes, the stamps keep a block from being
+// added twice for the same joint
+static void BuildJointBlockMap(md5mesh_t *mesh, int numjoints, bool vertexblocks, int **firstblock, int **blocks)
+{
+	int numitems = vertexblocks ? mesh->numvertices : mesh->numtris;
+	int numblocks = (numitems + NORMALS_BLOCK_SIZE - 1) / NORMALS_BLOCK_SIZE;
+
+	jointblockmap_t map;
+	map.blockstamp = (int*)Mem_Alloc(numjoints * sizeof(int));
+	map.counts = (int*)Mem_Alloc(numjoints * sizeof(int));
+
+	for(int i = 0; i < numjoints; i++)
+	{
+		map.blockstamp[i] = -1;
+		map.counts[i] = 0;
+	}
+
+	for(map.block = 0; map.block < numblocks; map.block++)
+	{
+		VisitBlockJoints(mesh, vertexblocks, map.block, CountJointBlock, &map);
+	}
+
+	*firstblock = (int*)Mem_Alloc((numjoints + 1) * sizeof(int));
+	(*firstblock)[0] = 0;
+	for(int i = 0; i < numjoints; i++)
+	{
+		(*firstblock)[i + 1] = (*firstblock)[i] + map.counts[i];
+		map.counts[i] = (*firstblock)[i];
+		map.blockstamp[i] = -1;
+	}
+
+	map.blocks = *blocks = (int*)Mem_Alloc(((*firstblock)[numjoints] + 1) * sizeof(int));
+
+	for(map.block = 0; map.block < numblocks; map.block++)
+	{
+		VisitBlockJoints(mesh, vertexblocks, map.block, AddJointBlock, &map);
+	}
+}
+
+// the parts of a surf that follow the pose. the texcoords and indices are
+// the same for every instance and stay shared
+static void AllocSurfStreams(drawsurf_t *surf, md5mesh_t *mesh, int numjoints)
+{
+	surf->numvertices = mesh->numvertices;
+	surf->xyz = (float*)Mem_AllocAligned(mesh->numvertices * 3 * sizeof(float), 64);
+	surf->normals = (unsigned int*)Mem_AllocAligned(mesh->numvertices * sizeof(unsigned int), 64);
+	surf->tangents = (unsigned int*)Mem_AllocAligned(mesh->numvertices * sizeof(unsigned int), 64);
+	surf->colors = (unsigned int*)Mem_AllocAligned(mesh->numvertices * sizeof(unsigned int), 64);
+
+	surf->faces = Mem_AllocFaceFrames(mesh->numtris);
+	surf->lastskinmats = (md5jointmat_t*)Mem_AllocAligned(numjoints * sizeof(md5jointmat_t), 64);
+	surf->framesvalid = false;
+}
+
+static void BuildDrawSurfs(md5model_t *model)
+{
+	for(md5mesh_t *mesh = model->meshes; mesh; mesh = mesh->next)
+	{
+		drawsurf_t *surf = &mesh->surf;
+
+		AllocSurfStreams(surf, mesh, model->numjoints);
+		surf->texcoords = (unsigned short*)Mem_AllocAligned(mesh->numvertices * 2 * sizeof(unsigned short), 64);
+
+		for(int i = 0; i < mesh->numvertices; i++)
+		{
+			surf->texcoords[i * 2 + 0] = FloatToHalf(mesh->vertices[i].texcoords[0]);
+			surf->texcoords[i * 2 + 1] = FloatToHalf(mesh->vertices[i].texcoords[1]);
+		}
+
+		BuildIndexBuffer(surf, mesh);
+
+		BuildJointBlockMap(mesh, model->numjoints, false, &mesh->firstjointtriblock, &mesh->jointtriblocks);
+		BuildJointBlockMap(mesh, model->numjoints, true, &mesh->firstjointvertexblock, &mesh->jointvertexblocks);
+	}
+}
+
+// ==============================================
+// loading
+//
+// every file is loaded on the job threads into a stack of its own, then the
+// anims are linked to their model in command line order
+
+typedef struct md5loadjob_s
+{
+	const char	*filename;
+	bool		ismesh;
+	memstack_t	stack;
+	memstack_t	framestack;	// an anim's parsed float frames, until they are dropped
+	memstack_t	tempstack;	// working space that is given back once loading is done
+	md5model_t	*model;		// for an anim, the model it plays on
+	md5anim_t	*anim;
+
+} md5loadjob_t;
+
+static void LoadMD5File(void *data, int index)
+{
+	md5loadjob_t *job = (md5loadjob_t*)data + index;
+	memstack_t *oldstack = Mem_SetStack(&job->stack);
+
+	if(job->ismesh)
+	{
+		md5model_t *model = Mem_AllocMD5Model();
+
+		if(!LoadMD5ModelCache(model, job->filename))
+		{
+			ReadMD5Model(model, job->filename);
+			WriteMD5ModelCache(model, job->filename);
+		}
+
+		SortJoints(model, job->filename);
+		BuildSkinVertices(model);
+		BuildDrawSurfs(model);
+
+		job->model = model;
+	}
+	else
+	{
+		md5anim_t *md5anim = Mem_AllocMD5Anim(1);
+		md5anim->name = Mem_AllocString(job->filename, strlen(job->filename));
+
+		if(!LoadMD5AnimCache(md5anim, job->filename))
+		{
+			md5anim->framestack = &job->framestack;
+
+			ReadMD5Anim(md5anim, job->filename);
+			PruneConstantComponents(md5anim);
+			if(quantizeanims)
+			{
+				QuantizeAnim(md5anim, &job->tempstack);
+			}
+			WriteMD5AnimCache(md5anim, job->filename);
+		}
+
+		job->anim = md5anim;
+	}
+
+	Mem_SetStack(oldstack);
+}
+
+static void RemapMD5Anim(void *data, int index)
+{
+	md5loadjob_t *job = (md5loadjob_t*)data + index;
+
+	if(job->ismesh)
+	{
+		return;
+	}
+
+	memstack_t *oldstack = Mem_SetStack(&job->stack);
+	RemapAnimJoints(job->model, job->anim);
+	BuildDecodePlan(job->anim);
+	FindStaticJoints(job->model, job->anim);
+	if(reducetolerance > 0.0f)
+	{
+		ReduceAnim(job->model, job->anim, &job->tempstack);
+	}
+	Mem_SetStack(oldstack);
+}
+
+// the file name with what the stack holds after it, for the memory stats
+static const char *Mem_AllocStackName(const char *filename, const char *what)
+{
+	int length = strlen(filename) + 1 + strlen(what);
+	char *name = (char*)Mem_Alloc(length + 1);
+
+	snprintf(name, length + 1, "%s %s", filename, what);
+
+	return name;
+}
+
+static void ProcessMD5Files(int argc, char **argv)
+{
+	md5loadjob_t *jobs = (md5loadjob_t*)Mem_Alloc(argc * sizeof(md5loadjob_t));
+	int numjobs = 0;
+
+	for(int i = 1; i < argc; i++)
+	{
+		bool ismesh = strstr(argv[i], ".md5mesh") != NULL;
+
+		if(!ismesh && !strstr(argv[i], ".md5anim"))
+		{
+			continue;
+		}
+
+		printf("processing file %s...\n", argv[i]);
+
+		md5loadjob_t *job = &jobs[numjobs++];
+		memset(job, 0, sizeof(*job));
+		job->filename = argv[i];
+		job->ismesh = ismesh;
+		Mem_InitStack(&job->stack, argv[i]);
+
+		if(!ismesh)
+		{
+			Mem_InitStack(&job->framestack, Mem_AllocStackName(argv[i], "frames"));
+			Mem_InitStack(&job->tempstack, Mem_AllocStackName(argv[i], "temporaries"));
+		}
+	}
+
+	Job_ParallelFor(numjobs, LoadMD5File, jobs);
+
+	// an anim plays on the last mesh before it
+	md5model_t *model = NULL;
+	for(int i = 0; i < numjobs; i++)
+	{
+		md5loadjob_t *job = &jobs[i];
+
+		if(job->ismesh)
+		{
+			model = job->model;
+			md5model = model;
+			continue;
+		}
+
+		if(!model)
+		{
+			Error("anim \"%s\" has no mesh to play on\n", job->filename);
+		}
+
+		job->model = model;
+
+		// link the new animation into the list
+		job->anim->next = model->anims;
+		model->anims = job->anim;
+	}
+
+	Job_ParallelFor(numjobs, RemapMD5Anim, jobs);
+
+	for(int i = 0; i < numjobs; i++)
+	{
+		Mem_FreeStack(&jobs[i].tempstack);
+	}
+}
+
+static void DrawVector(float *origin, float *dir)
+{
+	float s = 2.0f;
+
+	glBegin(GL_LINES);
+	{
+		glVertex3f(origin[0], origin[1], origin[2]);
+		glVertex3f(s * dir[0] + origin[0], s * dir[1] + origin[1], s * dir[2] + origin[2]);
+	}
+	glEnd();
+}
+
+static void DrawMatrix(md5jointmat_t *matrix)
+{
+	float vectors[4][3] =
+	{
+		{ matrix->m[0][0], matrix->m[1][0], matrix->m[2][0] },
+		{ matrix->m[0][1], matrix->m[1][1], matrix->m[2][1] },
+		{ matrix->m[0][2], matrix->m[1][2], matrix->m[2][2] },
+		{ matrix->m[0][3], matrix->m[1][3], matrix->m[2][3] },
+	};
+
+	glColor3f(1, 0, 0);
+	DrawVector(vectors[3], vectors[0]);
+	glColor3f(0, 1, 0);
+	DrawVector(vectors[3], vectors[1]);
+	glColor3f(0, 0, 1);
+	DrawVector(vectors[3], vectors[2]);
+}
+
+static void RenderHierarchy(int *parents, md5jointmat_t *palette, int numjoints)
+{
+	glDisable(GL_DEPTH_TEST);
+
+	// draw the vectors
+	{
+		for(int i = 0; i < numjoints; i++)
+		{
+			DrawMatrix(&palette[i]);
+		}
+	}
+
+	// draw the skeleton
+	{
+		glBegin(GL_LINES);
+		for(int i = 0; i < numjoints; i++)
+		{
+			if(parents[i] == -1)
+				continue;
+
+			md5jointmat_t *jointmat = &palette[i];
+			md5jointmat_t *parentmat = &palette[parents[i]];
+
+			glColor3f(1, 1, 1);
+			glVertex3f(jointmat->m[0][3], jointmat->m[1][3], jointmat->m[2][3]);
+			glVertex3f(parentmat->m[0][3], parentmat->m[1][3], parentmat->m[2][3]);
+		}
+		glEnd();
+	}
+
+	glEnable(GL_DEPTH_TEST);
+}
+
+static void ComputeVertexColors(unsigned int *colors, drawsurf_t *surf)
+{
+	for(int i = 0; i < surf->numvertices; i++)
+	{
+		unsigned int normal = surf->normals[i];
+
+		// flipping the sign bit of a 10 bit field maps -512..511 to 0..1023,
+		// the top 8 bits of that are 0.5 + 0.5 * n as a byte
+		unsigned int r = ((normal ^ 0x200) >> 2) & 0xff;
+		unsigned int g = ((normal ^ 0x80000) >> 12) & 0xff;
+		unsigned int b = ((normal ^ 0x20000000) >> 22) & 0xff;
+
+		// bytes in memory order r, g, b, a
+		colors[i] = r | (g << 8) | (b << 16) | (0xffu << 24);
+	}
+}
+
+static void DrawNormals(drawsurf_t *surf)
+{
+	glBegin(GL_LINES);
+	{
+		for(int i = 0; i < surf->numvertices; i++)
+		{
+			float *xyz = surf->xyz + i * 3;
+			float normal[3], tangent[3], bitangent[3];
+
+			UnpackNormal(normal, surf->normals[i]);
+			int sign = UnpackNormal(tangent, surf->tangents[i]);
+
+			Vector_Cross(bitangent, normal, tangent);
+			bitangent[0] *= sign;
+			bitangent[1] *= sign;
+			bitangent[2] *= sign;
+			
+			glColor3f(1, 0, 0);
+			DrawVector(xyz, tangent);
+
+			glColor3f(0, 1, 0);
+			DrawVector(xyz, bitangent);
+
+			glColor3f(0, 0, 1);
+			DrawVector(xyz, normal);
+		}
+	}
+	glEnd();
+}
+
+
+// normals and tangents are optional, when given the bind pose tangent frame
+// goes through the rotation part of the same blended matrix as the position
+static void SkinVertices_Generic(float *xyz, unsigned int *normals, unsigned int *tangents, md5mesh_t *mesh, md5jointmat_t *skinmats)
+{
+	for(int i = 0; i < mesh->numvertices; i++)
+	{
+		md5skinvert_t *sv = &mesh->skinverts[i];
+
+		// blend the skinning matrices of the influences together and take
+		// the bind pose vertex through the result
+		md5jointmat_t blendedmat;
+		float *dst = &blendedmat.m[0][0];
+		float *m0 = &skinmats[sv->joints[0]].m[0][0];
+		float *m1 = &skinmats[sv->joints[1]].m[0][0];
+		float *m2 = &skinmats[sv->joints[2]].m[0][0];
+		float *m3 = &skinmats[sv->joints[3]].m[0][0];
+
+		for(int j = 0; j < 12; j++)
+		{
+			dst[j] = sv->weights[0] * m0[j] + sv->weights[1] * m1[j] + sv->weights[2] * m2[j] + sv->weights[3] * m3[j];
+		}
+
+		JointVertexMul(xyz + i * 3, &blendedmat, sv->xyz);
+
+		if(normals)
+		{
+			float normal[3], tangent[3];
+			for(int j = 0; j < 3; j++)
+			{
+				float *m = blendedmat.m[j];
+				normal[j] = m[0] * sv->normal[0] + m[1] * sv->normal[1] + m[2] * sv->normal[2];
+				tangent[j] = m[0] * sv->tangent[0] + m[1] * sv->tangent[1] + m[2] * sv->tangent[2];
+			}
+
+			// blending rotations shortens the vectors
+			Vector_Normalize(normal);
+			Vector_Normalize(tangent);
+
+			normals[i] = PackNormal(normal, 0);
+			tangents[i] = PackNormal(tangent, sv->tangentsign);
+		}
+	}
+}
+
+#ifdef USE_SIMD
+// PackNormal for four vectors held a component per register. the operand
+// order of the min and max lets nan through the same way the scalar code does
+static __m128i PackNormals_SSE2(__m128 x, __m128 y, __m128 z, __m128i w)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 minusone = _mm_set1_ps(-1.0f);
+	const __m128 scale = _mm_set1_ps(511.0f);
+	const __m128 magic = _mm_set1_ps(12582912.0f);
+	const __m128i mask = _mm_set1_epi32(0x3ff);
+
+	x = _mm_max_ps(minusone, _mm_min_ps(one, x));
+	y = _mm_max_ps(minusone, _mm_min_ps(one, y));
+	z = _mm_max_ps(minusone, _mm_min_ps(one, z));
+
+	__m128i ix = _mm_and_si128(_mm_castps_si128(_mm_add_ps(_mm_mul_ps(x, scale), magic)), mask);
+	__m128i iy = _mm_and_si128(_mm_castps_si128(_mm_add_ps(_mm_mul_ps(y, scale), magic)), mask);
+	__m128i iz = _mm_and_si128(_mm_castps_si128(_mm_add_ps(_mm_mul_ps(z, scale), magic)), mask);
+
+	return _mm_or_si128(_mm_or_si128(w, ix), _mm_or_si128(_mm_slli_epi32(iy, 10), _mm_slli_epi32(iz, 20)));
+}
+
+// rotates four vectors by the transposed rows and packs them normalized
+static __m128i RotateAndPack_SSE2(__m128 c[3][3], __m128 x, __m128 y, __m128 z, __m128i w)
+{
+	__m128 v[3];
+	for(int r = 0; r < 3; r++)
+	{
+		v[r] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c[r][0], x), _mm_mul_ps(c[r][1], y)), _mm_mul_ps(c[r][2], z));
+	}
+
+	__m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(v[0], v[0]), _mm_mul_ps(v[1], v[1])), _mm_mul_ps(v[2], v[2])));
+	__m128 invlen = _mm_div_ps(_mm_set1_ps(1.0f), len);
+
+	return PackNormals_SSE2(_mm_mul_ps(v[0], invlen), _mm_mul_ps(v[1], invlen), _mm_mul_ps(v[2], invlen), w);
+}
+
+// four vertices at a time. each vertex's blended matrix is built a row at a
+// time, then the rows of the four matrices are transposed so the transform
+// runs across the vertices
+static void SkinVertices_SSE2(float *xyz, unsigned int *normals, unsigned int *tangents, md5mesh_t *mesh, md5jointmat_t *skinmats)
+{
+	md5skinstreams_t *streams = &mesh->skinstreams;
+
+	for(int i = 0; i < streams->numvertices; i += 4)
+	{
+		__m128 rows[3][4];
+
+		for(int lane = 0; lane < 4; lane++)
+		{
+			__m128 r0 = _mm_setzero_ps();
+			__m128 r1 = _mm_setzero_ps();
+			__m128 r2 = _mm_setzero_ps();
+
+			for(int k = 0; k < MD5_MAX_VERTEX_WEIGHTS; k++)
+			{
+				md5jointmat_t *m = &skinmats[streams->joints[k][i + lane]];
+				__m128 w = _mm_set1_ps(streams->weights[k][i + lane]);
+
+				r0 = _mm_add_ps(r0, _mm_mul_ps(w, _mm_loadu_ps(m->m[0])));
+				r1 = _mm_add_ps(r1, _mm_mul_ps(w, _mm_loadu_ps(m->m[1])));
+				r2 = _mm_add_ps(r2, _mm_mul_ps(w, _mm_loadu_ps(m->m[2])));
+			}
+
+			rows[0][lane] = r0;
+			rows[1][lane] = r1;
+			rows[2][lane] = r2;
+		}
+
+		__m128 x = _mm_load_ps(streams->xyz[0] + i);
+		__m128 y = _mm_load_ps(streams->xyz[1] + i);
+		__m128 z = _mm_load_ps(streams->xyz[2] + i);
+
+		float out[3][4];
+		__m128 rotation[3][3];
+		for(int r = 0; r < 3; r++)
+		{
+			__m128 c0 = rows[r][0];
+			__m128 c1 = rows[r][1];
+			__m128 c2 = rows[r][2];
+			__m128 c3 = rows[r][3];
+			_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+			__m128 result = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, x), _mm_mul_ps(c1, y)), _mm_add_ps(_mm_mul_ps(c2, z), c3));
+			_mm_storeu_ps(out[r], result);
+
+			rotation[r][0] = c0;
+			rotation[r][1] = c1;
+			rotation[r][2] = c2;
+		}
+
+		int numlanes = mesh->numvertices - i < 4 ? mesh->numvertices - i : 4;
+		for(int lane = 0; lane < numlanes; lane++)
+		{
+			xyz[(i + lane) * 3 + 0] = out[0][lane];
+			xyz[(i + lane) * 3 + 1] = out[1][lane];
+			xyz[(i + lane) * 3 + 2] = out[2][lane];
+		}
+
+		if(normals)
+		{
+			unsigned int packed[2][4];
+
+			_mm_storeu_si128((__m128i*)packed[0], RotateAndPack_SSE2(rotation,
+				_mm_load_ps(streams->normal[0] + i), _mm_load_ps(streams->normal[1] + i), _mm_load_ps(streams->normal[2] + i),
+				_mm_setzero_si128()));
+			_mm_storeu_si128((__m128i*)packed[1], RotateAndPack_SSE2(rotation,
+				_mm_load_ps(streams->tangent[0] + i), _mm_load_ps(streams->tangent[1] + i), _mm_load_ps(streams->tangent[2] + i),
+				_mm_load_si128((__m128i*)(streams->tangentw + i))));
+
+			for(int lane = 0; lane < numlanes; lane++)
+			{
+				normals[i + lane] = packed[0][lane];
+				tangents[i + lane] = packed[1][lane];
+			}
+		}
+	}
+}
+
+__attribute__((target("avx2,fma")))
+static __m256i PackNormals_AVX2(__m256 x, __m256 y, __m256 z, __m256i w)
+{
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 minusone = _mm256_set1_ps(-1.0f);
+	const __m256 scale = _mm256_set1_ps(511.0f);
+	const __m256 magic = _mm256_set1_ps(12582912.0f);
+	const __m256i mask = _mm256_set1_epi32(0x3ff);
+
+	x = _mm256_max_ps(minusone, _mm256_min_ps(one, x));
+	y = _mm256_max_ps(minusone, _mm256_min_ps(one, y));
+	z = _mm256_max_ps(minusone, _mm256_min_ps(one, z));
+
+	__m256i ix = _mm256_and_si256(_mm256_castps_si256(_mm256_fmadd_ps(x, scale, magic)), mask);
+	__m256i iy = _mm256_and_si256(_mm256_castps_si256(_mm256_fmadd_ps(y, scale, magic)), mask);
+	__m256i iz = _mm256_and_si256(_mm256_castps_si256(_mm256_fmadd_ps(z, scale, magic)), mask);
+
+	return _mm256_or_si256(_mm256_or_si256(w, ix), _mm256_or_si256(_mm256_slli_epi32(iy, 10), _mm256_slli_epi32(iz, 20)));
+}
+
+__attribute__((target("avx2,fma")))
+static __m256i RotateAndPack_AVX2(__m256 c[3][3], __m256 x, __m256 y, __m256 z, __m256i w)
+{
+	__m256 v[3];
+	for(int r = 0; r < 3; r++)
+	{
+		v[r] = _mm256_fmadd_ps(c[r][0], x, _mm256_fmadd_ps(c[r][1], y, _mm256_mul_ps(c[r][2], z)));
+	}
+
+	__m256 len = _mm256_sqrt_ps(_mm256_fmadd_ps(v[0], v[0], _mm256_fmadd_ps(v[1], v[1], _mm256_mul_ps(v[2], v[2]))));
+	__m256 invlen = _mm256_div_ps(_mm256_set1_ps(1.0f), len);
+
+	return PackNormals_AVX2(_mm256_mul_ps(v[0], invlen), _mm256_mul_ps(v[1], invlen), _mm256_mul_ps(v[2], invlen), w);
+}
+
+// eight vertices at a time. same idea as the sse2 version, but the first two
+// rows of each matrix are blended together in one register and the transform
+// runs across all eight vertices
+__attribute__((target("avx2,fma")))
+static void SkinVertices_AVX2(float *xyz, unsigned int *normals, unsigned int *tangents, md5mesh_t *mesh, md5jointmat_t *skinmats)
+{
+	md5skinstreams_t *streams = &mesh->skinstreams;
+
+	for(int i = 0; i < streams->numvertices; i += 8)
+	{
+		__m128 rows[3][8];
+
+		for(int lane = 0; lane < 8; lane++)
+		{
+			__m256 r01 = _mm256_setzero_ps();
+			__m128 r2 = _mm_setzero_ps();
+
+			for(int k = 0; k < MD5_MAX_VERTEX_WEIGHTS; k++)
+			{
+				md5jointmat_t *m = &skinmats[streams->joints[k][i + lane]];
+				float w = streams->weights[k][i + lane];
+
+				r01 = _mm256_fmadd_ps(_mm256_set1_ps(w), _mm256_loadu_ps(m->m[0]), r01);
+				r2 = _mm_fmadd_ps(_mm_set1_ps(w), _mm_loadu_ps(m->m[2]), r2);
+			}
+
+			rows[0][lane] = _mm256_castps256_ps128(r01);
+			rows[1][lane] = _mm256_extractf128_ps(r01, 1);
+			rows[2][lane] = r2;
+		}
+
+		__m256 x = _mm256_load_ps(streams->xyz[0] + i);
+		__m256 y = _mm256_load_ps(streams->xyz[1] + i);
+		__m256 z = _mm256_load_ps(streams->xyz[2] + i);
+
+		float out[3][8];
+		__m256 rotation[3][3];
+		for(int r = 0; r < 3; r++)
+		{
+			__m128 a0 = rows[r][0], a1 = rows[r][1], a2 = rows[r][2], a3 = rows[r][3];
+			__m128 b0 = rows[r][4], b1 = rows[r][5], b2 = rows[r][6], b3 = rows[r][7];
+			_MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+			_MM_TRANSPOSE4_PS(b0, b1, b2, b3);
+
+			__m256 c0 = _mm256_insertf128_ps(_mm256_castps128_ps256(a0), b0, 1);
+			__m256 c1 = _mm256_insertf128_ps(_mm256_castps128_ps256(a1), b1, 1);
+			__m256 c2 = _mm256_insertf128_ps(_mm256_castps128_ps256(a2), b2, 1);
+			__m256 c3 = _mm256_insertf128_ps(_mm256_castps128_ps256(a3), b3, 1);
+
+			__m256 result = _mm256_fmadd_ps(c0, x, _mm256_fmadd_ps(c1, y, _mm256_fmadd_ps(c2, z, c3)));
+			_mm256_storeu_ps(out[r], result);
+
+			rotation[r][0] = c0;
+			rotation[r][1] = c1;
+			rotation[r][2] = c2;
+		}
+
+		int numlanes = mesh->numvertices - i < 8 ? mesh->numvertices - i : 8;
+		for(int lane = 0; lane < numlanes; lane++)
+		{
+			xyz[(i + lane) * 3 + 0] = out[0][lane];
+			xyz[(i + lane) * 3 + 1] = out[1][lane];
+			xyz[(i + lane) * 3 + 2] = out[2][lane];
+		}
+
+		if(normals)
+		{
+			unsigned int packed[2][8];
+
+			_mm256_storeu_si256((__m256i*)packed[0], RotateAndPack_AVX2(rotation,
+				_mm256_load_ps(streams->normal[0] + i), _mm256_load_ps(streams->normal[1] + i), _mm256_load_ps(streams->normal[2] + i),
+				_mm256_setzero_si256()));
+			_mm256_storeu_si256((__m256i*)packed[1], RotateAndPack_AVX2(rotation,
+				_mm256_load_ps(streams->tangent[0] + i), _mm256_load_ps(streams->tangent[1] + i), _mm256_load_ps(streams->tangent[2] + i),
+				_mm256_load_si256((__m256i*)(streams->tangentw + i))));
+
+			for(int lane = 0; lane < numlanes; lane++)
+			{
+				normals[i + lane] = packed[0][lane];
+				tangents[i + lane] = packed[1][lane];
+			}
+		}
+	}
+}
+#endif
+
+typedef void (*skinfunc_t)(float *xyz, unsigned int *normals, unsigned int *tangents, md5mesh_t *mesh, md5jointmat_t *skinmats);
+
+static skinfunc_t SkinVertices = SkinVertices_Generic;
+static const char *skinkernelname = "generic";
+static const char *palettekernelname = "generic";
+static const char *decodekernelname = "generic";
+
+// the vertices in [first, last) gather their triangles' frames
+static void GatherVertexFrames_Generic(drawsurf_t *surf, md5mesh_t *mesh, const float *faces, int first, int last)
+{
+	for(int i = first; i < last; i++)
+	{
+		tangentframe_t frame;
+		GatherTangentFrame(&frame, faces, mesh, i);
+
+		int sign = NormalizeTangentFrame(&frame);
+
+		surf->normals[i] = PackNormal(frame.normal, 0);
+		surf->tangents[i] = PackNormal(frame.tangent[0], sign);
+	}
+}
+
+#ifdef USE_SIMD
+// four triangles at a time, the corners are loaded a component per register
+// and the frames transposed back to one triangle per vector to be stored
+static void ComputeFaceFrames_SSE2(float *faces, const float *xyz, md5mesh_t *mesh, int first, int last)
+{
+	const __m128 signmask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	int i;
+	for(i = first; i + 4 <= last; i += 4)
+	{
+		md5tri_t *tris = mesh->tris + i;
+		__m128 p[3][3], st[3][2];
+
+		for(int k = 0; k < 3; k++)
+		{
+			int v0 = tris[0].indicies[k];
+			int v1 = tris[1].indicies[k];
+			int v2 = tris[2].indicies[k];
+			int v3 = tris[3].indicies[k];
+
+			for(int c = 0; c < 3; c++)
+			{
+				p[k][c] = _mm_setr_ps(xyz[v0 * 3 + c], xyz[v1 * 3 + c], xyz[v2 * 3 + c], xyz[v3 * 3 + c]);
+			}
+			for(int c = 0; c < 2; c++)
+			{
+				st[k][c] = _mm_setr_ps(mesh->vertices[v0].texcoords[c], mesh->vertices[v1].texcoords[c],
+					mesh->vertices[v2].texcoords[c], mesh->vertices[v3].texcoords[c]);
+			}
+		}
+
+		__m128 d0[5], d1[5];
+		for(int c = 0; c < 3; c++)
+		{
+			d0[c] = _mm_sub_ps(p[1][c], p[0][c]);
+			d1[c] = _mm_sub_ps(p[2][c], p[0][c]);
+		}
+		for(int c = 0; c < 2; c++)
+		{
+			d0[3 + c] = _mm_sub_ps(st[1][c], st[0][c]);
+			d1[3 + c] = _mm_sub_ps(st[2][c], st[0][c]);
+		}
+
+		__m128 v[3][4];
+
+		v[0][0] = _mm_sub_ps(_mm_mul_ps(d1[1], d0[2]), _mm_mul_ps(d1[2], d0[1]));
+		v[0][1] = _mm_sub_ps(_mm_mul_ps(d1[2], d0[0]), _mm_mul_ps(d1[0], d0[2]));
+		v[0][2] = _mm_sub_ps(_mm_mul_ps(d1[0], d0[1]), _mm_mul_ps(d1[1], d0[0]));
+
+		__m128 area = _mm_sub_ps(_mm_mul_ps(d0[3], d1[4]), _mm_mul_ps(d0[4], d1[3]));
+		__m128 signbit = _mm_and_ps(area, signmask);
+
+		for(int c = 0; c < 3; c++)
+		{
+			v[1][c] = _mm_sub_ps(_mm_mul_ps(d0[c], d1[4]), _mm_mul_ps(d0[4], d1[c]));
+			v[2][c] = _mm_sub_ps(_mm_mul_ps(d0[3], d1[c]), _mm_mul_ps(d0[c], d1[3]));
+		}
+
+		for(int j = 0; j < 3; j++)
+		{
+			__m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(v[j][0], v[j][0]), _mm_mul_ps(v[j][1], v[j][1])), _mm_mul_ps(v[j][2], v[j][2])));
+			__m128 f = _mm_div_ps(one, len);
+
+			// the tangents point the way the texture does
+			if(j)
+				f = _mm_xor_ps(f, signbit);
+
+			v[j][0] = _mm_mul_ps(v[j][0], f);
+			v[j][1] = _mm_mul_ps(v[j][1], f);
+			v[j][2] = _mm_mul_ps(v[j][2], f);
+			v[j][3] = _mm_setzero_ps();
+
+			_MM_TRANSPOSE4_PS(v[j][0], v[j][1], v[j][2], v[j][3]);
+		}
+
+		for(int lane = 0; lane < 4; lane++)
+		{
+			float *face = faces + (i + lane) * FACEFRAME_FLOATS;
+
+			_mm_store_ps(face + 0, v[0][lane]);
+			_mm_store_ps(face + 4, v[1][lane]);
+			_mm_store_ps(face + 8, v[2][lane]);
+		}
+	}
+
+	ComputeFaceFrames_Generic(faces, xyz, mesh, i, last);
+}
+
+// normalizes four tangent frames held a component per register and packs them
+static void PackTangentFrames_SSE2(unsigned int *normals, unsigned int *tangents, __m128 v[3][3])
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	for(int j = 0; j < 3; j++)
+	{
+		__m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(v[j][0], v[j][0]), _mm_mul_ps(v[j][1], v[j][1])), _mm_mul_ps(v[j][2], v[j][2])));
+		__m128 f = _mm_div_ps(one, len);
+
+		v[j][0] = _mm_mul_ps(v[j][0], f);
+		v[j][1] = _mm_mul_ps(v[j][1], f);
+		v[j][2] = _mm_mul_ps(v[j][2], f);
+	}
+
+	// the bitangent is rebuilt from the other two, only its side is kept
+	__m128 cross[3];
+	cross[0] = _mm_sub_ps(_mm_mul_ps(v[0][1], v[1][2]), _mm_mul_ps(v[0][2], v[1][1]));
+	cross[1] = _mm_sub_ps(_mm_mul_ps(v[0][2], v[1][0]), _mm_mul_ps(v[0][0], v[1][2]));
+	cross[2] = _mm_sub_ps(_mm_mul_ps(v[0][0], v[1][1]), _mm_mul_ps(v[0][1], v[1][0]));
+
+	__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cross[0], v[2][0]), _mm_mul_ps(cross[1], v[2][1])), _mm_mul_ps(cross[2], v[2][2]));
+	__m128i flipped = _mm_castps_si128(_mm_cmplt_ps(dot, _mm_setzero_ps()));
+	__m128i w = _mm_or_si128(_mm_set1_epi32(1 << 30), _mm_and_si128(flipped, _mm_set1_epi32(0x80000000)));
+
+	_mm_storeu_si128((__m128i*)normals, PackNormals_SSE2(v[0][0], v[0][1], v[0][2], _mm_setzero_si128()));
+	_mm_storeu_si128((__m128i*)tangents, PackNormals_SSE2(v[1][0], v[1][1], v[1][2], w));
+}
+
+// four vertices at a time. each one sums its triangles a whole vector at a
+// time, then the sums are transposed to be normalized and packed together
+static void GatherVertexFrames_SSE2(drawsurf_t *surf, md5mesh_t *mesh, const float *faces, int first, int last)
+{
+	int i;
+	for(i = first; i + 4 <= last; i += 4)
+	{
+		__m128 v[3][4];
+
+		for(int lane = 0; lane < 4; lane++)
+		{
+			__m128 normal = _mm_setzero_ps();
+			__m128 tangent = _mm_setzero_ps();
+			__m128 bitangent = _mm_setzero_ps();
+
+			for(int j = mesh->firstvertextri[i + lane]; j < mesh->firstvertextri[i + lane + 1]; j++)
+			{
+				const float *face = faces + mesh->vertextris[j] * FACEFRAME_FLOATS;
+
+				normal = _mm_add_ps(normal, _mm_load_ps(face + 0));
+				tangent = _mm_add_ps(tangent, _mm_load_ps(face + 4));
+				bitangent = _mm_add_ps(bitangent, _mm_load_ps(face + 8));
+			}
+
+			v[0][lane] = normal;
+			v[1][lane] = tangent;
+			v[2][lane] = bitangent;
+		}
+
+		__m128 frames[3][3];
+		for(int j = 0; j < 3; j++)
+		{
+			_MM_TRANSPOSE4_PS(v[j][0], v[j][1], v[j][2], v[j][3]);
+
+			frames[j][0] = v[j][0];
+			frames[j][1] = v[j][1];
+			frames[j][2] = v[j][2];
+		}
+
+		PackTangentFrames_SSE2(surf->normals + i, surf->tangents + i, frames);
+	}
+
+	GatherVertexFrames_Generic(surf, mesh, faces, i, last);
+}
+
+// eight triangles at a time, the corners come in with gathers
+__attribute__((target("avx2,fma")))
+static void ComputeFaceFrames_AVX2(float *faces, const float *xyz, md5mesh_t *mesh, int first, int last)
+{
+	const __m256 signmask = _mm256_castsi256_ps(_mm256_set1_epi32(0x80000000));
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const int *indicies = mesh->tris[0].indicies;
+	const float *texcoords = mesh->vertices[0].texcoords;
+	const __m256i vertexstride = _mm256_set1_epi32(sizeof(md5vertex_t) / sizeof(float));
+	const __m256i lanes = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+
+	int i;
+	for(i = first; i + 8 <= last; i += 8)
+	{
+		__m256 p[3][3], st[3][2];
+
+		for(int k = 0; k < 3; k++)
+		{
+			__m256i vertex = _mm256_i32gather_epi32(indicies, _mm256_add_epi32(lanes, _mm256_set1_epi32(i * 3 + k)), 4);
+			__m256i xyzindex = _mm256_mullo_epi32(vertex, _mm256_set1_epi32(3));
+			__m256i stindex = _mm256_mullo_epi32(vertex, vertexstride);
+
+			for(int c = 0; c < 3; c++)
+			{
+				p[k][c] = _mm256_i32gather_ps(xyz, _mm256_add_epi32(xyzindex, _mm256_set1_epi32(c)), 4);
+			}
+			for(int c = 0; c < 2; c++)
+			{
+				st[k][c] = _mm256_i32gather_ps(texcoords, _mm256_add_epi32(stindex, _mm256_set1_epi32(c)), 4);
+			}
+		}
+
+		__m256 d0[5], d1[5];
+		for(int c = 0; c < 3; c++)
+		{
+			d0[c] = _mm256_sub_ps(p[1][c], p[0][c]);
+			d1[c] = _mm256_sub_ps(p[2][c], p[0][c]);
+		}
+		for(int c = 0; c < 2; c++)
+		{
+			d0[3 + c] = _mm256_sub_ps(st[1][c], st[0][c]);
+			d1[3 + c] = _mm256_sub_ps(st[2][c], st[0][c]);
+		}
+
+		__m256 v[3][3];
+
+		v[0][0] = _mm256_sub_ps(_mm256_mul_ps(d1[1], d0[2]), _mm256_mul_ps(d1[2], d0[1]));
+		v[0][1] = _mm256_sub_ps(_mm256_mul_ps(d1[2], d0[0]), _mm256_mul_ps(d1[0], d0[2]));
+		v[0][2] = _mm256_sub_ps(_mm256_mul_ps(d1[0], d0[1]), _mm256_mul_ps(d1[1], d0[0]));
+
+		__m256 area = _mm256_sub_ps(_mm256_mul_ps(d0[3], d1[4]), _mm256_mul_ps(d0[4], d1[3]));
+		__m256 signbit = _mm256_and_ps(area, signmask);
+
+		for(int c = 0; c < 3; c++)
+		{
+			v[1][c] = _mm256_sub_ps(_mm256_mul_ps(d0[c], d1[4]), _mm256_mul_ps(d0[4], d1[c]));
+			v[2][c] = _mm256_sub_ps(_mm256_mul_ps(d0[3], d1[c]), _mm256_mul_ps(d0[c], d1[3]));
+		}
+
+		for(int j = 0; j < 3; j++)
+		{
+			__m256 len = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(v[j][0], v[j][0]), _mm256_mul_ps(v[j][1], v[j][1])), _mm256_mul_ps(v[j][2], v[j][2])));
+			__m256 f = _mm256_div_ps(one, len);
+
+			if(j)
+				f = _mm256_xor_ps(f, signbit);
+
+			__m256 x = _mm256_mul_ps(v[j][0], f);
+			__m256 y = _mm256_mul_ps(v[j][1], f);
+			__m256 z = _mm256_mul_ps(v[j][2], f);
+
+			// back to one triangle per vector, a half at a time
+			for(int half = 0; half < 2; half++)
+			{
+				__m128 r0 = half ? _mm256_extractf128_ps(x, 1) : _mm256_castps256_ps128(x);
+				__m128 r1 = half ? _mm256_extractf128_ps(y, 1) : _mm256_castps256_ps128(y);
+				__m128 r2 = half ? _mm256_extractf128_ps(z, 1) : _mm256_castps256_ps128(z);
+				__m128 r3 = _mm_setzero_ps();
+				_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+				float *face = faces + (i + half * 4) * FACEFRAME_FLOATS + j * 4;
+				_mm_store_ps(face + 0 * FACEFRAME_FLOATS, r0);
+				_mm_store_ps(face + 1 * FACEFRAME_FLOATS, r1);
+				_mm_store_ps(face + 2 * FACEFRAME_FLOATS, r2);
+				_mm_store_ps(face + 3 * FACEFRAME_FLOATS, r3);
+			}
+		}
+	}
+
+	ComputeFaceFrames_Generic(faces, xyz, mesh, i, last);
+}
+
+__attribute__((target("avx2,fma")))
+static void PackTangentFrames_AVX2(unsigned int *normals, unsigned int *tangents, __m256 v[3][3])
+{
+	const __m256 one = _mm256_set1_ps(1.0f);
+
+	for(int j = 0; j < 3; j++)
+	{
+		__m256 len = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(v[j][0], v[j][0]), _mm256_mul_ps(v[j][1], v[j][1])), _mm256_mul_ps(v[j][2], v[j][2])));
+		__m256 f = _mm256_div_ps(one, len);
+
+		v[j][0] = _mm256_mul_ps(v[j][0], f);
+		v[j][1] = _mm256_mul_ps(v[j][1], f);
+		v[j][2] = _mm256_mul_ps(v[j][2], f);
+	}
+
+	__m256 cross[3];
+	cross[0] = _mm256_sub_ps(_mm256_mul_ps(v[0][1], v[1][2]), _mm256_mul_ps(v[0][2], v[1][1]));
+	cross[1] = _mm256_sub_ps(_mm256_mul_ps(v[0][2], v[1][0]), _mm256_mul_ps(v[0][0], v[1][2]));
+	cross[2] = _mm256_sub_ps(_mm256_mul_ps(v[0][0], v[1][1]), _mm256_mul_ps(v[0][1], v[1][0]));
+
+	__m256 dot = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cross[0], v[2][0]), _mm256_mul_ps(cross[1], v[2][1])), _mm256_mul_ps(cross[2], v[2][2]));
+	__m256i flipped = _mm256_castps_si256(_mm256_cmp_ps(dot, _mm256_setzero_ps(), _CMP_LT_OQ));
+	__m256i w = _mm256_or_si256(_mm256_set1_epi32(1 << 30), _mm256_and_si256(flipped, _mm256_set1_epi32(0x80000000)));
+
+	_mm256_storeu_si256((__m256i*)normals, PackNormals_AVX2(v[0][0], v[0][1], v[0][2], _mm256_setzero_si256()));
+	_mm256_storeu_si256((__m256i*)tangents, PackNormals_AVX2(v[1][0], v[1][1], v[1][2], w));
+}
+
+// eight vertices at a time, the normal and tangent sums share a register
+__attribute__((target("avx2,fma")))
+static void GatherVertexFrames_AVX2(drawsurf_t *surf, md5mesh_t *mesh, const float *faces, int first, int last)
+{
+	int i;
+	for(i = first; i + 8 <= last; i += 8)
+	{
+		__m128 v[3][8];
+
+		for(int lane = 0; lane < 8; lane++)
+		{
+			__m256 normaltangent = _mm256_setzero_ps();
+			__m128 bitangent = _mm_setzero_ps();
+
+			for(int j = mesh->firstvertextri[i + lane]; j < mesh->firstvertextri[i + lane + 1]; j++)
+			{
+				const float *face = faces + mesh->vertextris[j] * FACEFRAME_FLOATS;
+
+				normaltangent = _mm256_add_ps(normaltangent, _mm256_loadu_ps(face + 0));
+				bitangent = _mm_add_ps(bitangent, _mm_load_ps(face + 8));
+			}
+
+			v[0][lane] = _mm256_castps256_ps128(normaltangent);
+			v[1][lane] = _mm256_extractf128_ps(normaltangent, 1);
+			v[2][lane] = bitangent;
+		}
+
+		__m256 frames[3][3];
+		for(int j = 0; j < 3; j++)
+		{
+			__m128 a0 = v[j][0], a1 = v[j][1], a2 = v[j][2], a3 = v[j][3];
+			__m128 b0 = v[j][4], b1 = v[j][5], b2 = v[j][6], b3 = v[j][7];
+			_MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+			_MM_TRANSPOSE4_PS(b0, b1, b2, b3);
+
+			frames[j][0] = _mm256_insertf128_ps(_mm256_castps128_ps256(a0), b0, 1);
+			frames[j][1] = _mm256_insertf128_ps(_mm256_castps128_ps256(a1), b1, 1);
+			frames[j][2] = _mm256_insertf128_ps(_mm256_castps128_ps256(a2), b2, 1);
+		}
+
+		PackTangentFrames_AVX2(surf->normals + i, surf->tangents + i, frames);
+	}
+
+	GatherVertexFrames_Generic(surf, mesh, faces, i, last);
+}
+#endif
+
+typedef void (*facefunc_t)(float *faces, const float *xyz, md5mesh_t *mesh, int first, int last);
+typedef void (*gatherfunc_t)(drawsurf_t *surf, md5mesh_t *mesh, const float *faces, int first, int last);
+
+static facefunc_t ComputeFaceFrames = ComputeFaceFrames_Generic;
+static gatherfunc_t GatherVertexFrames = GatherVertexFrames_Generic;
+
+#define NORMALS_BLOCKS_PER_JOB	16
+
+// the blocks of one pass, every block when blocks is NULL
+typedef struct normalsjob_s
+{
+	drawsurf_t	*surf;
+	md5mesh_t	*mesh;
+	int			*blocks;
+	int			numblocks;
+
+} normalsjob_t;
+
+static void NormalsJobRange(normalsjob_t *job, int index, int numitems, int *first, int *last)
+{
+	int block = job->blocks ? job->blocks[index] : index;
+
+	*first = block * NORMALS_BLOCK_SIZE;
+	*last = *first + NORMALS_BLOCK_SIZE;
+	if(*last > numitems)
+		*last = numitems;
+}
+
+static void FaceFramesJob(void *data, int index)
+{
+	normalsjob_t *job = (normalsjob_t*)data;
+
+	for(int i = index * NORMALS_BLOCKS_PER_JOB; i < (index + 1) * NORMALS_BLOCKS_PER_JOB && i < job->numblocks; i++)
+	{
+		int first, last;
+		NormalsJobRange(job, i, job->mesh->numtris, &first, &last);
+
+		ComputeFaceFrames(job->surf->faces, job->surf->xyz, job->mesh, first, last);
+	}
+}
+
+static void VertexFramesJob(void *data, int index)
+{
+	normalsjob_t *job = (normalsjob_t*)data;
+
+	for(int i = index * NORMALS_BLOCKS_PER_JOB; i < (index + 1) * NORMALS_BLOCKS_PER_JOB && i < job->numblocks; i++)
+	{
+		int first, last;
+		NormalsJobRange(job, i, job->surf->numvertices, &first, &last);
+
+		GatherVertexFrames(job->surf, job->mesh, job->surf->faces, first, last);
+	}
+}
+
+// builds the frames of the given triangle blocks and then has the given
+// vertex blocks gather them, NULL lists mean every block
+static void RebuildTangentFrames(drawsurf_t *surf, md5mesh_t *mesh, int *triblocks, int numtriblocks, int *vertexblocks, int numvertexblocks)
+{
+	normalsjob_t job;
+	job.surf = surf;
+	job.mesh = mesh;
+
+	job.blocks = triblocks;
+	job.numblocks = numtriblocks;
+	Job_ParallelFor((numtriblocks + NORMALS_BLOCKS_PER_JOB - 1) / NORMALS_BLOCKS_PER_JOB, FaceFramesJob, &job);
+
+	job.blocks = vertexblocks;
+	job.numblocks = numvertexblocks;
+	Job_ParallelFor((numvertexblocks + NORMALS_BLOCKS_PER_JOB - 1) / NORMALS_BLOCKS_PER_JOB, VertexFramesJob, &job);
+}
+
+// rebuilds everything from the current positions. the joints the frames
+// were built from aren't known here, so the next update starts over as well
+static void ComputeNormalsAndTangents(drawsurf_t *surf, md5mesh_t *mesh)
+{
+	int numtriblocks = (mesh->numtris + NORMALS_BLOCK_SIZE - 1) / NORMALS_BLOCK_SIZE;
+	int numvertexblocks = (surf->numvertices + NORMALS_BLOCK_SIZE - 1) / NORMALS_BLOCK_SIZE;
+
+	RebuildTangentFrames(surf, mesh, NULL, numtriblocks, NULL, numvertexblocks);
+
+	surf->framesvalid = false;
+}
+
+// relative to the largest value in the matrix, the translations of the skin
+// matrices cancel down from the bind pose offsets and carry their rounding
+// noise. still far below a step of the packed normals, and a joint that
+// drifts slowly is caught once it gets this far from its last rebuild
+#define JOINT_MOVED_EPSILON	1e-5f
+
+static bool JointMoved(md5jointmat_t *a, md5jointmat_t *b)
+{
+	const float *fa = &a->m[0][0];
+	const float *fb = &b->m[0][0];
+
+	float scale = 1.0f;
+	for(int i = 0; i < 12; i++)
+	{
+		if(fabs(fb[i]) > scale)
+			scale = fabs(fb[i]);
+	}
+
+	for(int i = 0; i < 12; i++)
+	{
+		if(fabs(fa[i] - fb[i]) > JOINT_MOVED_EPSILON * scale)
+			return true;
+	}
+
+	return false;
+}
+
+// triangles rebuilt against the total, for the timedemo
+static int numupdatetris;
+static int numupdatetrisrebuilt;
+
+// only the blocks around joints that moved since their last rebuild are
+// redone, everything else keeps the frames it already has
+static void UpdateNormalsAndTangents(drawsurf_t *surf, md5mesh_t *mesh, md5jointmat_t *skinmats, int numjoints)
+{
+	int numtriblocks = (mesh->numtris + NORMALS_BLOCK_SIZE - 1) / NORMALS_BLOCK_SIZE;
+	int numvertexblocks = (surf->numvertices + NORMALS_BLOCK_SIZE - 1) / NORMALS_BLOCK_SIZE;
+
+	numupdatetris += mesh->numtris;
+
+	if(!surf->framesvalid)
+	{
+		RebuildTangentFrames(surf, mesh, NULL, numtriblocks, NULL, numvertexblocks);
+
+		memcpy(surf->lastskinmats, skinmats, numjoints * sizeof(md5jointmat_t));
+		surf->framesvalid = true;
+		numupdatetrisrebuilt += mesh->numtris;
+		return;
+	}
+
+	unsigned char *tridirty = (unsigned char*)Mem_Alloc(numtriblocks);
+	unsigned char *vertexdirty = (unsigned char*)Mem_Alloc(numvertexblocks);
+	memset(tridirty, 0, numtriblocks);
+	memset(vertexdirty, 0, numvertexblocks);
+
+	for(int i = 0; i < numjoints; i++)
+	{
+		if(!JointMoved(&skinmats[i], &surf->lastskinmats[i]))
+			continue;
+
+		surf->lastskinmats[i] = skinmats[i];
+
+		for(int j = mesh->firstjointtriblock[i]; j < mesh->firstjointtriblock[i + 1]; j++)
+		{
+			tridirty[mesh->jointtriblocks[j]] = 1;
+		}
+		for(int j = mesh->firstjointvertexblock[i]; j < mesh->firstjointvertexblock[i + 1]; j++)
+		{
+			vertexdirty[mesh->jointvertexblocks[j]] = 1;
+		}
+	}
+
+	int *triblocks = (int*)Mem_Alloc(numtriblocks * sizeof(int));
+	int *vertexblocks = (int*)Mem_Alloc(numvertexblocks * sizeof(int));
+	int numdirtytriblocks = 0;
+	int numdirtyvertexblocks = 0;
+
+	for(int i = 0; i < numtriblocks; i++)
+	{
+		if(tridirty[i])
+		{
+			triblocks[numdirtytriblocks++] = i;
+
+			int last = (i + 1) * NORMALS_BLOCK_SIZE < mesh->numtris ? (i + 1) * NORMALS_BLOCK_SIZE : mesh->numtris;
+			numupdatetrisrebuilt += last - i * NORMALS_BLOCK_SIZE;
+		}
+	}
+	for(int i = 0; i < numvertexblocks; i++)
+	{
+		if(vertexdirty[i])
+			vertexblocks[numdirtyvertexblocks++] = i;
+	}
+
+	RebuildTangentFrames(surf, mesh, triblocks, numdirtytriblocks, vertexblocks, numdirtyvertexblocks);
+}
+
+enum
+{
+	NORMALS_SKINNED,		// bind pose tangent frames through the joint matrices
+	NORMALS_RECOMPUTE,		// rebuilt from the skinned triangles, slower but exact
+	NUM_NORMALSMODES
+};
+
+static const char *normalsmodenames[NUM_NORMALSMODES] = { "skinned", "recompute" };
+
+static int normalsmode = NORMALS_SKINNED;
+
+// lines along every vertex's tangent frame, toggled with 't'
+static bool drawtangentframes;
+
+// texcoords are set at load, everything else follows the pose. the positions
+// go to xyz, which is surf->xyz whenever anything reads them back
+static void BuildVertexBuffer(float *xyz, drawsurf_t *surf, md5mesh_t *mesh, md5jointmat_t *skinmats)
+{
+	if(normalsmode == NORMALS_SKINNED)
+	{
+		SkinVertices(xyz, surf->normals, surf->tangents, mesh, skinmats);
+		surf->framesvalid = false;
+	}
+	else
+	{
+		SkinVertices(xyz, NULL, NULL, mesh, skinmats);
+	}
+}
+
+// in the skinned mode the normals were written with the positions
+static void BuildNormals(unsigned int *colors, drawsurf_t *surf, md5mesh_t *mesh, md5jointmat_t *skinmats)
+{
+	if(normalsmode == NORMALS_RECOMPUTE)
+	{
+		UpdateNormalsAndTangents(surf, mesh, skinmats, md5model->numjoints);
+	}
+
+	ComputeVertexColors(colors, surf);
+}
+
+// ==============================================
+// gpu buffers
+//
+// indices are uploaded once per mesh and the skinned vertices are streamed
+// every frame, either by orphaning the buffer and mapping it or through a
+// persistently mapped ring. client side arrays are kept as the fallback
+
+enum
+{
+	RENDERPATH_LEGACY,
+	RENDERPATH_ORPHAN,
+	RENDERPATH_PERSISTENT,
+	NUM_RENDERPATHS
+};
+
+static const char *renderpathnames[NUM_RENDERPATHS] = { "legacy", "orphan", "persistent" };
+
+// -1 picks the best one the driver supports
+static int renderpath = -1;
+
+// call with the context current
+static void R_SelectRenderPath()
+{
+	int major = 0, minor = 0;
+
+	const char *version = (const char*)glGetString(GL_VERSION);
+	if(version)
+	{
+		sscanf(version, "%d.%d", &major, &minor);
+	}
+
+	const char *extensions = (const char*)glGetString(GL_EXTENSIONS);
+	bool bufferstorage = extensions && strstr(extensions, "GL_ARB_buffer_storage");
+
+	int best = RENDERPATH_LEGACY;
+	if(major > 1 || (major == 1 && minor >= 5))
+	{
+		best = RENDERPATH_ORPHAN;
+	}
+	if(major > 4 || (major == 4 && minor >= 4) || (bufferstorage && (major > 3 || (major == 3 && minor >= 2))))
+	{
+		best = RENDERPATH_PERSISTENT;
+	}
+
+	if(renderpath > best)
+	{
+		Warning("%s vertex buffers aren't supported by GL %s, using %s\n", renderpathnames[renderpath], version, renderpathnames[best]);
+	}
+
+	if(renderpath < 0 || renderpath > best)
+	{
+		renderpath = best;
+	}
+
+	printf("render path: %s\n", renderpathnames[renderpath]);
+}
+
+// the draw only reads positions and colors, each frame streams them back to back
+static size_t R_StreamSize(drawsurf_t *surf)
+{
+	return surf->numvertices * (3 * sizeof(float) + sizeof(unsigned int));
+}
+
+static void R_CreateSurfBuffers(drawsurf_t *surf)
+{
+	int indexsize = surf->indextype == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+
+	glGenBuffers(1, &surf->indexbufferobject);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, surf->indexbufferobject);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, surf->numindicies * indexsize, surf->indexbuffer, GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	glGenBuffers(1, &surf->vertexbufferobject);
+	glBindBuffer(GL_ARRAY_BUFFER, surf->vertexbufferobject);
+
+	if(renderpath == RENDERPATH_PERSISTENT)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		GLsizeiptr size = VERTEX_RING_FRAMES * R_StreamSize(surf);
+
+		glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+		surf->ring = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+
+		if(!surf->ring)
+		{
+			Error("couldn't map the vertex ring\n");
+		}
+	}
+	else
+	{
+		glBufferData(GL_ARRAY_BUFFER, R_StreamSize(surf), NULL, GL_STREAM_DRAW);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// sets where this frame's positions and colors should be written
+static void R_BeginVertices(drawsurf_t *surf, float **xyz, unsigned int **colors)
+{
+	if(renderpath == RENDERPATH_LEGACY)
+	{
+		*xyz = surf->xyz;
+		*colors = surf->colors;
+		return;
+	}
+
+	if(!surf->vertexbufferobject)
+	{
+		R_CreateSurfBuffers(surf);
+	}
+
+	unsigned char *stream;
+
+	if(renderpath == RENDERPATH_PERSISTENT)
+	{
+		int frame = surf->ringframe;
+
+		// wait for the gpu to finish with the copy from VERTEX_RING_FRAMES ago
+		if(surf->ringfences[frame])
+		{
+			while(glClientWaitSync(surf->ringfences[frame], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+				;
+			glDeleteSync(surf->ringfences[frame]);
+			surf->ringfences[frame] = 0;
+		}
+
+		surf->vertexoffset = frame * R_StreamSize(surf);
+		stream = surf->ring + surf->vertexoffset;
+	}
+	else
+	{
+		// orphan the old storage so the map doesn't wait on the gpu
+		glBindBuffer(GL_ARRAY_BUFFER, surf->vertexbufferobject);
+		glBufferData(GL_ARRAY_BUFFER, R_StreamSize(surf), NULL, GL_STREAM_DRAW);
+
+		stream = (unsigned char*)glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
+		if(!stream)
+		{
+			Error("couldn't map a vertex buffer\n");
+		}
+
+		surf->vertexoffset = 0;
+	}
+
+	*xyz = (float*)stream;
+	*colors = (unsigned int*)(stream + surf->numvertices * 3 * sizeof(float));
+}
+
+static void R_EndVertices(drawsurf_t *surf)
+{
+	if(renderpath == RENDERPATH_ORPHAN)
+	{
+		// bound again as nothing says the array buffer is still the one mapped.
+		// a lost mapping only costs this frame's vertices, the next frame rewrites them all
+		glBindBuffer(GL_ARRAY_BUFFER, surf->vertexbufferobject);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+}
+
+static void R_DrawSurf(drawsurf_t *surf)
+{
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+
+	if(renderpath == RENDERPATH_LEGACY)
+	{
+		glVertexPointer(3, GL_FLOAT, 0, surf->xyz);
+		glColorPointer(4, GL_UNSIGNED_BYTE, 0, surf->colors);
+		glDrawElements(GL_TRIANGLES, surf->numindicies, surf->indextype, surf->indexbuffer);
+	}
+	else
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, surf->vertexbufferobject);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, surf->indexbufferobject);
+
+		glVertexPointer(3, GL_FLOAT, 0, (void*)surf->vertexoffset);
+		glColorPointer(4, GL_UNSIGNED_BYTE, 0, (void*)(surf->vertexoffset + surf->numvertices * 3 * sizeof(float)));
+		glDrawElements(GL_TRIANGLES, surf->numindicies, surf->indextype, NULL);
+
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+		if(renderpath == RENDERPATH_PERSISTENT)
+		{
+			surf->ringfences[surf->ringframe] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			surf->ringframe = (surf->ringframe + 1) % VERTEX_RING_FRAMES;
+		}
+	}
+
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_COLOR_ARRAY);
+}
+
+static void RenderGeometry(md5jointmat_t *skinmats)
+{
+	for(md5mesh_t *mesh = md5model->meshes; mesh; mesh = mesh->next)
+	{
+		drawsurf_t *surf = &mesh->surf;
+
+		float *xyz;
+		unsigned int *colors;
+		R_BeginVertices(surf, &xyz, &colors);
+
+		// the streams are written straight into the buffer, except for the
+		// positions when the recomputed normals or the tangent frame lines
+		// read them back. those are built in system memory and copied over
+		bool staged = normalsmode == NORMALS_RECOMPUTE || drawtangentframes;
+
+		BuildVertexBuffer(staged ? surf->xyz : xyz, surf, mesh, skinmats);
+		BuildNormals(colors, surf, mesh, skinmats);
+
+		if(staged && xyz != surf->xyz)
+		{
+			memcpy(xyz, surf->xyz, surf->numvertices * 3 * sizeof(float));
+		}
+		R_EndVertices(surf);
+
+		//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+		R_DrawSurf(surf);
+
+		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+		if(drawtangentframes)
+		{
+			DrawNormals(surf);
+		}
+	}
+}
+
+// ==============================================
+// frame scratch
+//
+// the joints and matrices a frame is built from come out of a stack owned by
+// the thread building it, which is reset at the start of every frame. once
+// the first frame has sized it nothing more should be mapped
+
+static __thread memstack_t framestack;
+static __thread int framestacknumchunks;
+static __thread int numscratchframes;
+
+// makes any frame that maps memory after the first an error
+static bool checkframealloc;
+
+// returns the previous stack for Frame_EndScratch
+static memstack_t *Frame_BeginScratch()
+{
+	if(!framestack.name)
+	{
+		Mem_InitStack(&framestack, "frame scratch");
+	}
+
+	Mem_ResetStack(&framestack);
+	framestacknumchunks = memnumchunks;
+
+	return Mem_SetStack(&framestack);
+}
+
+static void Frame_EndScratch(memstack_t *oldstack)
+{
+	Mem_SetStack(oldstack);
+
+	// other threads can map chunks as well, so this is only exact when
+	// nothing else is loading
+	if(checkframealloc && numscratchframes && memnumchunks != framestacknumchunks)
+	{
+		Error("frame %i mapped %i new chunks in a steady state\n", numscratchframes, memnumchunks - framestacknumchunks);
+	}
+
+	numscratchframes++;
+}
+
+static md5jointmat_t *Mem_AllocJointMat(int nummatrices)
+{
+	return (md5jointmat_t*)Mem_AllocAligned(nummatrices * sizeof(md5jointmat_t), 64);
+}
+
+// per frame joints and matrices, all sized to the anim
+typedef struct framepose_s
+{
+	md5pose_t		joints[2];		// the two frames being blended, when they aren't cached
+	md5pose_t		blended;
+	md5jointmat_t	*palette;
+	md5jointmat_t	*skinmats;
+
+} framepose_t;
+
+static void Frame_AllocPose(framepose_t *pose, int numjoints)
+{
+	Mem_AllocPose(&pose->joints[0], POSE_STRIDE(numjoints));
+	Mem_AllocPose(&pose->joints[1], POSE_STRIDE(numjoints));
+	Mem_AllocPose(&pose->blended, POSE_STRIDE(numjoints));
+	pose->palette = Mem_AllocJointMat(numjoints);
+	pose->skinmats = Mem_AllocJointMat(numjoints);
+}
+//==============================================
+// pose cache
+//
+// decoded keyframes kept by anim and frame, so a frame that is blended over
+// several ticks, or played by several instances, is only decoded once. every
+// slot is sized for the largest pose, and the least recently used one is
+// handed out again once the budget is spent. only the thread running the
+// frame uses it
+
+typedef struct posecacheslot_s
+{
+	md5anim_t		*anim;			// NULL while the slot is empty
+	int				frame;
+	float			*planes;
+	md5pose_t		pose;
+
+	struct posecacheslot_s	*hashnext;
+	struct posecacheslot_s	*prev;		// most recently used first
+	struct posecacheslot_s	*next;
+
+} posecacheslot_t;
+
+static int posecachebudget = 1024;		// kilobytes, 0 turns the cache off
+
+static memstack_t posecachestack;
+static int posecachenumslots;
+static int posecachestride;
+static posecacheslot_t **posecachehash;
+static int posecachehashmask;
+static posecacheslot_t posecachelru;	// head of the circular lru list
+
+static int posecachehits;
+static int posecachemisses;
+static int posecacheevictions;
+
+static void PoseCache_Unlink(posecacheslot_t *slot)
+{
+	slot->prev->next = slot->next;
+	slot->next->prev = slot->prev;
+}
+
+static void PoseCache_LinkFront(posecacheslot_t *slot)
+{
+	slot->prev = &posecachelru;
+	slot->next = posecachelru.next;
+	slot->next->prev = slot;
+	posecachelru.next = slot;
+}
+
+static int PoseCache_Hash(md5anim_t *anim, int frame)
+{
+	return (int)(((size_t)anim >> 4) * 2654435761u + frame * 40503u) & posecachehashmask;
+}
+
+// the slots are sized for the anims of the model being shown, anything
+// bigger goes around the cache
+static void PoseCache_Init()
+{
+	int maxstride = 0;
+	for(md5anim_t *anim = md5model ? md5model->anims : NULL; anim; anim = anim->next)
+	{
+		if(anim->posestride > maxstride)
+			maxstride = anim->posestride;
+	}
+
+	if(!maxstride)
+	{
+		return;
+	}
+
+	size_t slotbytes = POSE_FLOATS(maxstride) * sizeof(float) + sizeof(posecacheslot_t) + 2 * sizeof(posecacheslot_t*);
+	int numslots = (int)((size_t)posecachebudget * 1024 / slotbytes);
+
+	// a blend holds on to two frames at once
+	if(numslots < 2)
+	{
+		if(posecachebudget)
+		{
+			Warning("pose cache budget of %i KB is too small for two poses, not caching\n", posecachebudget);
+		}
+		return;
+	}
+
+	Mem_InitStack(&posecachestack, "pose cache");
+	memstack_t *oldstack = Mem_SetStack(&posecachestack);
+
+	int numbuckets = 1;
+	while(numbuckets < 2 * numslots)
+	{
+		numbuckets <<= 1;
+	}
+
+	posecachehash = (posecacheslot_t**)Mem_Alloc(numbuckets * sizeof(posecacheslot_t*));
+	memset(posecachehash, 0, numbuckets * sizeof(posecacheslot_t*));
+	posecachehashmask = numbuckets - 1;
+
+	posecacheslot_t *slots = (posecacheslot_t*)Mem_Alloc(numslots * sizeof(posecacheslot_t));
+	memset(slots, 0, numslots * sizeof(posecacheslot_t));
+
+	posecachelru.prev = posecachelru.next = &posecachelru;
+	for(int i = 0; i < numslots; i++)
+	{
+		slots[i].planes = (float*)Mem_AllocAligned(POSE_FLOATS(maxstride) * sizeof(float), 64);
+		PoseCache_LinkFront(&slots[i]);
+	}
+
+	Mem_SetStack(oldstack);
+
+	posecachenumslots = numslots;
+	posecachestride = maxstride;
+}
+
+// returns the decoded frame, out of the cache if it is there. scratch is
+// only decoded into when the cache is off
+static md5pose_t *PoseCache_Get(md5anim_t *anim, int frame, md5pose_t *scratch)
+{
+	if(!posecachenumslots || anim->posestride > posecachestride)
+	{
+		ComputeFramePose(scratch, anim, frame);
+		return scratch;
+	}
+
+	posecacheslot_t **bucket = &posecachehash[PoseCache_Hash(anim, frame)];
+	posecacheslot_t *slot;
+
+	for(slot = *bucket; slot; slot = slot->hashnext)
+	{
+		if(slot->anim == anim && slot->frame == frame)
+		{
+			posecachehits++;
+
+			PoseCache_Unlink(slot);
+			PoseCache_LinkFront(slot);
+
+			return &slot->pose;
+		}
+	}
+
+	posecachemisses++;
+
+	// empty slots start out at the back, so they are used up first
+	slot = posecachelru.prev;
+
+	if(slot->anim)
+	{
+		posecacheslot_t **link = &posecachehash[PoseCache_Hash(slot->anim, slot->frame)];
+		while(*link != slot)
+		{
+			link = &(*link)->hashnext;
+		}
+		*link = slot->hashnext;
+
+		posecacheevictions++;
+	}
+
+	slot->anim = anim;
+	slot->frame = frame;
+	slot->hashnext = *bucket;
+	*bucket = slot;
+
+	PoseCache_Unlink(slot);
+	PoseCache_LinkFront(slot);
+
+	Pose_SetPlanes(&slot->pose, slot->planes, anim->posestride);
+	ComputeFramePose(&slot->pose, anim, frame);
+
+	return &slot->pose;
+}
+
+//==============================================
+// anim baking
+//
+// the most used anims can have every frame decoded at load, within a memory
+// budget. a baked frame is sampled by pointing a pose at it, so a blend is
+// just the two frames and the nlerp between them
+
+static int bakebudget;			// kilobytes, 0 bakes nothing
+static memstack_t bakestack;
+
+// each frame's rotations are flipped to the same side as the frame before,
+// so blending neighbouring frames never has to. the nlerp still checks, for
+// the wrap from the last frame back to the first
+static void BakeAnim(md5anim_t *anim)
+{
+	int stride = anim->posestride;
+
+	// keeps every frame's planes aligned for the simd w
+	anim->bakedpitch = (POSE_FLOATS(stride) + 15) & ~15;
+	anim->bakedposes = (float*)Mem_AllocAligned(anim->numframes * anim->bakedpitch * sizeof(float), 64);
+
+	md5pose_t prev;
+	for(int f = 0; f < anim->numframes; f++)
+	{
+		md5pose_t pose;
+		Pose_SetPlanes(&pose, anim->bakedposes + f * anim->bakedpitch, stride);
+		ComputeFramePose(&pose, anim, f);
+
+		if(f)
+		{
+			for(int i = 0; i < stride; i++)
+			{
+				float cosom = pose.q[0][i] * prev.q[0][i] + pose.q[1][i] * prev.q[1][i] + pose.q[2][i] * prev.q[2][i] + pose.q[3][i] * prev.q[3][i];
+
+				if(cosom < 0.0f)
+				{
+					for(int c = 0; c < 4; c++)
+					{
+						pose.q[c][i] = -pose.q[c][i];
+					}
+				}
+			}
+		}
+
+		prev = pose;
+	}
+}
+
+static int CompareAnimUses(const void *a, const void *b)
+{
+	const md5anim_t *anima = *(const md5anim_t**)a;
+	const md5anim_t *animb = *(const md5anim_t**)b;
+
+	if(anima->usecount != animb->usecount)
+		return animb->usecount - anima->usecount;
+
+	// the smaller one leaves more room for the rest
+	return anima->numframes * anima->posestride - animb->numframes * animb->posestride;
+}
+
+// anims are counted once for every instance that plays them, the same way
+// the timedemo deals them out, and baked most used first while they fit
+static void BakeAnims(int numinstances)
+{
+	if(!bakebudget || !md5model || !md5model->anims)
+	{
+		return;
+	}
+
+	int numanims = 0;
+	for(md5anim_t *anim = md5model->anims; anim; anim = anim->next)
+	{
+		numanims++;
+	}
+
+	md5anim_t **anims = (md5anim_t**)Mem_Alloc(numanims * sizeof(md5anim_t*));
+	numanims = 0;
+	for(md5anim_t *anim = md5model->anims; anim; anim = anim->next)
+	{
+		anim->usecount = 0;
+		anims[numanims++] = anim;
+	}
+
+	for(int n = 0; n < numinstances; n++)
+	{
+		anims[n % numanims]->usecount++;
+	}
+
+	qsort(anims, numanims, sizeof(md5anim_t*), CompareAnimUses);
+
+	Mem_InitStack(&bakestack, "anim bake");
+	memstack_t *oldstack = Mem_SetStack(&bakestack);
+
+	size_t budget = (size_t)bakebudget * 1024;
+	size_t used = 0;
+
+	for(int i = 0; i < numanims; i++)
+	{
+		md5anim_t *anim = anims[i];
+		size_t size = (size_t)anim->numframes * ((POSE_FLOATS(anim->posestride) + 15) & ~15) * sizeof(float);
+
+		if(!anim->usecount || used + size > budget)
+		{
+			printf("bake: skipped \"%s\", %i uses, %zu KB\n", anim->name, anim->usecount, size / 1024);
+			continue;
+		}
+
+		BakeAnim(anim);
+		used += size;
+
+		printf("bake: baked \"%s\", %i uses, %i frames, %zu KB\n", anim->name, anim->usecount, anim->numframes, size / 1024);
+	}
+
+	Mem_SetStack(oldstack);
+
+	printf("bake: %zu of %i KB used\n", used / 1024, bakebudget);
+}
+
+// the pose for one frame of an anim, pointing into the bake, out of the pose
+// cache or decoded into scratch
+static md5pose_t *SampleFramePose(md5anim_t *anim, int frame, md5pose_t *scratch)
+{
+	if(anim->bakedposes)
+	{
+		Pose_SetPlanes(scratch, anim->bakedposes + frame * anim->bakedpitch, anim->posestride);
+		return scratch;
+	}
+
+	return PoseCache_Get(anim, frame, scratch);
+}
+
+// static currentanim
+
+// fixme: fill this out. all anim crap should go in here
+typedef struct animstate_s
+{
+
+} animstate_t;
+
+// work out the pair of frames and the blend factor to sample the anim at for a given frame number
+static void AnimFrameLerp(md5anim_t *anim, int framenum, int *frame0, int *frame1, float *lerp)
+{
+	float time = framenum * 0.032f;
+	float animtime = time * 6; //anim->framerate;
+	*frame0 = (int)floor(animtime) % anim->numframes;
+	*frame1 = (*frame0 + 1) % anim->numframes;
+	*lerp = animtime - floor(animtime);
+}
+
+static void JointTest()
+{
+	memstack_t *oldstack = Frame_BeginScratch();
+
+	framepose_t pose;
+	Frame_AllocPose(&pose, md5model->anims[0].numjoints);
+
+	//ComputeFramePose(&pose.blended, &md5model->anims[0], framenum % md5model->anims[0].numframes);
+	//PrintJointList(pose.blended, md5model->numjoints);
+	int frame0, frame1;
+	float lerp;
+	AnimFrameLerp(&md5model->anims[0], framenum, &frame0, &frame1, &lerp);
+
+	//if(frame0 > md5model->anims[0].numframes)
+	//	frame0 = md5model->anims[0].numframes - 1;
+	//if(frame1 > md5model->anims[0].numframes)
+	//	frame1 = md5model->anims[0].numframes - 1;
+	//frame0 = framenum % md5model->anims[0].numframes;
+	//frame1 = (framenum + 1) % md5model->anims[0].numframes;
+
+	//if(frame0 == 17)
+	//{
+	//	frame0 = 17;
+	//	frame1 = 19;
+	//}
+	//frame0 = 19; frame1 = 20;
+	//lerp = 0.0f;
+	
+	md5pose_t *from = SampleFramePose(&md5model->anims[0], frame0, &pose.joints[0]);
+
+	md5pose_t *to = SampleFramePose(&md5model->anims[0], frame1, &pose.joints[1]);
+
+	LerpJoints(&pose.blended, from, to, lerp, &md5model->anims[0]);
+
+	//printf("frame %i\n", frame0);
+	//PrintJointList(pose.joints[0], md5model->anims[0].numjoints);
+	//PrintJointList(pose.joints[1], md5model->anims[0].numjoints);
+	//PrintJointList(pose.blended, md5model->anims[0].numjoints);
+
+	ComputeGlobalMatrices(pose.palette, &pose.blended, &md5model->anims[0]);
+	ComputeSkinMatrices(pose.skinmats, pose.palette, md5model->inversebindmats, &md5model->anims[0]);
+
+	RenderGeometry(pose.skinmats);
+
+	RenderHierarchy(md5model->anims[0].parents, pose.palette, md5model->anims[0].numjoints);
+
+	Frame_EndScratch(oldstack);
+}
+
+// pick the fastest version of each kernel the cpu supports
+static void SelectKernels()
+{
+	SkinVertices = SkinVertices_Generic;
+	ComputeGlobalMatrices = ComputeGlobalMatrices_Generic;
+	ComputeSkinMatrices = ComputeSkinMatrices_Generic;
+	DecodeTracks = DecodeTracks_Generic;
+	DecodeRotations = DecodeRotations_Generic;
+	ComputePoseW = ComputePoseW_Generic;
+	ComputeFaceFrames = ComputeFaceFrames_Generic;
+	GatherVertexFrames = GatherVertexFrames_Generic;
+	skinkernelname = "generic";
+	palettekernelname = "generic";
+	decodekernelname = "generic";
+
+#ifdef USE_SIMD
+	if(cpufeatures & CPU_SSE2)
+	{
+		SkinVertices = SkinVertices_SSE2;
+		ComputeGlobalMatrices = ComputeGlobalMatrices_SSE2;
+		ComputeSkinMatrices = ComputeSkinMatrices_SSE2;
+		DecodeTracks = DecodeTracks_SSE2;
+		DecodeRotations = DecodeRotations_SSE2;
+		ComputePoseW = ComputePoseW_SSE2;
+		ComputeFaceFrames = ComputeFaceFrames_SSE2;
+		GatherVertexFrames = GatherVertexFrames_SSE2;
+		skinkernelname = "sse2";
+		palettekernelname = "sse2";
+		decodekernelname = "sse2";
+	}
+	if(cpufeatures & CPU_AVX2)
+	{
+		SkinVertices = SkinVertices_AVX2;
+		ComputeGlobalMatrices = ComputeGlobalMatrices_AVX2;
+		ComputeSkinMatrices = ComputeSkinMatrices_AVX2;
+		DecodeTracks = DecodeTracks_AVX2;
+		DecodeRotations = DecodeRotations_AVX2;
+		ComputePoseW = ComputePoseW_AVX2;
+		ComputeFaceFrames = ComputeFaceFrames_AVX2;
+		GatherVertexFrames = GatherVertexFrames_AVX2;
+		skinkernelname = "avx2";
+		palettekernelname = "avx2";
+		decodekernelname = "avx2";
+	}
+#endif
+}
+
+//==============================================
+// timedemo
+//
+// runs the animation and skinning pipeline without a window so the cpu cost
+// of each stage can be measured on machines without a display
+
+enum
+{
+	STAGE_DECODE,
+	STAGE_LERP,
+	STAGE_PALETTE,
+	STAGE_SKIN,
+	STAGE_NORMALS,
+	NUM_STAGES
+};
+
+static const char *stagenames[NUM_STAGES] =
+{
+	"decode",
+	"lerp",
+	"palette",
+	"skin",
+	"normals"
+};
+
+static int timedemoframes;
+static int timedemoinstances = 1;
+static bool timedemoverify;
+static bool timedemoskeleton;	// stop at the skin matrices, like a server would
+
+// ticks between instances, so the ones sharing an anim are spread over it
+#define TIMEDEMO_INSTANCE_SPREAD	7
+
+static float MaxVertexError(float *a, float *b, int numvertices)
+{
+	float maxerror = 0.0f;
+
+	for(int i = 0; i < numvertices * 3; i++)
+	{
+		// relative to the size of the coordinate for big models
+		float error = fabs(a[i] - b[i]) / (1.0f + fabs(a[i]));
+
+		if(error > maxerror)
+			maxerror = error;
+	}
+
+	return maxerror;
+}
+
+// largest difference in any component, a flipped bitangent counts as 2
+static float MaxNormalError(unsigned int *a, unsigned int *b, int numvertices)
+{
+	float maxerror = 0.0f;
+
+	for(int i = 0; i < numvertices; i++)
+	{
+		float va[3], vb[3];
+		int wa = UnpackNormal(va, a[i]);
+		int wb = UnpackNormal(vb, b[i]);
+
+		float error = wa != wb ? 2.0f : 0.0f;
+		for(int j = 0; j < 3; j++)
+		{
+			if(fabs(va[j] - vb[j]) > error)
+				error = fabs(va[j] - vb[j]);
+		}
+
+		if(error > maxerror)
+			maxerror = error;
+	}
+
+	return maxerror;
+}
+
+// a bit over one step of the 10 bit packing
+static const float packedtolerance = 2.5f / 511.0f;
+
+// a frame's components in the file's layout from whatever the anim keeps.
+// quantized rotations bring their own w, kept under the component of their x
+static void ReferenceFrameComponents(float *components, float *w, md5anim_t *anim, int frame)
+{
+	md5quantanim_t *quant = anim->quant;
+
+	// the reduced tracks are the components that aren't discarded, in order
+	md5reducedanim_t *reduced = anim->reduced;
+	if(reduced)
+	{
+		int discard = POSE_NUM_PLANES * anim->posestride;
+
+		for(int k = 0, t = 0; k < anim->numanimatedcomponents; k++)
+		{
+			components[k] = (anim->decodeslots[k] == discard) ? 0.0f : EvaluateReducedTrack(reduced, t++, frame);
+		}
+		return;
+	}
+
+	if(!quant)
+	{
+		memcpy(components, anim->framedata + frame * anim->numanimatedcomponents, anim->numanimatedcomponents * sizeof(float));
+		return;
+	}
+
+	const unsigned short *data = quant->frames + frame * quant->framepitch;
+
+	for(int k = 0; k < quant->numtracks; k++)
+	{
+		components[quant->trackcomponents[k]] = (float)data[k] * quant->trackscale[k] + quant->trackmin[k];
+	}
+
+	int n = quant->numrotations;
+	const unsigned short *da = data + quant->numtracks;
+	const unsigned short *db = da + n;
+	const unsigned short *dc = db + n;
+
+	for(int k = 0; k < n; k++)
+	{
+		float q[4];
+		DecodeRotation(q, da[k], db[k], dc[k]);
+
+		int c = quant->rotationcomponents[k];
+		components[c] = q[0];
+		components[c + 1] = q[1];
+		components[c + 2] = q[2];
+		w[c] = q[3];
+	}
+}
+
+// the decode plan against walking every joint's flags through the frame the
+// way the components are laid out in the file. quantized and reduced anims
+// are walked over their decoded components, so they have to come out as
+// close as the floats do
+static void VerifyDecode(md5anim_t *anim)
+{
+	const int rotationflags = MD5_ANIM_QX | MD5_ANIM_QY | MD5_ANIM_QZ;
+	const float tolerance = 1e-6f;
+	float maxerror = 0.0f;
+
+	for(int i = 0; i < anim->numframes; i += 1 + anim->numframes / 16)
+	{
+		memstack_t *oldstack = Frame_BeginScratch();
+
+		framepose_t pose;
+		Frame_AllocPose(&pose, anim->numjoints);
+
+		float *components = (float*)Mem_Alloc(anim->numanimatedcomponents * sizeof(float));
+		float *w = (float*)Mem_Alloc(anim->numanimatedcomponents * sizeof(float));
+		ReferenceFrameComponents(components, w, anim, i);
+
+		for(int j = 0, k = 0; j < anim->numjoints; j++)
+		{
+			md5joint_t joint = anim->joints[j];
+			int rotation = -1;
+
+			for(int c = 0; c < 6; c++)
+			{
+				if(joint.flags & (1 << c))
+				{
+					if(c == 3)
+						rotation = k;
+
+					*(c < 3 ? &joint.p[c] : &joint.q[c - 3]) = components[k++];
+				}
+			}
+
+			if(anim->quant && (joint.flags & rotationflags) == rotationflags)
+				joint.q[3] = w[rotation];
+			else
+				joint.q[3] = ComputeQuatW(&joint);
+
+			if(j == 0)
+			{
+				joint.p[0] = joint.p[1] = joint.p[2] = 0.0f;
+			}
+
+			for(int c = 0; c < 3; c++)
+			{
+				pose.joints[1].p[c][j] = joint.p[c];
+			}
+			for(int c = 0; c < 4; c++)
+			{
+				pose.joints[1].q[c][j] = joint.q[c];
+			}
+		}
+
+		ComputeFramePose(&pose.blended, anim, i);
+
+		float error = MaxPoseError(&pose.blended, &pose.joints[1], anim->numjoints, NULL);
+		if(error > maxerror)
+			maxerror = error;
+
+		// a baked frame can only differ by the side its rotations are on
+		if(anim->bakedposes)
+		{
+			md5pose_t *baked = SampleFramePose(anim, i, &pose.joints[0]);
+
+			error = MaxPoseError(baked, &pose.blended, anim->numjoints, NULL);
+			if(error > maxerror)
+				maxerror = error;
+		}
+
+		Frame_EndScratch(oldstack);
+	}
+
+	printf("verify: decode max error %g\n", maxerror);
+
+	if(maxerror > tolerance)
+	{
+		Error("decoded pose differs from the frame data by more than %g\n", tolerance);
+	}
+}
+
+// check the selected kernels against the generic code over a spread of frames
+static void VerifyKernels(md5anim_t *anim)
+{
+	const float tolerance = 1e-5f;
+	float maxerror = 0.0f;
+	float maxnormalerror = 0.0f;
+	float maxrecomputeerror = 0.0f;
+	float maxpaletteerror = 0.0f;
+	float maxdecodeerror = 0.0f;
+
+	for(int i = 0; i < anim->numframes; i += 1 + anim->numframes / 16)
+	{
+		memstack_t *oldstack = Frame_BeginScratch();
+
+		framepose_t pose;
+		Frame_AllocPose(&pose, anim->numjoints);
+
+		ComputeFramePose(&pose.blended, anim, i);
+
+		// the quantized frame the way ComputeFramePose does it, all generic
+		md5quantanim_t *quant = anim->quant;
+		if(quant)
+		{
+			const unsigned short *data = quant->frames + i * quant->framepitch;
+
+			memcpy(pose.joints[0].p[0], anim->basepose, (POSE_NUM_PLANES - 1) * anim->posestride * sizeof(float));
+			DecodeTracks_Generic(pose.joints[0].p[0], quant, data);
+			ComputePoseW_Generic(&pose.joints[0], anim->posestride);
+			DecodeRotations_Generic(&pose.joints[0], quant, data);
+
+			float error = MaxPoseError(&pose.joints[0], &pose.blended, anim->numjoints, NULL);
+			if(error > maxdecodeerror)
+				maxdecodeerror = error;
+		}
+		ComputeGlobalMatrices(pose.palette, &pose.blended, anim);
+		ComputeSkinMatrices(pose.skinmats, pose.palette, md5model->inversebindmats, anim);
+
+		// the batched palette, a matrix is checked as four vertices
+		md5jointmat_t *referencepalette = Mem_AllocJointMat(anim->numjoints);
+		md5jointmat_t *referenceskinmats = Mem_AllocJointMat(anim->numjoints);
+
+		ComputeGlobalMatrices_Generic(referencepalette, &pose.blended, anim);
+		ComputeSkinMatrices_Generic(referenceskinmats, referencepalette, md5model->inversebindmats, anim);
+
+		float paletteerror = MaxVertexError(&referencepalette[0].m[0][0], &pose.palette[0].m[0][0], anim->numjoints * 4);
+		if(paletteerror > maxpaletteerror)
+			maxpaletteerror = paletteerror;
+
+		paletteerror = MaxVertexError(&referenceskinmats[0].m[0][0], &pose.skinmats[0].m[0][0], anim->numjoints * 4);
+		if(paletteerror > maxpaletteerror)
+			maxpaletteerror = paletteerror;
+
+		for(md5mesh_t *mesh = md5model->meshes; mesh; mesh = mesh->next)
+		{
+			drawsurf_t *surf = &mesh->surf;
+			float *reference = (float*)Mem_Alloc(mesh->numvertices * 3 * sizeof(float));
+			unsigned int *referencenormals = (unsigned int*)Mem_Alloc(mesh->numvertices * sizeof(unsigned int));
+			unsigned int *referencetangents = (unsigned int*)Mem_Alloc(mesh->numvertices * sizeof(unsigned int));
+
+			SkinVertices_Generic(reference, referencenormals, referencetangents, mesh, pose.skinmats);
+			SkinVertices(surf->xyz, surf->normals, surf->tangents, mesh, pose.skinmats);
+
+			float error = MaxVertexError(reference, surf->xyz, mesh->numvertices);
+			if(error > maxerror)
+				maxerror = error;
+
+			error = MaxNormalError(referencenormals, surf->normals, mesh->numvertices);
+			if(error > maxnormalerror)
+				maxnormalerror = error;
+
+			error = MaxNormalError(referencetangents, surf->tangents, mesh->numvertices);
+			if(error > maxnormalerror)
+				maxnormalerror = error;
+
+			// recomputed from the triangles, both from the same positions
+			drawsurf_t referencesurf = *surf;
+			referencesurf.normals = referencenormals;
+			referencesurf.tangents = referencetangents;
+
+			float *faces = Mem_AllocFaceFrames(mesh->numtris);
+			ComputeFaceFrames_Generic(faces, surf->xyz, mesh, 0, mesh->numtris);
+			GatherVertexFrames_Generic(&referencesurf, mesh, faces, 0, mesh->numvertices);
+
+			ComputeNormalsAndTangents(surf, mesh);
+
+			error = MaxNormalError(referencenormals, surf->normals, mesh->numvertices);
+			if(error > maxrecomputeerror)
+				maxrecomputeerror = error;
+
+			error = MaxNormalError(referencetangents, surf->tangents, mesh->numvertices);
+			if(error > maxrecomputeerror)
+				maxrecomputeerror = error;
+		}
+
+		Frame_EndScratch(oldstack);
+	}
+
+	if(anim->quant)
+	{
+		printf("verify: %s decode max error %g\n", decodekernelname, maxdecodeerror);
+	}
+	printf("verify: %s palette max relative error %g\n", palettekernelname, maxpaletteerror);
+	printf("verify: %s skinning max relative error %g, skinned tangent frames %g, recomputed %g\n",
+		skinkernelname, maxerror, maxnormalerror, maxrecomputeerror);
+
+	if(maxdecodeerror > tolerance)
+	{
+		Error("%s decode differs from the generic code by more than %g\n", decodekernelname, tolerance);
+	}
+	if(maxpaletteerror > tolerance)
+	{
+		Error("%s palette differs from the generic code by more than %g\n", palettekernelname, tolerance);
+	}
+
+	if(maxerror > tolerance)
+	{
+		Error("%s skinning differs from the generic code by more than %g\n", skinkernelname, tolerance);
+	}
+	if(maxnormalerror > packedtolerance)
+	{
+		Error("%s skinned tangent frames differ from the generic code by more than %g\n", skinkernelname, packedtolerance);
+	}
+	if(maxrecomputeerror > packedtolerance)
+	{
+		Error("%s recomputed tangent frames differ from the generic code by more than %g\n", skinkernelname, packedtolerance);
+	}
+}
+
+// angle in degrees between two packed vectors
+static float PackedAngle(unsigned int a, unsigned int b)
+{
+	float va[3], vb[3];
+	UnpackNormal(va, a);
+	UnpackNormal(vb, b);
+
+	float cosine = Vector_Dot(va, vb) / sqrtf(Vector_Dot(va, va) * Vector_Dot(vb, vb));
+	cosine = cosine > 1.0f ? 1.0f : (cosine < -1.0f ? -1.0f : cosine);
+
+	return acosf(cosine) * (180.0f / M_PI);
+}
+
+// the skinned tangent frames against the ones rebuilt from the triangles.
+// when the whole mesh moves with one joint they have to agree, once joints
+// bend against each other they drift apart and the difference is only reported
+static void VerifyNormals(md5anim_t *anim)
+{
+	memstack_t *oldstack = Frame_BeginScratch();
+
+	framepose_t pose;
+	Frame_AllocPose(&pose, anim->numjoints);
+
+	ComputeFramePose(&pose.blended, anim, 0);
+	ComputeGlobalMatrices(pose.palette, &pose.blended, anim);
+	ComputeSkinMatrices(pose.skinmats, pose.palette, md5model->inversebindmats, anim);
+
+	md5jointmat_t *rigid = Mem_AllocJointMat(anim->numjoints);
+	for(int i = 0; i < anim->numjoints; i++)
+	{
+		rigid[i] = pose.skinmats[0];
+	}
+
+	float rigiderror = 0.0f;
+	for(md5mesh_t *mesh = md5model->meshes; mesh; mesh = mesh->next)
+	{
+		drawsurf_t *surf = &mesh->surf;
+		unsigned int *skinnednormals = (unsigned int*)Mem_Alloc(mesh->numvertices * sizeof(unsigned int));
+		unsigned int *skinnedtangents = (unsigned int*)Mem_Alloc(mesh->numvertices * sizeof(unsigned int));
+
+		SkinVertices(surf->xyz, skinnednormals, skinnedtangents, mesh, rigid);
+		ComputeNormalsAndTangents(surf, mesh);
+
+		float error = MaxNormalError(skinnednormals, surf->normals, mesh->numvertices);
+		if(error > rigiderror)
+			rigiderror = error;
+
+		error = MaxNormalError(skinnedtangents, surf->tangents, mesh->numvertices);
+		if(error > rigiderror)
+			rigiderror = error;
+	}
+
+	Frame_EndScratch(oldstack);
+
+	double totalangle = 0.0;
+	float maxangle = 0.0f;
+	int numangles = 0;
+	int numflipped = 0;
+
+	for(int i = 0; i < anim->numframes; i += 1 + anim->numframes / 16)
+	{
+		oldstack = Frame_BeginScratch();
+
+		Frame_AllocPose(&pose, anim->numjoints);
+
+		ComputeFramePose(&pose.blended, anim, i);
+		ComputeGlobalMatrices(pose.palette, &pose.blended, anim);
+		ComputeSkinMatrices(pose.skinmats, pose.palette, md5model->inversebindmats, anim);
+
+		for(md5mesh_t *mesh = md5model->meshes; mesh; mesh = mesh->next)
+		{
+			drawsurf_t *surf = &mesh->surf;
+			unsigned int *skinnednormals = (unsigned int*)Mem_Alloc(mesh->numvertices * sizeof(unsigned int));
+			unsigned int *skinnedtangents = (unsigned int*)Mem_Alloc(mesh->numvertices * sizeof(unsigned int));
+
+			SkinVertices(surf->xyz, skinnednormals, skinnedtangents, mesh, pose.skinmats);
+			ComputeNormalsAndTangents(surf, mesh);
+
+			for(int j = 0; j < mesh->numvertices; j++)
+			{
+				float angle = PackedAngle(skinnednormals[j], surf->normals[j]);
+
+				totalangle += angle;
+				if(angle > maxangle)
+					maxangle = angle;
+				if((skinnedtangents[j] ^ surf->tangents[j]) >> 30)
+					numflipped++;
+				numangles++;
+			}
+		}
+
+		Frame_EndScratch(oldstack);
+	}
+
+	printf("verify: skinned normals rigid pose error %g, animated avg %.3f max %.3f degrees, %i of %i bitangents flipped\n",
+		rigiderror, numangles ? totalangle / numangles : 0.0, maxangle, numflipped, numangles);
+
+	if(rigiderror > packedtolerance)
+	{
+		Error("skinned tangent frames differ from the recomputed ones in a rigid pose by more than %g\n", packedtolerance);
+	}
+}
+
+// runs the incremental updates over a stretch of the anim and checks every
+// tick against rebuilding the whole mesh
+static void VerifyIncremental(md5anim_t *anim)
+{
+	float maxerror = 0.0f;
+	int numtris = numupdatetris;
+	int numtrisrebuilt = numupdatetrisrebuilt;
+
+	for(md5mesh_t *mesh = md5model->meshes; mesh; mesh = mesh->next)
+	{
+		mesh->surf.framesvalid = false;
+	}
+
+	for(int i = 0; i < 64; i++)
+	{
+		int frame0, frame1;
+		float lerp;
+		AnimFrameLerp(anim, i, &frame0, &frame1, &lerp);
+
+		memstack_t *oldstack = Frame_BeginScratch();
+
+		framepose_t pose;
+		Frame_AllocPose(&pose, anim->numjoints);
+
+		ComputeFramePose(&pose.joints[0], anim, frame0);
+		ComputeFramePose(&pose.joints[1], anim, frame1);
+		LerpJoints(&pose.blended, &pose.joints[0], &pose.joints[1], lerp, anim);
+		ComputeGlobalMatrices(pose.palette, &pose.blended, anim);
+		ComputeSkinMatrices(pose.skinmats, pose.palette, md5model->inversebindmats, anim);
+
+		for(md5mesh_t *mesh = md5model->meshes; mesh; mesh = mesh->next)
+		{
+			drawsurf_t *surf = &mesh->surf;
+
+			SkinVertices(surf->xyz, NULL, NULL, mesh, pose.skinmats);
+			UpdateNormalsAndTangents(surf, mesh, pose.skinmats, anim->numjoints);
+
+			drawsurf_t reference = *surf;
+			reference.faces = Mem_AllocFaceFrames(mesh->numtris);
+			reference.normals = (unsigned int*)Mem_Alloc(mesh->numvertices * sizeof(unsigned int));
+			reference.tangents = (unsigned int*)Mem_Alloc(mesh->numvertices * sizeof(unsigned int));
+			ComputeNormalsAndTangents(&reference, mesh);
+
+			float error = MaxNormalError(reference.normals, surf->normals, mesh->numvertices);
+			if(error > maxerror)
+				maxerror = error;
+
+			error = MaxNormalError(reference.tangents, surf->tangents, mesh->numvertices);
+			if(error > maxerror)
+				maxerror = error;
+		}
+
+		Frame_EndScratch(oldstack);
+	}
+
+	numtris = numupdatetris - numtris;
+	numtrisrebuilt = numupdatetrisrebuilt - numtrisrebuilt;
+
+	printf("verify: incremental tangent frames max error %g, %.1f%% of the triangles rebuilt\n",
+		maxerror, numtris ? 100.0 * numtrisrebuilt / numtris : 0.0);
+
+	// the next user starts over
+	for(md5mesh_t *mesh = md5model->meshes; mesh; mesh = mesh->next)
+	{
+		mesh->surf.framesvalid = false;
+	}
+	numupdatetris = 0;
+	numupdatetrisrebuilt = 0;
+
+	if(maxerror > packedtolerance)
+	{
+		Error("incremental tangent frames differ from a full rebuild by more than %g\n", packedtolerance);
+	}
+}
+
+static int CompareDouble(const void *a, const void *b)
+{
+	double da = *(const double*)a;
+	double db = *(const double*)b;
+
+	return (da > db) - (da < db);
+}
+
+static void PrintStageTimes(const char *name, double *samples, int numsamples)
+{
+	double total = 0.0;
+	for(int i = 0; i < numsamples; i++)
+	{
+		total += samples[i];
+	}
+
+	qsort(samples, numsamples, sizeof(double), CompareDouble);
+
+	// nearest rank, the smallest sample at or above 99% of them
+	int p99 = (int)ceil(0.99 * numsamples) - 1;
+	if(p99 < 0)
+	{
+		p99 = 0;
+	}
+
+	printf("%-10s %10.2f %10.2f %10.2f\n", name, samples[0], total / numsamples, samples[p99]);
+}
+
+static void TimeDemo(int numframes)
+{
+	if(!md5model || !md5model->anims)
+	{
+		Error("timedemo needs an md5mesh and at least one md5anim\n");
+	}
+
+	md5anim_t *anim = &md5model->anims[0];
+
+	int numvertices = 0;
+	for(md5mesh_t *mesh = md5model->meshes; mesh; mesh = mesh->next)
+	{
+		numvertices += mesh->numvertices;
+	}
+
+	double *samples[NUM_STAGES];
+	for(int i = 0; i < NUM_STAGES; i++)
+	{
+		samples[i] = (double*)Mem_Alloc(numframes * sizeof(double));
+	}
+	double *totals = (double*)Mem_Alloc(numframes * sizeof(double));
+
+	if(timedemoverify)
+	{
+		VerifyDecode(anim);
+		VerifyKernels(anim);
+		VerifyNormals(anim);
+		VerifyIncremental(anim);
+	}
+
+	// instances are dealt the anims in turn
+	int numanims = 0;
+	for(md5anim_t *a = md5model->anims; a; a = a->next)
+	{
+		numanims++;
+	}
+
+	md5anim_t **anims = (md5anim_t**)Mem_Alloc(numanims * sizeof(md5anim_t*));
+	numanims = 0;
+	for(md5anim_t *a = md5model->anims; a; a = a->next)
+	{
+		anims[numanims++] = a;
+	}
+
+	// the first instance draws into the mesh's own surfs, the others get
+	// copies with streams of their own
+	int nummeshes = 0;
+	for(md5mesh_t *mesh = md5model->meshes; mesh; mesh = mesh->next)
+	{
+		nummeshes++;
+	}
+
+	drawsurf_t *instancesurfs = (drawsurf_t*)Mem_Alloc(timedemoinstances * nummeshes * sizeof(drawsurf_t));
+	for(int n = 0; n < timedemoinstances; n++)
+	{
+		md5mesh_t *mesh = md5model->meshes;
+		for(int m = 0; m < nummeshes; m++, mesh = mesh->next)
+		{
+			drawsurf_t *surf = &instancesurfs[n * nummeshes + m];
+
+			*surf = mesh->surf;
+			if(n > 0 && !timedemoskeleton)
+			{
+				AllocSurfStreams(surf, mesh, md5model->numjoints);
+			}
+		}
+	}
+
+	printf("timedemo: %i frames, %i joints (%i static), %i vertices, anim %s\n", numframes, anim->numjoints, anim->numstaticjoints, numvertices, anim->name);
+	if(timedemoinstances > 1)
+	{
+		printf("instances: %i on %i anims\n", timedemoinstances, numanims);
+	}
+	if(timedemoskeleton)
+	{
+		printf("kernels: palette %s, skeleton only\n", palettekernelname);
+	}
+	else
+	{
+		printf("kernels: palette %s, skin %s, normals %s\n", palettekernelname, skinkernelname, normalsmodenames[normalsmode]);
+	}
+
+	double demostart = Sys_Microseconds();
+
+	for(int i = 0; i < numframes; i++)
+	{
+		memstack_t *oldstack = Frame_BeginScratch();
+
+		framepose_t pose;
+		Frame_AllocPose(&pose, anim->numjoints);
+
+		for(int j = 0; j < NUM_STAGES; j++)
+		{
+			samples[j][i] = 0.0;
+		}
+
+		for(int n = 0; n < timedemoinstances; n++)
+		{
+			md5anim_t *instanceanim = anims[n % numanims];
+
+			int frame0, frame1;
+			float lerp;
+			AnimFrameLerp(instanceanim, i + n * TIMEDEMO_INSTANCE_SPREAD, &frame0, &frame1, &lerp);
+
+			double t0 = Sys_Microseconds();
+
+			md5pose_t *from = SampleFramePose(instanceanim, frame0, &pose.joints[0]);
+			md5pose_t *to = SampleFramePose(instanceanim, frame1, &pose.joints[1]);
+
+			double t1 = Sys_Microseconds();
+
+			LerpJoints(&pose.blended, from, to, lerp, instanceanim);
+
+			double t2 = Sys_Microseconds();
+
+			ComputeGlobalMatrices(pose.palette, &pose.blended, instanceanim);
+			ComputeSkinMatrices(pose.skinmats, pose.palette, md5model->inversebindmats, instanceanim);
+
+			double t3 = Sys_Microseconds();
+
+			samples[STAGE_DECODE][i] += t1 - t0;
+			samples[STAGE_LERP][i] += t2 - t1;
+			samples[STAGE_PALETTE][i] += t3 - t2;
+
+			if(timedemoskeleton)
+				continue;
+
+			drawsurf_t *surf = &instancesurfs[n * nummeshes];
+			for(md5mesh_t *mesh = md5model->meshes; mesh; mesh = mesh->next, surf++)
+			{
+				double t4 = Sys_Microseconds();
+
+				BuildVertexBuffer(surf->xyz, surf, mesh, pose.skinmats);
+
+				double t5 = Sys_Microseconds();
+
+				BuildNormals(surf->colors, surf, mesh, pose.skinmats);
+
+				double t6 = Sys_Microseconds();
+
+				samples[STAGE_SKIN][i] += t5 - t4;
+				samples[STAGE_NORMALS][i] += t6 - t5;
+			}
+		}
+
+		Frame_EndScratch(oldstack);
+
+		totals[i] = 0.0;
+		for(int j = 0; j < NUM_STAGES; j++)
+		{
+			totals[i] += samples[j][i];
+		}
+	}
+
+	double demotime = Sys_Microseconds() - demostart;
+
+	// sorting the samples below doesn't change the sum
+	double decodetime = 0.0;
+	for(int i = 0; i < numframes; i++)
+	{
+		decodetime += samples[STAGE_DECODE][i];
+	}
+
+	printf("%-10s %10s %10s %10s\n", "stage", "min(us)", "avg(us)", "p99(us)");
+	for(int i = 0; i < NUM_STAGES; i++)
+	{
+		PrintStageTimes(stagenames[i], samples[i], numframes);
+	}
+	PrintStageTimes("total", totals, numframes);
+
+	printf("%i frames in %.3f seconds, %.1f frames/sec\n", numframes, demotime / 1000000.0, numframes / (demotime / 1000000.0));
+
+	// two frames are decoded per tick
+	if(decodetime > 0.0)
+	{
+		printf("decode: %.1f joints/us\n", 2.0 * anim->numjoints * timedemoinstances * numframes / decodetime);
+	}
+
+	if(posecachenumslots)
+	{
+		int numlookups = posecachehits + posecachemisses;
+
+		printf("pose cache: %i KB, %i slots, %i hits, %i misses (%.1f%% hit), %i evictions\n",
+			posecachebudget, posecachenumslots, posecachehits, posecachemisses,
+			numlookups ? 100.0 * posecachehits / numlookups : 0.0, posecacheevictions);
+	}
+
+	if(normalsmode == NORMALS_RECOMPUTE && numupdatetris)
+	{
+		printf("normals: rebuilt %.1f%% of the triangles\n", 100.0 * numupdatetrisrebuilt / numupdatetris);
+	}
+}
+
+//==============================================
+// parse benchmark
+//
+// tokenizes the md5 files on the command line and times converting every
+// number with ParseFloat against the strtof path the loader used to take
+
+static bool parsebench;
+
+static bool IsNumberToken(token_t *token)
+{
+	char c = token->string[0];
+
+	return !token->quoted && token->length && ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.');
+}
+
+static float StrtofToken(token_t *token)
+{
+	char buffer[64];
+	int length = token->length < (int)sizeof(buffer) - 1 ? token->length : (int)sizeof(buffer) - 1;
+
+	memcpy(buffer, token->string, length);
+	buffer[length] = '\0';
+
+	return strtof(buffer, NULL);
+}
+
+static void ParseBench(int argc, char **argv)
+{
+	for(int i = 1; i < argc; i++)
+	{
+		if(!strstr(argv[i], ".md5mesh") && !strstr(argv[i], ".md5anim"))
+			continue;
+
+		lexer_t lex;
+		if(!Lex_Open(&lex, argv[i]))
+		{
+			Error("couldn't open file \"%s\"\n", argv[i]);
+		}
+
+		double fasttime = 1e30;
+		double strtoftime = 1e30;
+		int numnumbers = 0;
+		int nummismatches = 0;
+		float checksum = 0.0f;
+
+		for(int run = 0; run < 5; run++)
+		{
+			token_t token;
+
+			lex.p = lex.buffer;
+			numnumbers = 0;
+			nummismatches = 0;
+
+			double t0 = Sys_Microseconds();
+			while(Lex_ReadToken(&lex, &token))
+			{
+				float f;
+				if(IsNumberToken(&token) && ParseFloat(token.string, token.length, lex.end, &f))
+				{
+					checksum += f;
+					numnumbers++;
+				}
+			}
+			double t1 = Sys_Microseconds();
+
+			lex.p = lex.buffer;
+
+			double t2 = Sys_Microseconds();
+			while(Lex_ReadToken(&lex, &token))
+			{
+				if(IsNumberToken(&token))
+				{
+					checksum += StrtofToken(&token);
+				}
+			}
+			double t3 = Sys_Microseconds();
+
+			if(t1 - t0 < fasttime)
+				fasttime = t1 - t0;
+			if(t3 - t2 < strtoftime)
+				strtoftime = t3 - t2;
+		}
+
+		// check the two agree bit for bit
+		token_t token;
+		lex.p = lex.buffer;
+		while(Lex_ReadToken(&lex, &token))
+		{
+			float f;
+			if(IsNumberToken(&token) && ParseFloat(token.string, token.length, lex.end, &f))
+			{
+				float reference = StrtofToken(&token);
+				if(FloatToUnsignedInt(f) != FloatToUnsignedInt(reference))
+					nummismatches++;
+			}
+		}
+
+		double megabytes = lex.size / (1024.0 * 1024.0);
+
+		printf("%s: %.2f MB, %i numbers, ParseFloat %.1f MB/s, strtof %.1f MB/s, %i mismatches (%g)\n",
+			argv[i], megabytes, numnumbers, megabytes / (fasttime / 1000000.0), megabytes / (strtoftime / 1000000.0), nummismatches, checksum);
+
+		Lex_Close(&lex);
+	}
+}
+
+//==============================================
+// simulation code
+
+static float viewangles[2];
+static float viewpos[3];
+static float viewvectors[3][3];
+
+typedef struct tickcmd_s
+{
+	float	forwardmove;
+	float	sidemove;
+	float	anglemove[2];
+
+} tickcmd_t;
+
+static tickcmd_t gcmd;
+
+// This must be part of game state or else movement becomes dependent on the rendering
+static void VectorsFromSphericalAngles(float vectors[3][3], float angles[2])
+{
+	float cx, sx, cy, sy, cz, sz;
+
+	cx = 1.0f;
+	sx = 0.0f;
+	cy = cosf(angles[0]);
+	sy = sinf(angles[0]);
+	cz = cosf(angles[1]);
+	sz = sinf(angles[1]);
+
+	vectors[0][0] = cy * cz;
+	vectors[0][1] = sz;
+	vectors[0][2] = -sy * cz;
+
+	vectors[1][0] = (-cx * cy * sz) + (sx * sy);
+	vectors[1][1] = cx * cz;
+	vectors[1][2] = (cx * sy * sz) + (sx * cy);
+
+	vectors[2][0] = (sx * cy * sz) + (cx * sy);
+	vectors[2][1] = (-sx * cz);
+	vectors[2][2] = (-sx * sy * sz) + (cx * cy);
+}
+
+// build a current command from the input state
+static void BuildTickCmd()
+{
+	tickcmd_t *cmd = &gcmd;
+	float scale;
+	
+	// Move forward ~512 units each second (60 * 4.2)
+	scale = 4.2f;
+
+	cmd->forwardmove = 0.0f;
+	cmd->sidemove = 0.0f;
+	cmd->anglemove[0] = 0.0f;
+	cmd->anglemove[1] = 0.0f;
+
+	if(input.keys['w'])
+	{
+		cmd->forwardmove += scale;
+	}
+
+	if(input.keys['s'])
+	{
+		cmd->forwardmove -= scale;
+	}
+
+	if(input.keys['d'])
+	{
+		cmd->sidemove += scale;
+	}
+
+	if(input.keys['a'])
+	{
+		cmd->sidemove -= scale;
+	}
+
+	// Handle mouse movement
+	if(input.lbuttondown)
+	{
+		cmd->anglemove[0] = -0.02f * (float)input.moused[0];
+		cmd->anglemove[1] = -0.02f * (float)input.moused[1];
+	}
+}
+
+// input capture
+static bool		inputcapture = false;
+static bool		inputplayback = false;
+static char*	inputfilename = NULL;
+static FILE*	fpinputcapture;
+static int		numinputswritten;
+static int	inputstartframe;
+static int	inputendframe;
+
+// fixme: how to setup output filename?
+static void BeginInputCapture()
+{
+	fpinputcapture = fopen("input.bin", "wb");
+
+	// capture initial state
+	fwrite(viewpos, sizeof(float), 3, fpinputcapture);
+	fwrite(viewangles, sizeof(float), 2, fpinputcapture);
+
+	numinputswritten = 0;
+}
+
+static void EndInputCapture()
+{
+	fclose(fpinputcapture);
+
+	printf("captured %d inputs\n", numinputswritten);
+}
+
+static void WriteInput()
+{
+	if(!inputcapture)
+		return;
+
+	fwrite(&gcmd, sizeof(tickcmd_t), 1, fpinputcapture);
+
+	numinputswritten++;
+}
+
+// input playback
+static void ReadNextInput()
+{
+	if(!inputplayback)
+		return;
+
+	if(!fpinputcapture)
+	{
+		fpinputcapture = fopen(inputfilename, "rb");
+		fread(viewpos, sizeof(float), 3, fpinputcapture);
+		fread(viewangles, sizeof(float), 2, fpinputcapture);
+		return;
+	}
+
+	fread(&gcmd, sizeof(tickcmd_t), 1, fpinputcapture);
+
+	if(feof(fpinputcapture))
+	{
+		inputplayback = false;
+		fclose(fpinputcapture);
+
+		printf("finished input playback\n");
+	}
+}
+
+// apply the tick command to the viewstate
+static void DoMove()
+{
+	tickcmd_t *cmd = &gcmd;
+
+	VectorsFromSphericalAngles(viewvectors, viewangles);
+
+	viewpos[0] += cmd->forwardmove * viewvectors[0][0];
+	viewpos[1] += cmd->forwardmove * viewvectors[0][1];
+	viewpos[2] += cmd->forwardmove * viewvectors[0][2];
+
+	viewpos[0] += cmd->sidemove * viewvectors[2][0];
+	viewpos[1] += cmd->sidemove * viewvectors[2][1];
+	viewpos[2] += cmd->sidemove * viewvectors[2][2];
+
+	viewangles[0] += cmd->anglemove[0];
+	viewangles[1] += cmd->anglemove[1];
+
+	if(viewangles[1] >= PI / 2.0f)
+		viewangles[1] = (PI / 2.0f) - 0.001f;
+	if(viewangles[1] <= -PI/ 2.0f)
+		viewangles[1] = (-PI / 2.0f) + 0.001f;
+}
+
+static void SetupDefaultViewPos()
+{
+	// look down negative z
+	viewangles[0] = PI / 2.0f;
+	viewangles[1] = 0.0f;
+	
+	viewpos[0] = 0.0f;
+	viewpos[1] = 0.0f;
+	viewpos[2] = 256.0f;
+}
+
+// Advance the state of everything by one frame
+static void Ticker()
+{
+	BuildTickCmd();
+	
+	ReadNextInput();
+
+	WriteInput();
+
+	DoMove();
+}
+
+// Called every frame to process the current mouse input state
+// We only get updates when the mouse moves so the current mouse
+// position is stored and may be used for multiple frames
+static void ProcessInput()
+{
+	// mousepos has current "frame" mouse pos
+	input.moused[0] = mousepos[0] - input.mousepos[0];
+	input.moused[1] = mousepos[1] - input.mousepos[1];
+	input.mousepos[0] = mousepos[0];
+	input.mousepos[1] = mousepos[1];
+}
+
+static void MainLoop()
+{
+	// initialize the base time
+	if(!oldtime)
+	{
+		oldtime = Sys_Milliseconds();
+	}
+
+	int newtime = Sys_Milliseconds();
+	int deltatime = newtime - oldtime;
+	oldtime = newtime;
+
+	// wait until some time has elapsed
+	if(deltatime < 1)
+	{
+		Sys_Sleep(0);
+		return;
+	}
+	
+	ProcessInput();
+
+	// figure out how many tick s to run?
+	// sync frames?
+	if(deltatime > 50)
+		deltatime = 0;
+
+	// update realtime
+	realtime += deltatime;
+
+	// run a tick if enough time has elapsed
+	// should realtime be clamped if we're dropping frames?
+	//if(realtime > framenum * 16)
+	while(realtime > framenum * 16)
+	{
+		framenum++;
+
+		Ticker();
+	}
+
+	// signal a screen redraw (should this be sync'd with simulation updates
+	// or free running?) glutPostRedisplay signals the draw callback to be called
+	// on the next pass through the glutMainLoop
+	// run as fast as possible to capture the mouse movements
+	glutPostRedisplay();
+}
+
+//==============================================
+// OpenGL rendering code
+//
+// this stuff touches some of the simulation state (viewvectors, viewpos etc)
+// guess it should really have an interface to extract that data?
+
+static int renderwidth;
+static int renderheight;
+
+static int rendermode = 0;
+typedef void (*drawfunc_t)();
+
+static void GL_LoadMatrix(float m[4][4])
+{
+	glLoadMatrixf((float*)m);
+}
+
+static void GL_LoadMatrixTranspose(float m[4][4])
+{
+	float t[4][4];
+
+	MatrixTranspose(t, m);
+	glLoadMatrixf((float*)t);
+}
+
+static void GL_MultMatrix(float m[4][4])
+{
+	glMultMatrixf((float*)m);
+}
+
+static void GL_MultMatrixTranspose(float m[4][4])
+{
+	float t[4][4];
+
+	MatrixTranspose(t, m);
+	glMultMatrixf((float*)t);
+}
+
+static void DrawAxis()
+{
+	glBegin(GL_LINES);
+	glColor3f(1, 0, 0);
+	glVertex3f(0, 0, 0);
+	glVertex3f(32, 0, 0);
+
+	glColor3f(0, 1, 0);
+	glVertex3f(0, 0, 0);
+	glVertex3f(0, 32, 0);
+
+	glColor3f(0, 0, 1);
+	glVertex3f(0, 0, 0);
+	glVertex3f(0, 0, 32);
+	glEnd();
+}
+
+static void SetModelViewMatrix()
+{
+	// matrix to transform from look down x to looking down -z
+	static float yrotate[4][4] =
+	{
+		{ 0, 0, 1, 0 },
+		{ 0, 1, 0, 0 },
+		{ -1, 0, 0, 0 },
+		{ 0, 0, 0, 1 }
+	};
+
+	// matrix to convert from doom coordinates to gl coordinates
+	static float doomtogl[4][4] =
+	{
+		{ 1, 0, 0, 0 },
+		{ 0, 0, 1, 0 },
+		{ 0, -1, 0, 0 },
+		{ 0, 0, 0, 1 }
+	};
+
+	float matrix[4][4];
+	matrix[0][0]	= viewvectors[0][0];
+	matrix[0][1]	= viewvectors[0][1];
+	matrix[0][2]	= viewvectors[0][2];
+	matrix[0][3]	= -(viewvectors[0][0] * viewpos[0]) - (viewvectors[0][1] * viewpos[1]) - (viewvectors[0][2] * viewpos[2]);
+
+	matrix[1][0]	= viewvectors[1][0];
+	matrix[1][1]	= viewvectors[1][1];
+	matrix[1][2]	= viewvectors[1][2];
+	matrix[1][3]	= -(viewvectors[1][0] * viewpos[0]) - (viewvectors[1][1] * viewpos[1]) - (viewvectors[1][2] * viewpos[2]);
+
+	matrix[2][0]	= viewvectors[2][0];
+	matrix[2][1]	= viewvectors[2][1];
+	matrix[2][2]	= viewvectors[2][2];
+	matrix[2][3]	= -(viewvectors[2][0] * viewpos[0]) - (viewvectors[2][1] * viewpos[1]) - (viewvectors[2][2] * viewpos[2]);
+
+	matrix[3][0]	= 0.0f;
+	matrix[3][1]	= 0.0f;
+	matrix[3][2]	= 0.0f;
+	matrix[3][3]	= 1.0f;
+
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
+	GL_MultMatrixTranspose(yrotate);
+	GL_MultMatrixTranspose(matrix);
+	GL_MultMatrixTranspose(doomtogl);
+}
+
+static void R_SetPerspectiveMatrix(float fov, float aspect, float znear, float zfar)
+{
+	float r, l, t, b;
+	float fovx, fovy;
+	float m[4][4];
+
+	// fixme: move this somewhere else
+	fovx = fov * (3.1415f / 360.0f);
+	float x = (renderwidth / 2.0f) / atan(fovx);
+	fovy = atan2(renderheight / 2.0f, x);
+
+	// Calcuate right, left, top and bottom values
+	r = znear * fovx; //tan(fovx * (3.1415f / 360.0f));
+	l = -r;
+
+	t = znear * fovy; //tan(fovy * (3.1415f / 360.0f));
+	b = -t;
+
+	m[0][0] = (2.0f * znear) / (r - l);
+	m[1][0] = 0;
+	m[2][0] = (r + l) / (r - l);
+	m[3][0] = 0;
+
+	m[0][1] = 0;
+	m[1][1] = (2.0f * znear) / (t - b);
+	m[2][1] = (t + b) / (t - b);
+	m[3][1] = 0;
+
+	m[0][2] = 0;
+	m[1][2] = 0;
+	m[2][2] = -(zfar + znear) / (zfar - znear);
+	m[3][2] = -2.0f * zfar * znear / (zfar - znear);
+
+	m[0][3] = 0;
+	m[1][3] = 0;
+	m[2][3] = -1;
+	m[3][3] = 0;
+
+	glMatrixMode(GL_PROJECTION);
+	GL_LoadMatrix(m);
+}
+
+static void BeginFrame()
+{
+	glClearColor(0.3f, 0.3f, 0.3f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glEnable(GL_DEPTH_TEST);
+	glFrontFace(GL_CW);
+	glEnable(GL_CULL_FACE);
+}
+
+static void Draw()
+{
+	BeginFrame();
+
+	SetModelViewMatrix();
+
+	DrawAxis();
+
+	JointTest();
+}
+
+//==============================================
+// GLUT/OS/windowing code
+
+static void DisplayFunc()
+{
+	Draw();
+
+	//if(glGetError() != GL_NO_ERROR)
+	//	Error("Got a GL error\n");
+	//glFlush();
+	//int time1 = Sys_Milliseconds();
+	//printf("preswap: %i\n", time1);
+	glutSwapBuffers();
+	//int time2 = Sys_Milliseconds();
+	//printf("pstswap: %i\n", time2);
+}
+
+static void KeyboardDownFunc(unsigned char key, int x, int y)
+{
+	input.keys[key] = true;
+
+	if(key == 'q')
+	{
+		inputcapture = !inputcapture;
+
+		if(inputcapture)
+		{
+			fprintf(stdout, "Begin input capture\n");
+			BeginInputCapture();
+		}
+		else
+		{
+			fprintf(stdout, "End input capture\n");
+			EndInputCapture();
+		}
+	}
+
+	if(key == 'r')
+	{
+		rendermode++;
+		if(rendermode == 2)
+			rendermode = 0;
+	}
+
+	if(key == 'n')
+	{
+		normalsmode = (normalsmode + 1) % NUM_NORMALSMODES;
+		printf("normals %s\n", normalsmodenames[normalsmode]);
+	}
+
+	if(key == 't')
+	{
+		drawtangentframes = !drawtangentframes;
+	}
+}
+
+static void KeyboardUpFunc(unsigned char key, int x, int y)
+{
+	input.keys[key] = false;
+}
+
+static void ReshapeFunc(int w, int h)
+{
+	renderwidth = w;
+	renderheight = h;
+
+	R_SetPerspectiveMatrix(90.0f, (float)w / (float)h, 3, 4096.0f);
+
+	glViewport(0, 0, w, h);
+}
+
+static void MouseFunc(int button, int state, int x, int y)
+{
+	if(button == GLUT_LEFT_BUTTON)
+		input.lbuttondown = (state == GLUT_DOWN);
+	if(button == GLUT_RIGHT_BUTTON)
+		input.rbuttondown = (state == GLUT_DOWN);
+}
+
+static void MouseMoveFunc(int x, int y)
+{
+	mousepos[0] = x;
+	mousepos[1] = y;
+}
+
+static void MainLoopFunc()
+{
+	MainLoop();
+}
+
+static void PrintUsage()
+{}
+
+static void ProcessCommandLine(int argc, char *argv[])
+{
+	int i;
+
+	for(i = 1; i < argc; i++)
+	{
+		if(argv[i][0] != '-')
+			break;
+
+		if(!strcmp(argv[i], "--input"))
+		{
+			inputplayback = true;
+			inputfilename = argv[i + i];
+			i++;
+		}
+		else if(!strcmp(argv[i], "--timedemo"))
+		{
+			if(i + 1 == argc)
+			{
+				Error("--timedemo needs a frame count\n");
+			}
+
+			timedemoframes = atoi(argv[i + 1]);
+			if(timedemoframes <= 0)
+			{
+				Error("Invalid timedemo frame count %s\n", argv[i + 1]);
+			}
+			i++;
+		}
+		else if(!strcmp(argv[i], "--parsebench"))
+		{
+			parsebench = true;
+		}
+		else if(!strcmp(argv[i], "--threads"))
+		{
+			if(i + 1 == argc)
+			{
+				Error("--threads needs a thread count\n");
+			}
+
+			numjobthreads = atoi(argv[i + 1]);
+			if(numjobthreads < 0)
+			{
+				Error("Invalid thread count %s\n", argv[i + 1]);
+			}
+			i++;
+		}
+		else if(!strcmp(argv[i], "--hugepages"))
+		{
+			memhugepages = true;
+		}
+		else if(!strcmp(argv[i], "--memstats"))
+		{
+			memstats = true;
+		}
+		else if(!strcmp(argv[i], "--checkalloc"))
+		{
+			checkframealloc = true;
+		}
+		else if(!strcmp(argv[i], "--nocache"))
+		{
+			usecache = false;
+		}
+		else if(!strcmp(argv[i], "--posecache"))
+		{
+			if(i + 1 == argc)
+			{
+				Error("--posecache needs a size in kilobytes\n");
+			}
+
+			posecachebudget = atoi(argv[i + 1]);
+			if(posecachebudget < 0)
+			{
+				Error("Invalid pose cache size %s\n", argv[i + 1]);
+			}
+			i++;
+		}
+		else if(!strcmp(argv[i], "--quantize"))
+		{
+			quantizeanims = true;
+		}
+		else if(!strcmp(argv[i], "--reduce"))
+		{
+			if(i + 1 == argc)
+			{
+				Error("--reduce needs a tolerance\n");
+			}
+
+			reducetolerance = atof(argv[i + 1]);
+			if(reducetolerance <= 0.0f)
+			{
+				Error("Invalid reduce tolerance %s\n", argv[i + 1]);
+			}
+			i++;
+		}
+		else if(!strcmp(argv[i], "--reduceangle"))
+		{
+			if(i + 1 == argc)
+			{
+				Error("--reduceangle needs an angle in degrees\n");
+			}
+
+			reduceangle = atof(argv[i + 1]);
+			if(reduceangle <= 0.0f)
+			{
+				Error("Invalid reduce angle %s\n", argv[i + 1]);
+			}
+			i++;
+		}
+		else if(!strcmp(argv[i], "--bake"))
+		{
+			if(i + 1 == argc)
+			{
+				Error("--bake needs a size in kilobytes\n");
+			}
+
+			bakebudget = atoi(argv[i + 1]);
+			if(bakebudget < 0)
+			{
+				Error("Invalid bake size %s\n", argv[i + 1]);
+			}
+			i++;
+		}
+		else if(!strcmp(argv[i], "--instances"))
+		{
+			if(i + 1 == argc)
+			{
+				Error("--instances needs an instance count\n");
+			}
+
+			timedemoinstances = atoi(argv[i + 1]);
+			if(timedemoinstances <= 0)
+			{
+				Error("Invalid instance count %s\n", argv[i + 1]);
+			}
+			i++;
+		}
+		else if(!strcmp(argv[i], "--verify"))
+		{
+			timedemoverify = true;
+		}
+		else if(!strcmp(argv[i], "--skeleton"))
+		{
+			timedemoskeleton = true;
+		}
+		else if(!strcmp(argv[i], "--simd"))
+		{
+			if(i + 1 == argc)
+			{
+				Error("--simd needs generic, sse2 or avx2\n");
+			}
+
+			if(!strcmp(argv[i + 1], "generic"))
+				cpufeaturemask = 0;
+			else if(!strcmp(argv[i + 1], "sse2"))
+				cpufeaturemask = CPU_SSE2;
+			else if(!strcmp(argv[i + 1], "avx2"))
+				cpufeaturemask = CPU_SSE2 | CPU_AVX2;
+			else
+				Error("Unknown simd level %s\n", argv[i + 1]);
+			i++;
+		}
+		else if(!strcmp(argv[i], "--render"))
+		{
+			if(i + 1 == argc)
+			{
+				Error("--render needs legacy, orphan or persistent\n");
+			}
+
+			for(renderpath = 0; renderpath < NUM_RENDERPATHS; renderpath++)
+			{
+				if(!strcmp(argv[i + 1], renderpathnames[renderpath]))
+					break;
+			}
+
+			if(renderpath == NUM_RENDERPATHS)
+				Error("Unknown render path %s\n", argv[i + 1]);
+			i++;
+		}
+		else if(!strcmp(argv[i], "--normals"))
+		{
+			if(i + 1 == argc)
+			{
+				Error("--normals needs skinned or recompute\n");
+			}
+
+			for(normalsmode = 0; normalsmode < NUM_NORMALSMODES; normalsmode++)
+			{
+				if(!strcmp(argv[i + 1], normalsmodenames[normalsmode]))
+					break;
+			}
+
+			if(normalsmode == NUM_NORMALSMODES)
+				Error("Unknown normals mode %s\n", argv[i + 1]);
+			i++;
+		}
+		else if(!strcmp(argv[i], "--start-frame"))
+		{
+			Error("--start-frame not implemented\n");
+		}
+		else if(!strcmp(argv[i], "--end-frame"))
+		{
+			Error("--end-frame not implemented\n");
+		}
+		else
+		{
+			Error("Unknown option %s\n", argv[i]);
+		}
+	}
+
+	if(i == argc)
+	{
+		Error("No input file\n");
+	}
+
+	if(quantizeanims && reducetolerance > 0.0f)
+	{
+		Error("--quantize and --reduce can't be used together\n");
+	}
+}
+
+// glutInit has to see the command line first to take out its own options,
+// but it needs a display, which the headless modes are meant to run without
+static bool IsHeadless(int argc, char *argv[])
+{
+	for(int i = 1; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "--timedemo") || !strcmp(argv[i], "--parsebench"))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int main(int argc, char *argv[])
+{
+	if(!IsHeadless(argc, argv))
+	{
+		glutInit(&argc, argv);
+	}
+
+	ProcessCommandLine(argc, argv);
+
+	Sys_DetectCPU();
+	SelectKernels();
+
+	Job_Init();
+
+	if(parsebench)
+	{
+		ParseBench(argc, argv);
+
+		return 0;
+	}
+
+	// the timedemo never touches GL so it can run without a display
+	if(timedemoframes)
+	{
+		ProcessMD5Files(argc, argv);
+		BakeAnims(timedemoinstances);
+		PoseCache_Init();
+
+		TimeDemo(timedemoframes);
+
+		if(memstats)
+		{
+			Mem_PrintStats();
+		}
+
+		return 0;
+	}
+
+	glutInitWindowPosition(0, 0);
+	glutInitWindowSize(400, 400);
+	glutInitDisplayMode(GLUT_RGBA | GLUT_DEPTH | GLUT_DOUBLE);
+	glutCreateWindow("test");
+
+	R_SelectRenderPath();
+
+	ProcessMD5Files(argc, argv);
+	BakeAnims(1);
+	PoseCache_Init();
+
+	if(memstats)
+	{
+		Mem_PrintStats();
+	}
+	
+	SetupDefaultViewPos();
+
+	glutReshapeFunc(ReshapeFunc);
+	glutDisplayFunc(DisplayFunc);
+	glutKeyboardFunc(KeyboardDownFunc);
+	glutKeyboardUpFunc(KeyboardUpFunc);
+	glutMouseFunc(MouseFunc);
+	glutMotionFunc(MouseMoveFunc);
+	glutPassiveMotionFunc(MouseMoveFunc);
+	glutIdleFunc(MainLoopFunc);
+
+	glutMainLoop();
+
+	return 0;
+}
+